@@ -25,13 +25,16 @@ STATIC INLINE size_t checkpoints_entry_offset(size_t idx) {
  */
 STATIC INLINE void *checkpoints_list(str8 str) {
     uint8_t type = STR8_TYPE(str);
-    if (type <= STR8_TYPE1 || STR8_IS_ASCII(str)) {
+    if (type <= STR8_TYPE1 || STR8_IS_ASCII(str) || STR8_WIDTH(str) ||
+        STR8_INDEX(str) != STR8_INDEX_LIST) {
         return NULL;
     }
-    size_t table_count = str8cap(str)/CHECKPOINTS_GRANULARITY;
-    // the list contains an entry for each TABLE_GRANULARITY bytes
+    size_t table_count = str8cap(str) >> STR8_GRANULARITY_SHIFT(str);
+    // the list contains an entry for each granularity bytes
     size_t table_bytesize = checkpoints_entry_offset(table_count);
-    return ((char*)str) - (1 + 3 * STR8_FIELD_SIZE(type)) - table_bytesize;
+    // the descriptor byte is in between the list and the fields
+    size_t fields_size = 1 + 3 * STR8_FIELD_SIZE(type) + (STR8_HAS_DESC(str) ? 1 : 0);
+    return ((char*)str) - fields_size - table_bytesize;
 }
 
 /**
@@ -71,6 +74,80 @@ STATIC INLINE void write_entry(void *list, size_t idx, size_t value) {
     }
 }
 
+/**
+ * @brief Make room for count entries in the list of results (config.list_start_idx must be 0).
+ *
+ * @param written Number of entries written so far, which are kept.
+ */
+STATIC int analyze_reserve(str8_analyze_results *results, size_t count, size_t written) {
+    if (count <= results->list_capacity) {
+        return 0;
+    }
+    // grow fast to avoid allocations. this is just temporary anyways
+    size_t new_capacity = results->list_capacity * 2;
+    while (new_capacity < count) {
+        new_capacity *= 2;
+    }
+    void *new_list = NULL;
+    if (results->list_created) {
+        new_list = realloc(results->list, checkpoints_entry_offset(new_capacity));
+        if (!new_list) {
+            return 1;
+        }
+    }
+    else {
+        new_list = malloc(checkpoints_entry_offset(new_capacity));
+        if (!new_list) {
+            return 1;
+        }
+        // the initial stack list should always be initiated with
+        // MAX_2BYTE_INDEX uint16_t entries.
+        // When copying from the initial stack list, we must assume it was
+        // created with fixed-size entries.
+        memcpy(new_list, results->list, written * sizeof(uint16_t));
+        results->list_created = true;
+    }
+    results->list = new_list;
+    results->list_capacity = new_capacity;
+    return 0;
+}
+
+/** @brief Return the width of the character starting with the byte c (0 for continuation bytes). */
+STATIC INLINE size_t analyze_lead_width(unsigned char c) {
+    return c < 0x80 ? 1 : (c & 0xE0) == 0xC0 ? 2 : (c & 0xF0) == 0xE0 ? 3 : (c & 0xF8) == 0xF0 ? 4 : 0;
+}
+
+/**
+ * @brief Check if the characters up to end still all have width bytes.
+ *
+ * @param lead Position of the next character if they have, advanced to end.
+ * @param chunk_len Number of characters counted in the chunk ending at end.
+ */
+STATIC INLINE bool analyze_uniform_chunk(const char *str, size_t *lead, size_t end, size_t width,
+                                         size_t chunk_len, size_t chunk_size) {
+    if (width == 1) {
+        return chunk_len == chunk_size;
+    }
+    // every width' byte is a lead byte of that width and there are no other
+    // characters, so all other bytes are continuation bytes
+    size_t leads = 0;
+    for (; *lead < end; *lead += width, leads++) {
+        if (analyze_lead_width((unsigned char)str[*lead]) != width) {
+            return false;
+        }
+    }
+    return leads == chunk_len;
+}
+
+/** @brief Write the entries skipped while all characters had width bytes. */
+STATIC int analyze_fill_skipped(str8_analyze_results *results, size_t width, size_t granularity) {
+    if (analyze_reserve(results, results->list_size, 0) != 0) {
+        return 1;
+    }
+    checkpoints_fill_uniform(results->list, 0, results->list_size, width, granularity);
+    return 0;
+}
+
 uint8_t str8_analyze(
     const char *str,
     size_t max_bytes,
@@ -82,20 +159,28 @@ uint8_t str8_analyze(
     results->list_size = config.list_start_idx;
     results->size = 0;
     results->length = 0;
+    results->width = 0;
     results->list_created = false;
+    const size_t G = config.granularity ? config.granularity : CHECKPOINTS_GRANULARITY;
+
+    // width of the characters so far, the entries are not written while it is set
+    size_t width = config.uniform ? analyze_lead_width((unsigned char)str[0]) : 0;
+    size_t lead = 0;
 
     // When appending a string, the new checkpoint list must align with the
-    // existing one. Checkpoints are created at intervals of CHECKPOINTS_GRANULARITY.
+    // existing one. Checkpoints are created at intervals of G.
     // `byte_offset` is the size of the original string. We calculate how many
     // bytes are needed in the new string to reach the next checkpoint boundary.
     // This ensures the new checkpoints maintain the same global grid.
     // `first_rount_offset` is the remainder, determining the size of the first, partial chunk.
-    size_t first_rount_offset = config.byte_offset % CHECKPOINTS_GRANULARITY;
+    size_t first_rount_offset = config.byte_offset % G;
 
     void *list_pointer = (char*)results->list + checkpoints_entry_offset(config.list_start_idx);
 
     for (;;) {
-        size_t max_chunk_size = CHECKPOINTS_GRANULARITY - first_rount_offset;
+        // bytes up to the next checkpoint
+        size_t block_size = G - first_rount_offset;
+        size_t max_chunk_size = block_size;
         if (max_bytes != 0) {
             size_t remaining = results->size >= max_bytes ? 0 : max_bytes - results->size;
             if (remaining < max_chunk_size) {
@@ -119,42 +204,37 @@ uint8_t str8_analyze(
         results->size += chunk_size;
         results->length += chunk_len;
 
+        if (width && !analyze_uniform_chunk(str, &lead, results->size, width, chunk_len, chunk_size)) {
+            if (analyze_fill_skipped(results, width, G) != 0) {
+                return 1;
+            }
+            list_pointer = (char*)results->list + checkpoints_entry_offset(results->list_size);
+            width = 0;
+        }
+
         // quit if the end was reached (no other list entry necessary)
-        if (chunk_size < max_chunk_size) {  // NULL byte was found in chunk
+        // either a NULL byte was found in the chunk or max_bytes was reached
+        // before the next checkpoint
+        if (chunk_size < block_size) {
             break;
         }
 
         size_t idx = results->list_size;
 
+        if (width) {
+            results->list_size++;
+            continue;
+        }
+
         // increase the table if necessary
         if (idx == results->list_capacity) {
             if (config.list_start_idx != 0) {
                 // If an existing table is extended, it cannot be reallocated!
                 return 1;
             }
-            // grow fast to avoid allocations. this is just temporary anyways
-            size_t new_capacity = results->list_capacity * 2;
-            void *new_list = NULL;
-            if (results->list_created) {
-                new_list = realloc(results->list, checkpoints_entry_offset(new_capacity));
-                if (!new_list) {
-                    return 1;
-                }
-            }
-            else {
-                new_list = malloc(checkpoints_entry_offset(new_capacity));
-                if (!new_list) {
-                    return 1;
-                }
-                // the initial stack list should always be initiated with
-                // MAX_2BYTE_INDEX uint16_t entries.
-                // When copying from the initial stack list, we must assume it was
-                // created with fixed-size entries.
-                memcpy(new_list, results->list, results->list_size * sizeof(uint16_t));
-                results->list_created = true;
+            if (analyze_reserve(results, idx + 1, idx) != 0) {
+                return 1;
             }
-            results->list = new_list;
-            results->list_capacity = new_capacity;
             list_pointer = results->list + checkpoints_entry_offset(results->list_size + config.list_start_idx);
         }
 
@@ -174,21 +254,297 @@ uint8_t str8_analyze(
         results->list_size++; 
     }
 
+    if (width && results->size % width != 0) {
+        // max_bytes cut the last character
+        if (analyze_fill_skipped(results, width, G) != 0) {
+            return 1;
+        }
+        width = 0;
+    }
+    results->width = width;
     return 0;
 }
 
-size_t checkpoints_list_total_size(size_t capacity) {
-    return checkpoints_entry_offset(capacity/CHECKPOINTS_GRANULARITY);
+size_t checkpoints_list_total_size(size_t capacity, size_t granularity) {
+    size_t count = capacity/granularity;
+    // short lists keep their entries on the grid and do without a tail record
+    size_t tail_size = count >= CHECKPOINTS_TAIL_MIN_COUNT ? CHECKPOINTS_TAIL_SIZE : 0;
+    return count ? tail_size + checkpoints_entry_offset(count) : 0;
 }
 
 void *checkpoints_list_ptr(str8 str) {
     return checkpoints_list(str);
 }
 
+checkpoints_tail checkpoints_read_tail(void *list) {
+    uint64_t record[2];
+    memcpy(record, (char*)list - CHECKPOINTS_TAIL_SIZE, sizeof(record));
+    return (checkpoints_tail){ (size_t)record[0], (size_t)record[1] };
+}
+
+void checkpoints_write_tail(void *list, checkpoints_tail tail) {
+    uint64_t record[2] = { tail.first, tail.offset };
+    memcpy((char*)list - CHECKPOINTS_TAIL_SIZE, record, sizeof(record));
+}
+
+/** @brief Return the tail of a list with count entries (lists without a record are on the grid). */
+STATIC INLINE checkpoints_tail list_tail(void *list, size_t count) {
+    return count >= CHECKPOINTS_TAIL_MIN_COUNT ? checkpoints_read_tail(list) : (checkpoints_tail){ 0, 0 };
+}
+
+/** @brief Return the byte position of entry idx (see checkpoints_tail). */
+STATIC INLINE size_t entry_pos(checkpoints_tail tail, size_t idx, size_t shift) {
+    return ((idx + 1) << shift) - (idx >= tail.first ? tail.offset : 0);
+}
+
+/** @brief Return the number of entries of a list with count entries at positions <= pos. */
+STATIC INLINE size_t entries_up_to(checkpoints_tail tail, size_t pos, size_t count, size_t shift) {
+    size_t n = pos >> shift;
+    if (n >= tail.first) {
+        // all grid entries are in front of pos
+        n = (pos + tail.offset) >> shift;
+    }
+    return n < count ? n : count;
+}
+
+size_t checkpoints_entry_pos(void *list, size_t count, size_t idx, size_t granularity) {
+    return entry_pos(list_tail(list, count), idx, (size_t)__builtin_ctzll(granularity));
+}
+
+/**
+ * @brief Return a pointer to the character anchors of str or NULL if it has none.
+ *
+ * The anchor j is the byte offset of the character (j + 1) * k, k being the
+ * granularity of str. The entries have the size of the header fields.
+ */
+STATIC INLINE void *anchors_list(str8 str) {
+    if (STR8_INDEX(str) != STR8_INDEX_CHARS || STR8_IS_ASCII(str)) {
+        return NULL;
+    }
+    uint8_t type = STR8_TYPE(str);
+    size_t total_size = checkpoints_anchors_total_size(type, str8cap(str), STR8_GRANULARITY(str));
+    // there always is a descriptor byte
+    return ((char*)str) - (2 + 3 * STR8_FIELD_SIZE(type)) - total_size;
+}
+
+STATIC INLINE size_t read_anchor(void *anchors, uint8_t type, size_t idx) {
+    switch (type) {
+        case STR8_TYPE2:
+            return ((uint16_t*)anchors)[idx];
+        case STR8_TYPE4:
+            return ((uint32_t*)anchors)[idx];
+        default:
+            return ((uint64_t*)anchors)[idx];
+    }
+}
+
+STATIC INLINE void write_anchor(void *anchors, uint8_t type, size_t idx, size_t value) {
+    switch (type) {
+        case STR8_TYPE2:
+            ((uint16_t*)anchors)[idx] = (uint16_t)value;
+            break;
+        case STR8_TYPE4:
+            ((uint32_t*)anchors)[idx] = (uint32_t)value;
+            break;
+        default:
+            ((uint64_t*)anchors)[idx] = (uint64_t)value;
+            break;
+    }
+}
+
+size_t checkpoints_anchors_total_size(uint8_t type, size_t capacity, size_t k) {
+    return capacity / k * STR8_FIELD_SIZE(type);
+}
+
+void *checkpoints_anchors_ptr(str8 str) {
+    return anchors_list(str);
+}
+
+void checkpoints_fill_anchors(str8 str, size_t byte_pos, size_t char_idx) {
+    void *anchors = anchors_list(str);
+    uint8_t type = STR8_TYPE(str);
+    size_t shift = STR8_GRANULARITY_SHIFT(str);
+    size_t size = str8size(str);
+    size_t length = str8len(str);
+    // the character of the first anchor at or behind char_idx, which does
+    // not exist yet if the string ended at char_idx (appending)
+    size_t k = (size_t)1 << shift;
+    size_t next = (char_idx + k - 1) >> shift << shift;
+    next = next < k ? k : next;
+    for (; next < length; next += k) {
+        byte_pos = lookup_idx(str + byte_pos, size - byte_pos, next - char_idx) - str;
+        char_idx = next;
+        write_anchor(anchors, type, (next >> shift) - 1, byte_pos);
+    }
+}
+
+/** @brief Return a pointer to the idx' character of str (idx < str8len(str)) using its anchors. */
+STATIC INLINE const char *anchors_lookup(str8 str, size_t size, size_t idx) {
+    size_t shift = STR8_GRANULARITY_SHIFT(str);
+    size_t anchor = idx >> shift;
+    if (anchor == 0) {
+        return lookup_idx(str, size, idx);
+    }
+    size_t byte_pos = read_anchor(anchors_list(str), STR8_TYPE(str), anchor - 1);
+    return lookup_idx(str + byte_pos, size - byte_pos, idx - (anchor << shift));
+}
+
+/** @brief Return the number of characters in the first pos bytes of str using its anchors. */
+STATIC INLINE size_t anchors_count_chars_to(str8 str, size_t pos) {
+    void *anchors = anchors_list(str);
+    uint8_t type = STR8_TYPE(str);
+    size_t shift = STR8_GRANULARITY_SHIFT(str);
+    size_t length = str8len(str);
+    size_t count = length ? (length - 1) >> shift : 0;
+    // number of anchors <= pos
+    size_t l = 0;
+    size_t r = count;
+    while (l < r) {
+        size_t mid = l + (r - l) / 2;
+        if (read_anchor(anchors, type, mid) <= pos) {
+            l = mid + 1;
+        }
+        else {
+            r = mid;
+        }
+    }
+    if (l == 0) {
+        return count_chars(str, pos);
+    }
+    size_t byte_pos = read_anchor(anchors, type, l - 1);
+    return (l << shift) + count_chars(str + byte_pos, pos - byte_pos);
+}
+
+/** @brief Return the number of superblocks of a two-level index with count blocks. */
+STATIC INLINE size_t twolevel_superblock_count(size_t count) {
+    return (count + STR8_TWOLEVEL_BLOCKS - 1) / STR8_TWOLEVEL_BLOCKS;
+}
+
+/**
+ * @brief Return a pointer to the relative block counts of str or NULL if it
+ *        has no two-level index.
+ *
+ * The superblock counts follow the block counts.
+ */
+STATIC INLINE uint16_t *twolevel_blocks(str8 str) {
+    if (STR8_INDEX(str) != STR8_INDEX_TWOLEVEL || STR8_IS_ASCII(str)) {
+        return NULL;
+    }
+    uint8_t type = STR8_TYPE(str);
+    size_t total_size = checkpoints_twolevel_total_size(type, str8cap(str), STR8_GRANULARITY(str));
+    // there always is a descriptor byte
+    return (uint16_t*)(((char*)str) - (2 + 3 * STR8_FIELD_SIZE(type)) - total_size);
+}
+
+/** @brief Return a pointer to the superblock counts of str, blocks being twolevel_blocks(str). */
+STATIC INLINE void *twolevel_superblocks(str8 str, uint16_t *blocks) {
+    return blocks + (str8cap(str) >> STR8_GRANULARITY_SHIFT(str));
+}
+
+size_t checkpoints_twolevel_total_size(uint8_t type, size_t capacity, size_t granularity) {
+    size_t count = capacity / granularity;
+    return count * sizeof(uint16_t) + twolevel_superblock_count(count) * STR8_FIELD_SIZE(type);
+}
+
+void *checkpoints_twolevel_ptr(str8 str) {
+    return twolevel_blocks(str);
+}
+
+void checkpoints_fill_twolevel(str8 str, size_t byte_pos, size_t char_idx) {
+    uint16_t *blocks = twolevel_blocks(str);
+    void *superblocks = twolevel_superblocks(str, blocks);
+    uint8_t type = STR8_TYPE(str);
+    size_t shift = STR8_GRANULARITY_SHIFT(str);
+    size_t count = str8size(str) >> shift;
+    // start at the block containing byte_pos, its superblock is in front of it
+    size_t idx = byte_pos >> shift;
+    size_t pos = idx << shift;
+    size_t chars = char_idx - count_chars(str + pos, byte_pos - pos);
+    size_t superblock = idx / STR8_TWOLEVEL_BLOCKS;
+    size_t base = idx % STR8_TWOLEVEL_BLOCKS ? read_anchor(superblocks, type, superblock) : chars;
+    for (; idx<count; idx++) {
+        if (idx % STR8_TWOLEVEL_BLOCKS == 0) {
+            superblock = idx / STR8_TWOLEVEL_BLOCKS;
+            base = chars;
+            write_anchor(superblocks, type, superblock, base);
+        }
+        chars += count_chars(str + pos, (size_t)1 << shift);
+        pos += (size_t)1 << shift;
+        blocks[idx] = (uint16_t)(chars - base);
+    }
+}
+
+/** @brief Return a pointer to the idx' character of str (idx < str8len(str)) using its two-level index. */
+STATIC INLINE const char *twolevel_lookup(str8 str, size_t size, size_t idx) {
+    uint16_t *blocks = twolevel_blocks(str);
+    void *superblocks = twolevel_superblocks(str, blocks);
+    uint8_t type = STR8_TYPE(str);
+    size_t shift = STR8_GRANULARITY_SHIFT(str);
+    size_t count = size >> shift;
+    if (count == 0) {
+        return lookup_idx(str, size, idx);
+    }
+
+    // last superblock starting in front of idx (the first one has 0)
+    size_t l = 0;
+    size_t r = twolevel_superblock_count(count);
+    while (r - l > 1) {
+        size_t mid = l + (r - l) / 2;
+        if (read_anchor(superblocks, type, mid) <= idx) {
+            l = mid;
+        }
+        else {
+            r = mid;
+        }
+    }
+
+    // count the blocks ending in front of idx, the entries are sorted and
+    // there are at most STR8_TWOLEVEL_BLOCKS, so a scan without branches
+    // beats a binary search
+    size_t first = l * STR8_TWOLEVEL_BLOCKS;
+    size_t n = count - first < STR8_TWOLEVEL_BLOCKS ? count - first : STR8_TWOLEVEL_BLOCKS;
+    size_t base = read_anchor(superblocks, type, l);
+    size_t rel = idx - base;
+    uint16_t rel16 = rel > UINT16_MAX ? UINT16_MAX : (uint16_t)rel;
+    const uint16_t *superblock_blocks = blocks + first;
+    size_t found = 0;
+    for (size_t k=0; k<n; k++) {
+        found += superblock_blocks[k] <= rel16;
+    }
+
+    size_t byte_pos = (first + found) << shift;
+    size_t idx_offset = base + (found ? superblock_blocks[found - 1] : 0);
+    return lookup_idx(str + byte_pos, size - byte_pos, idx - idx_offset);
+}
+
+/** @brief Return the number of characters in the first pos bytes of str using its two-level index. */
+STATIC INLINE size_t twolevel_count_chars_to(str8 str, size_t pos) {
+    uint16_t *blocks = twolevel_blocks(str);
+    size_t shift = STR8_GRANULARITY_SHIFT(str);
+    size_t n = pos >> shift;
+    if (n == 0) {
+        return count_chars(str, pos);
+    }
+    size_t last = n - 1;
+    size_t chars = read_anchor(twolevel_superblocks(str, blocks), STR8_TYPE(str), last / STR8_TWOLEVEL_BLOCKS) +
+                   blocks[last];
+    return chars + count_chars(str + (n << shift), pos - (n << shift));
+}
+
+/** @brief Return a pointer to the idx' character of str (idx < str8len(str)) using its anchors or two-level index. */
+STATIC INLINE const char *index_lookup(str8 str, size_t size, size_t idx, uint8_t index) {
+    return index == STR8_INDEX_CHARS ? anchors_lookup(str, size, idx) : twolevel_lookup(str, size, idx);
+}
+
+size_t checkpoints_read_entry(void *list, size_t idx) {
+    return read_entry(list, idx);
+}
+
 /**
  * @brief Return the list index of the entry with the highest value less upper_bound. 
  * 
- * Perform a upper-bound binary search on list.
+ * Perform a upper-bound binary search on list. Lists within the u16 zone are
+ * scanned with count_le_u16() instead, which has no unpredictable branches.
  * 
  * @param list Pointer to the beginn of the list.
  * @param table_count Number of elements in list.
@@ -199,6 +555,12 @@ STATIC size_t find_entry_ub(void *list, size_t list_count, size_t upper_bound) {
     if (list_count == 0) {
         return 0;
     }
+    if (list_count <= MAX_2BYTE_INDEX + 1) {
+        // the entries are a plain u16 array, count the ones <= upper_bound
+        uint16_t bound = upper_bound > UINT16_MAX ? UINT16_MAX : (uint16_t)upper_bound;
+        size_t count = count_le_u16((const uint16_t*)list, list_count, bound);
+        return count ? count - 1 : list_count;
+    }
     size_t l = 0;
     size_t r = list_count;
     size_t result_idx = list_count;
@@ -216,6 +578,720 @@ STATIC size_t find_entry_ub(void *list, size_t list_count, size_t upper_bound) {
     return result_idx;
 }
 
+/**
+ * @brief Like find_entry_ub(), but start with an exponential search at from.
+ *
+ * The entry at from must be <= upper_bound (or from == list_count, which
+ * falls back to a full search). This is cheap if the result is close to from.
+ */
+STATIC size_t find_entry_ub_from(void *list, size_t list_count, size_t from, size_t upper_bound) {
+    if (from >= list_count) {
+        return find_entry_ub(list, list_count, upper_bound);
+    }
+    size_t l = from;
+    size_t r = from + 1;
+    size_t step = 1;
+    while (r < list_count && read_entry(list, r) <= upper_bound) {
+        l = r;
+        r += step;
+        step *= 2;
+    }
+    if (r > list_count) {
+        r = list_count;
+    }
+    // entries[l] <= upper_bound < entries[r]
+    while (l + 1 < r) {
+        size_t mid = l + (r - l) / 2;
+        if (read_entry(list, mid) <= upper_bound) {
+            l = mid;
+        }
+        else {
+            r = mid;
+        }
+    }
+    return l;
+}
+
+/**
+ * @brief Like find_entry_ub(), but start with an exponential search at guess.
+ *
+ * The search gallops upwards or downwards from guess, depending on the
+ * entry at guess. This takes O(log d) probes, d being the distance between
+ * guess and the result.
+ */
+STATIC size_t find_entry_ub_near(void *list, size_t list_count, size_t guess, size_t upper_bound) {
+    if (list_count == 0) {
+        return 0;
+    }
+    if (guess >= list_count) {
+        guess = list_count - 1;
+    }
+    if (read_entry(list, guess) <= upper_bound) {
+        return find_entry_ub_from(list, list_count, guess, upper_bound);
+    }
+    size_t l;
+    size_t r = guess;
+    size_t step = 1;
+    while (1) {
+        if (r < step) {
+            if (read_entry(list, 0) > upper_bound) {
+                return list_count;
+            }
+            l = 0;
+            break;
+        }
+        l = r - step;
+        if (read_entry(list, l) <= upper_bound) {
+            break;
+        }
+        r = l;
+        step *= 2;
+    }
+    // entries[l] <= upper_bound < entries[r]
+    while (l + 1 < r) {
+        size_t mid = l + (r - l) / 2;
+        if (read_entry(list, mid) <= upper_bound) {
+            l = mid;
+        }
+        else {
+            r = mid;
+        }
+    }
+    return l;
+}
+
+/** @brief Return the number of characters in the first pos bytes of str. */
+STATIC INLINE size_t count_chars_to(str8 str, void *list, size_t list_count, size_t pos) {
+    size_t shift = STR8_GRANULARITY_SHIFT(str);
+    checkpoints_tail tail = list_tail(list, list_count);
+    size_t n = entries_up_to(tail, pos, list_count, shift);
+    size_t prev = n ? entry_pos(tail, n - 1, shift) : 0;
+    if (n < list_count) {
+        size_t next = entry_pos(tail, n, shift);
+        if (next - pos < pos - prev) {
+            // counting back from the next checkpoint is shorter
+            return read_entry(list, n) - count_chars(str + pos, next - pos);
+        }
+    }
+    return (n ? read_entry(list, n - 1) : 0) + count_chars(str + prev, pos - prev);
+}
+
+void checkpoints_copy_range_to(void *list, size_t out_pos, size_t out_chars,
+                               str8 str, size_t byte_start, size_t char_start, size_t size,
+                               size_t granularity) {
+    void *parent_list = checkpoints_list(str);
+    bool parent_anchors = anchors_list(str) != NULL;
+    bool parent_twolevel = twolevel_blocks(str) != NULL;
+    size_t parent_count = str8size(str) >> STR8_GRANULARITY_SHIFT(str);
+    bool ascii = STR8_TYPE(str) != STR8_TYPE0 && STR8_IS_ASCII(str);
+    size_t width = STR8_WIDTH(str);
+    size_t first = out_pos / granularity;
+    size_t last = (out_pos + size) / granularity;
+    // last position counted if str has no list
+    size_t counted_pos = byte_start;
+    size_t counted_chars = char_start;
+    for (size_t idx=first; idx<last; idx++) {
+        size_t pos = byte_start + (idx + 1) * granularity - out_pos;
+        size_t chars;
+        if (parent_list) {
+            chars = count_chars_to(str, parent_list, parent_count, pos);
+        }
+        else if (parent_anchors) {
+            chars = anchors_count_chars_to(str, pos);
+        }
+        else if (parent_twolevel) {
+            chars = twolevel_count_chars_to(str, pos);
+        }
+        else if (width) {
+            chars = (pos + width - 1) / width;
+        }
+        else if (ascii) {
+            chars = pos;
+        }
+        else {
+            // short enough to not have a list or without index
+            counted_chars += count_chars(str + counted_pos, pos - counted_pos);
+            counted_pos = pos;
+            chars = counted_chars;
+        }
+        write_entry(list, idx, out_chars + chars - char_start);
+    }
+}
+
+size_t checkpoints_count_range(void *list, const char *str, size_t from, size_t to, size_t chars,
+                               size_t granularity) {
+    size_t next = (from / granularity + 1) * granularity;
+    for (; next <= to; next += granularity) {
+        chars += count_chars(str + from, next - from);
+        write_entry(list, next / granularity - 1, chars);
+        from = next;
+    }
+    return chars + count_chars(str + from, to - from);
+}
+
+void checkpoints_fill_ascii(void *list, size_t from, size_t to, size_t granularity) {
+    for (size_t idx=from; idx<to; idx++) {
+        write_entry(list, idx, (idx + 1) * granularity);
+    }
+}
+
+void checkpoints_fill_uniform(void *list, size_t from, size_t to, size_t width, size_t granularity) {
+    for (size_t idx=from; idx<to; idx++) {
+        // characters starting in front of the checkpoint
+        write_entry(list, idx, ((idx + 1) * granularity + width - 1) / width);
+    }
+}
+
+size_t str8_uniform_width(const char *str, size_t size, size_t length) {
+    if (length == 0 || size % length != 0) {
+        return 0;
+    }
+    size_t width = size / length;
+    if (width < 2 || width > 4) {
+        return 0;
+    }
+    // lead byte of a sequence of width bytes
+    unsigned char mask = width == 2 ? 0xE0 : width == 3 ? 0xF0 : 0xF8;
+    unsigned char lead = (unsigned char)(mask << 1);
+    // If every width' byte is such a lead byte, there are length of them,
+    // so all other bytes are continuation bytes.
+    for (size_t pos=0; pos<size; pos+=width) {
+        if (((unsigned char)str[pos] & mask) != lead) {
+            return 0;
+        }
+    }
+    return width;
+}
+
+void checkpoints_add(void *list, size_t from, size_t to, size_t delta) {
+    // Entries of one size are stored contiguously, so each zone is a plain
+    // array the compiler can vectorize. delta is added modulo 2^N, so
+    // "negative" values work as well.
+    size_t idx = from;
+    uint16_t *list2 = (uint16_t*)list;
+    for (; idx < to && idx <= MAX_2BYTE_INDEX; idx++) {
+        list2[idx] += (uint16_t)delta;
+    }
+    uint32_t *list4 = (uint32_t*)((char*)list + checkpoints_entry_offset(MAX_2BYTE_INDEX));
+    for (; idx < to && idx <= MAX_4BYTE_INDEX; idx++) {
+        list4[idx - MAX_2BYTE_INDEX] += (uint32_t)delta;
+    }
+    uint64_t *list8 = (uint64_t*)((char*)list + checkpoints_entry_offset(MAX_4BYTE_INDEX));
+    for (; idx < to; idx++) {
+        list8[idx - MAX_4BYTE_INDEX] += (uint64_t)delta;
+    }
+}
+
+/** @brief Return the first index of the zone (of entries with one size) of idx. */
+STATIC INLINE size_t zone_begin(size_t idx) {
+    return idx <= MAX_2BYTE_INDEX ? 0 : idx <= MAX_4BYTE_INDEX ? MAX_2BYTE_INDEX + 1 : MAX_4BYTE_INDEX + 1;
+}
+
+/** @brief Return the first index behind the zone of idx. */
+STATIC INLINE size_t zone_end(size_t idx) {
+    return idx <= MAX_2BYTE_INDEX ? MAX_2BYTE_INDEX + 1 : idx <= MAX_4BYTE_INDEX ? MAX_4BYTE_INDEX + 1 : SIZE_MAX;
+}
+
+/** @brief Return the size of entry idx in bytes. */
+STATIC INLINE size_t entry_size(size_t idx) {
+    return idx <= MAX_2BYTE_INDEX ? sizeof(uint16_t) : idx <= MAX_4BYTE_INDEX ? sizeof(uint32_t) : sizeof(uint64_t);
+}
+
+/** @brief Move the entries [from, to) (within one zone) of list to from + k in dest and add delta to them. */
+STATIC INLINE void move_chunk(void *dest, void *list, size_t from, size_t to, ptrdiff_t k, size_t delta) {
+    size_t dest_idx = from + (size_t)k;
+    if (entry_size(from) == entry_size(dest_idx)) {
+        memmove(checkpoints_entry(dest, dest_idx), checkpoints_entry(list, from), (to - from) * entry_size(from));
+        checkpoints_add(dest, dest_idx, dest_idx + (to - from), delta);
+    }
+    else if (k > 0) {
+        for (size_t idx=to; idx-- > from;) {
+            write_entry(dest, idx + (size_t)k, read_entry(list, idx) + delta);
+        }
+    }
+    else {
+        for (size_t idx=from; idx<to; idx++) {
+            write_entry(dest, idx + (size_t)k, read_entry(list, idx) + delta);
+        }
+    }
+}
+
+/**
+ * @brief Move the entries [from, to) of list to from + k in dest and add
+ *        delta (modulo 2^N) to them.
+ *
+ * dest may be list itself. The entries are moved in chunks whose sources and
+ * destinations are in one zone each, so most of them are moved with memmove()
+ * and updated with checkpoints_add(). Only the |k| entries moving into another
+ * zone are converted one by one.
+ */
+STATIC void checkpoints_move(void *dest, void *list, size_t from, size_t to, ptrdiff_t k, size_t delta) {
+    if (k == 0 && dest == list) {
+        checkpoints_add(list, from, to, delta);
+    }
+    else if (k > 0) {
+        // move up, starting with the last entries
+        while (to > from) {
+            size_t begin = zone_begin(to - 1);
+            size_t dest_begin = zone_begin(to - 1 + (size_t)k);
+            begin = begin > from ? begin : from;
+            if (dest_begin > begin + (size_t)k) {
+                begin = dest_begin - (size_t)k;
+            }
+            move_chunk(dest, list, begin, to, k, delta);
+            to = begin;
+        }
+    }
+    else {
+        size_t distance = (size_t)-k;
+        while (from < to) {
+            size_t end = zone_end(from);
+            size_t dest_end = zone_end(from - distance);
+            end = end < to ? end : to;
+            if (dest_end < end - distance) {
+                end = dest_end + distance;
+            }
+            move_chunk(dest, list, from, end, k, delta);
+            from = end;
+        }
+    }
+}
+
+/**
+ * @brief Write the entries [from, to) of list at the positions of tail.
+ *
+ * The counting starts at the byte *pos with chars characters in front of it.
+ * Entries in front of *pos are counted back from it, the other ones forward,
+ * moving *pos to them.
+ *
+ * @returns The number of characters in front of *pos.
+ */
+STATIC size_t count_entries(void *list, const char *str, checkpoints_tail tail, size_t from, size_t to,
+                            size_t *pos, size_t chars, size_t shift) {
+    size_t counted = *pos;
+    for (size_t idx=from; idx<to; idx++) {
+        size_t entry = entry_pos(tail, idx, shift);
+        if (entry < counted) {
+            write_entry(list, idx, chars - count_chars(str + entry, counted - entry));
+            continue;
+        }
+        chars += count_chars(str + counted, entry - counted);
+        counted = entry;
+        write_entry(list, idx, chars);
+    }
+    *pos = counted;
+    return chars;
+}
+
+size_t checkpoints_reindex(void *list, const char *str, size_t size,
+                           size_t byte_start, size_t byte_end, size_t length, size_t granularity) {
+    size_t shift = (size_t)__builtin_ctzll(granularity);
+    size_t count = size >> shift;
+    checkpoints_tail tail = list_tail(list, count);
+    // the characters at both ends of the range are counted from the
+    // unmodified bytes in front of and behind it
+    size_t before = entries_up_to(tail, byte_start, count, shift);
+    size_t pos = before ? entry_pos(tail, before - 1, shift) : 0;
+    size_t char_start = (before ? read_entry(list, before - 1) : 0) + count_chars(str + pos, byte_start - pos);
+    size_t after = entries_up_to(tail, byte_end - 1, count, shift);
+    size_t old_char_end;
+    if (after < count) {
+        size_t next = entry_pos(tail, after, shift);
+        old_char_end = read_entry(list, after) - count_chars(str + byte_end, next - byte_end);
+    }
+    else {
+        old_char_end = length - count_chars(str + byte_end, size - byte_end);
+    }
+    checkpoints_edit edit = {
+        .byte_start = byte_start,
+        .old_byte_end = byte_end,
+        .new_byte_end = byte_end,
+        .char_start = char_start,
+        .old_char_end = old_char_end,
+        .new_char_end = char_start + count_chars(str + byte_start, byte_end - byte_start)
+    };
+    checkpoints_apply_edit(list, str, size, size, &edit, granularity);
+    return length - edit.old_char_end + edit.new_char_end;
+}
+
+/** @brief Return the offset of entries with offset s after they moved by d bytes. */
+STATIC INLINE size_t moved_offset(size_t s, ptrdiff_t d, size_t G) {
+    return (s - (size_t)d) & (G - 1);
+}
+
+/** @brief Return the number of indices entries with offset s move by when their bytes move by d (see moved_offset()). */
+STATIC INLINE ptrdiff_t moved_entries(size_t s, ptrdiff_t d, size_t G) {
+    return (d - (ptrdiff_t)s + (ptrdiff_t)moved_offset(s, d, G)) / (ptrdiff_t)G;
+}
+
+/** @brief Return the number of bytes rebase_entries() counts per entry for entries e bytes off. */
+STATIC INLINE size_t rebase_cost(ptrdiff_t e, size_t G) {
+    size_t distance = e < 0 ? (size_t)-e : (size_t)e;
+    return distance <= G / 2 ? distance : G - distance;
+}
+
+/**
+ * @brief Correct the entries [from, to) of list, which are e bytes behind
+ *        (or in front of, if e < 0) their positions at tail.
+ *
+ * Only the e bytes are counted, or the granularity - e bytes from the
+ * neighbour entry, whichever is less. The positions of the entries need to
+ * be granularity bytes apart.
+ */
+STATIC void rebase_entries(void *list, const char *str, checkpoints_tail tail, size_t from, size_t to,
+                           ptrdiff_t e, size_t shift) {
+    const size_t G = (size_t)1 << shift;
+    if (e > 0) {
+        size_t distance = (size_t)e;
+        // the previous entry is read before it is corrected
+        for (size_t idx=to; idx-- > from;) {
+            size_t pos = entry_pos(tail, idx, shift);
+            if (distance <= G / 2 || idx == from) {
+                write_entry(list, idx, read_entry(list, idx) - count_chars(str + pos, distance));
+            }
+            else {
+                size_t prev = pos + distance - G;
+                write_entry(list, idx, read_entry(list, idx - 1) + count_chars(str + prev, G - distance));
+            }
+        }
+    }
+    else if (e < 0) {
+        size_t distance = (size_t)-e;
+        // the next entry is read before it is corrected
+        for (size_t idx=from; idx<to; idx++) {
+            size_t pos = entry_pos(tail, idx, shift);
+            if (distance <= G / 2 || idx + 1 == to) {
+                write_entry(list, idx, read_entry(list, idx) + count_chars(str + pos - distance, distance));
+            }
+            else {
+                write_entry(list, idx, read_entry(list, idx + 1) - count_chars(str + pos, G - distance));
+            }
+        }
+    }
+}
+
+void checkpoints_apply_edit(void *list, const char *str, size_t old_size, size_t new_size,
+                            const checkpoints_edit *edit, size_t granularity) {
+    const size_t G = granularity;
+    const size_t shift = (size_t)__builtin_ctzll(G);
+    size_t old_count = old_size >> shift;
+    size_t new_count = new_size >> shift;
+    checkpoints_tail tail = list_tail(list, old_count);
+    // the entries in front of f are on the grid, the other ones have offset o
+    size_t f = tail.offset && tail.first < old_count ? tail.first : old_count;
+    size_t o = f < old_count ? tail.offset : 0;
+    // entries in front of a are kept, the ones starting at t are behind the edit
+    size_t a = entries_up_to(tail, edit->byte_start, old_count, shift);
+    size_t t = edit->old_byte_end ? entries_up_to(tail, edit->old_byte_end - 1, old_count, shift) : 0;
+    t = t > a ? t : a;
+    ptrdiff_t d = (ptrdiff_t)(edit->new_byte_end - edit->old_byte_end);
+
+    if (new_count < CHECKPOINTS_TAIL_MIN_COUNT) {
+        // without a tail record all entries are on the grid, so the ones
+        // behind the edit (and the kept ones with offset) are counted again
+        size_t from = f < a ? f : a;
+        size_t pos = from ? entry_pos(tail, from - 1, shift) : 0;
+        size_t chars = from ? read_entry(list, from - 1) : 0;
+        count_entries(list, str, (checkpoints_tail){ 0, 0 }, from, new_count, &pos, chars, shift);
+        return;
+    }
+
+    // 1.  Choose the new tail. The entries behind the edit move with their
+    //     bytes by k indices, so they get the tail. The list has one offset
+    //     only, so if the entries behind the edit or the ones in front of it
+    //     have two different offsets, the entries of one group end up e bytes
+    //     off their new positions and are rebased, whichever costs less.
+
+    ptrdiff_t k;
+    checkpoints_tail new_tail;
+    ptrdiff_t rebase_from = 0;
+    ptrdiff_t rebase_to = 0;
+    ptrdiff_t e = 0;
+    // the rebased entries are kept ones (or moved ones)
+    bool rebase_kept = false;
+    // the tail starts with the first moved entry t + k
+    bool first_moved = true;
+    if ((d & (ptrdiff_t)(G - 1)) == 0) {
+        // the offsets do not change
+        k = d / (ptrdiff_t)G;
+        new_tail.offset = o;
+        new_tail.first = t + (size_t)k;
+        if (f <= a || f > t) {
+            new_tail.first = f <= a ? f : f + (size_t)k;
+            first_moved = false;
+        }
+    }
+    else if (o == 0 || (a <= f && f <= t)) {
+        // the entries in front of the edit are on the grid, all the ones behind it have offset o
+        new_tail.offset = moved_offset(o, d, G);
+        k = moved_entries(o, d, G);
+        new_tail.first = t + (size_t)k;
+    }
+    else if (f > t) {
+        // the entries behind the edit are on the grid up to f
+        size_t tail_offset = moved_offset(o, d, G);
+        ptrdiff_t grid_e = (ptrdiff_t)o - (ptrdiff_t)tail_offset;
+        if ((f - t) * rebase_cost(grid_e, G) <= (old_count - f) * rebase_cost((ptrdiff_t)o, G)) {
+            // the entries with offset keep their values, the ones in front of them stay on the grid
+            new_tail.offset = tail_offset;
+            k = moved_entries(o, d, G);
+            new_tail.first = f + (size_t)k;
+            first_moved = false;
+            rebase_from = (ptrdiff_t)t + k;
+            rebase_to = (ptrdiff_t)f + k;
+            e = grid_e;
+        }
+        else {
+            // the entries on the grid keep their values
+            new_tail.offset = moved_offset(0, d, G);
+            k = moved_entries(0, d, G);
+            new_tail.first = t + (size_t)k;
+            rebase_from = (ptrdiff_t)f + k;
+            rebase_to = (ptrdiff_t)old_count + k;
+            e = -(ptrdiff_t)o;
+        }
+    }
+    else {
+        // the entries in front of the edit have offset o from f on, the
+        // moved ones could keep it if they move by whole blocks
+        ptrdiff_t kept_k = moved_entries(G / 2, d, G);
+        ptrdiff_t kept_e = d - kept_k * (ptrdiff_t)G;
+        if ((a - f) * rebase_cost((ptrdiff_t)o, G) <= (old_count - t) * rebase_cost(kept_e, G)) {
+            // the entries behind the edit keep their values, the ones in front of it go back to the grid
+            new_tail.offset = moved_offset(o, d, G);
+            k = moved_entries(o, d, G);
+            new_tail.first = t + (size_t)k;
+            rebase_from = (ptrdiff_t)f;
+            rebase_to = (ptrdiff_t)a;
+            e = -(ptrdiff_t)o;
+            rebase_kept = true;
+        }
+        else {
+            // the tail is kept
+            new_tail = tail;
+            first_moved = false;
+            k = kept_k;
+            rebase_from = (ptrdiff_t)t + k;
+            rebase_to = (ptrdiff_t)old_count + k;
+            e = kept_e;
+        }
+    }
+    // entries moving in front of the string or behind the list are dropped
+    ptrdiff_t dest_from = (ptrdiff_t)t + k;
+    ptrdiff_t dest_to = (ptrdiff_t)old_count + k;
+    dest_from = dest_from > 0 ? dest_from : 0;
+    dest_to = dest_to < (ptrdiff_t)new_count ? dest_to : (ptrdiff_t)new_count;
+    if (dest_from >= dest_to && first_moved) {
+        // nothing is moved, the tail starts behind the kept entries
+        ptrdiff_t first = (ptrdiff_t)t + k;
+        new_tail.first = first > (ptrdiff_t)a ? (size_t)first : a;
+    }
+    if (new_tail.offset == 0 || new_tail.first >= new_count) {
+        new_tail = (checkpoints_tail){ 0, 0 };
+    }
+    rebase_from = rebase_from > 0 ? rebase_from : 0;
+    rebase_to = rebase_to < (ptrdiff_t)new_count ? rebase_to : (ptrdiff_t)new_count;
+    if (rebase_kept) {
+        // kept entries the moved ones end up on are replaced by them
+        rebase_to = rebase_to < (ptrdiff_t)t + k ? rebase_to : (ptrdiff_t)t + k;
+        if (rebase_from < rebase_to) {
+            rebase_entries(list, str, new_tail, (size_t)rebase_from, (size_t)rebase_to, e, shift);
+        }
+    }
+
+    // 2.  Entries behind the edit are moved.
+
+    size_t moved_from, moved_to;
+    if (dest_from < dest_to) {
+        checkpoints_move(list, list, (size_t)(dest_from - k), (size_t)(dest_to - k), k,
+                         edit->new_char_end - edit->old_char_end);
+        moved_from = (size_t)dest_from;
+        moved_to = (size_t)dest_to;
+    }
+    else {
+        moved_from = (size_t)dest_from > a ? (size_t)dest_from : a;
+        moved_from = moved_from < new_count ? moved_from : new_count;
+        moved_to = moved_from;
+    }
+    if (!rebase_kept && rebase_from < rebase_to) {
+        rebase_entries(list, str, new_tail, (size_t)rebase_from, (size_t)rebase_to, e, shift);
+    }
+
+    // 3.  The entries in between and behind the moved ones are counted.
+
+    size_t pos = edit->byte_start;
+    count_entries(list, str, new_tail, a, moved_from, &pos, edit->char_start, shift);
+    if (moved_to < new_count) {
+        pos = moved_to ? entry_pos(new_tail, moved_to - 1, shift) : 0;
+        size_t chars = moved_to ? read_entry(list, moved_to - 1) : 0;
+        count_entries(list, str, new_tail, moved_to, new_count, &pos, chars, shift);
+    }
+    checkpoints_write_tail(list, new_tail);
+}
+
+size_t checkpoints_append(void *list, const char *str, size_t old_size, size_t new_size,
+                          size_t length, size_t granularity) {
+    size_t shift = (size_t)__builtin_ctzll(granularity);
+    size_t old_count = old_size >> shift;
+    size_t new_count = new_size >> shift;
+    checkpoints_tail tail = list_tail(list, old_count);
+    size_t pos = old_size;
+    size_t chars = count_entries(list, str, tail, old_count, new_count, &pos, length, shift);
+    if (new_count >= CHECKPOINTS_TAIL_MIN_COUNT && old_count < CHECKPOINTS_TAIL_MIN_COUNT) {
+        // the list gets a record
+        checkpoints_write_tail(list, tail);
+    }
+    return chars + count_chars(str + pos, new_size - pos);
+}
+
+void checkpoints_copy_range(void *list, str8 str, size_t byte_start, size_t char_start, size_t size) {
+    void *parent_list = checkpoints_list(str);
+    if (!parent_list) {
+        checkpoints_copy_range_to(list, 0, 0, str, byte_start, char_start, size, STR8_GRANULARITY(str));
+        return;
+    }
+    const size_t shift = STR8_GRANULARITY_SHIFT(str);
+    const size_t G = (size_t)1 << shift;
+    size_t count = size >> shift;
+    size_t parent_count = str8size(str) >> shift;
+    if (count < CHECKPOINTS_TAIL_MIN_COUNT) {
+        // the list has no tail record and keeps its few entries on the grid
+        size_t pos = 0;
+        count_entries(list, str + byte_start, (checkpoints_tail){ 0, 0 }, 0, count, &pos, 0, shift);
+        return;
+    }
+    checkpoints_tail tail = list_tail(parent_list, parent_count);
+    // the parent entries in front of f are on the grid, the other ones have offset o
+    size_t f = tail.offset && tail.first < parent_count ? tail.first : parent_count;
+    size_t o = f < parent_count ? tail.offset : 0;
+    // the parent entry b is the first one behind byte_start if it is on the
+    // grid, it ends up r bytes in front of the first checkpoint
+    size_t b = byte_start >> shift;
+    size_t r = byte_start & (G - 1);
+    // new entries in front of g come from parent entries on the grid
+    size_t g = f > b ? f - b : 0;
+    g = g < count ? g : count;
+    const char *new_str = str + byte_start;
+
+    // The parent entries of one group are copied as the tail of list, those
+    // of the other group are e bytes off their new positions and rebased,
+    // whichever costs less. Copying the entries in front of the tail only
+    // leaves the tail one offset.
+
+    checkpoints_tail new_tail;
+    size_t copied;
+    if (g * rebase_cost(-(ptrdiff_t)r, G) <= (count - g) * rebase_cost(-(ptrdiff_t)o, G)) {
+        // the entries with offset keep their positions, their offset grows by r
+        size_t k = o + r >= G;
+        new_tail = (checkpoints_tail){ g >= k ? g - k : 0, (o + r) & (G - 1) };
+        size_t sources = parent_count > b + k ? parent_count - b - k : 0;
+        copied = count < sources ? count : sources;
+        if (new_tail.offset == 0 || new_tail.first >= count) {
+            new_tail = (checkpoints_tail){ 0, 0 };
+        }
+        // the last grid entry is dropped if the entries with offset move one index further
+        size_t grid_end = g >= k ? g - k : 0;
+        checkpoints_move(list, parent_list, b, b + grid_end, -(ptrdiff_t)b, -char_start);
+        if (grid_end < copied) {
+            checkpoints_move(list, parent_list, grid_end + b + k, copied + b + k, -(ptrdiff_t)(b + k), -char_start);
+        }
+        if (r) {
+            rebase_entries(list, new_str, new_tail, 0, grid_end, -(ptrdiff_t)r, shift);
+        }
+    }
+    else {
+        // the entries on the grid keep their positions, all of them get offset r
+        new_tail = (checkpoints_tail){ 0, r };
+        size_t sources = parent_count - b;
+        copied = count < sources ? count : sources;
+        checkpoints_move(list, parent_list, b, b + copied, -(ptrdiff_t)b, -char_start);
+        if (g < copied) {
+            rebase_entries(list, new_str, new_tail, g, copied, -(ptrdiff_t)o, shift);
+        }
+    }
+
+    // the last entry can lie behind the last one of the parent
+    size_t pos = copied ? entry_pos(new_tail, copied - 1, shift) : 0;
+    size_t chars = copied ? read_entry(list, copied - 1) : 0;
+    count_entries(list, new_str, new_tail, copied, count, &pos, chars, shift);
+    checkpoints_write_tail(list, new_tail);
+}
+
+/**
+ * @brief Return a pointer to the idx' character of str, list_idx being the
+ *        result of find_entry_ub() for idx and shift the exponent of the
+ *        granularity of str.
+ *
+ * If the entry of the block containing idx is exactly the size of the block
+ * larger than the previous one, every byte of the block starts a character
+ * (it is ASCII, apart from maybe the lead byte of a character reaching into
+ * the next block). Then the position is calculated instead of scanned. This
+ * makes lookups in the ASCII parts of mostly ASCII text O(1) after the search,
+ * without storing anything besides the list.
+ */
+STATIC INLINE const char *lookup_in_block(str8 str, size_t size, void *list, size_t list_count,
+                                          size_t list_idx, size_t idx, size_t shift) {
+    checkpoints_tail tail = list_tail(list, list_count);
+    size_t block = list_idx < list_count ? list_idx + 1 : 0;
+    size_t byte_pos = block ? entry_pos(tail, list_idx, shift) : 0;
+    size_t idx_offset = block ? read_entry(list, list_idx) : 0;
+    if (block < list_count && read_entry(list, block) - idx_offset == entry_pos(tail, block, shift) - byte_pos) {
+        return str + byte_pos + (idx - idx_offset);
+    }
+    return lookup_idx(str + byte_pos, size - byte_pos, idx - idx_offset);
+}
+
+void str8getrange(str8 str, size_t start, size_t end, size_t *byte_start, size_t *byte_end) {
+    uint8_t type = STR8_TYPE(str);
+    size_t size = str8size(str);
+    size_t length = str8len(str);
+    if (type != STR8_TYPE0 && STR8_IS_ASCII(str)) {
+        *byte_start = start;
+        *byte_end = end;
+        return;
+    }
+    size_t width = STR8_WIDTH(str);
+    if (width) {
+        *byte_start = start * width;
+        *byte_end = end * width;
+        return;
+    }
+    uint8_t index = type != STR8_TYPE0 ? STR8_INDEX(str) : STR8_INDEX_LIST;
+    if (index == STR8_INDEX_CHARS || index == STR8_INDEX_TWOLEVEL) {
+        *byte_start = start >= length ? size : (size_t)(index_lookup(str, size, start, index) - str);
+        if (end >= length) {
+            *byte_end = size;
+        }
+        else if (end - start < STR8_GRANULARITY(str)) {
+            // continue from the start character
+            *byte_end = lookup_idx(str + *byte_start, size - *byte_start, end - start) - str;
+        }
+        else {
+            *byte_end = index_lookup(str, size, end, index) - str;
+        }
+        return;
+    }
+    void *list = checkpoints_list_ptr(str);
+    size_t shift = STR8_GRANULARITY_SHIFT(str);
+    size_t list_count = list ? size >> shift : 0;
+
+    size_t list_idx = find_entry_ub(list, list_count, start);
+    *byte_start = start >= length ? size :
+        (size_t)(lookup_in_block(str, size, list, list_count, list_idx, start, shift) - str);
+
+    if (end >= length) {
+        *byte_end = size;
+        return;
+    }
+    size_t end_list_idx = find_entry_ub_from(list, list_count, list_idx, end);
+    if (end_list_idx == list_idx) {
+        // same block, continue from the start character
+        *byte_end = lookup_idx(str + *byte_start, size - *byte_start, end - start) - str;
+        return;
+    }
+    *byte_end = lookup_in_block(str, size, list, list_count, end_list_idx, end, shift) - str;
+}
+
 const char *str8getchar(str8 str, size_t idx) {
     if (idx == 0) {
         return str;
@@ -232,18 +1308,80 @@ const char *str8getchar(str8 str, size_t idx) {
     if (ascii) {
         return str + idx;
     }
-    if (type == STR8_TYPE1) {  // type 1 does not have a list
+    size_t width = STR8_WIDTH(str);
+    if (width) {
+        return idx < str8len(str) ? str + idx * width : NULL;
+    }
+    if (type == STR8_TYPE1 || STR8_INDEX(str) == STR8_INDEX_NONE) {  // type 1 does not have a list
         return lookup_idx(str, size, idx);
     }
+    if (STR8_INDEX(str) == STR8_INDEX_CHARS) {
+        return idx < str8len(str) ? anchors_lookup(str, size, idx) : NULL;
+    }
+    if (STR8_INDEX(str) == STR8_INDEX_TWOLEVEL) {
+        return idx < str8len(str) ? twolevel_lookup(str, size, idx) : NULL;
+    }
     void *checkpoints_list = checkpoints_list_ptr(str);
-    size_t list_count = size/CHECKPOINTS_GRANULARITY;
+    size_t shift = STR8_GRANULARITY_SHIFT(str);
+    size_t list_count = size >> shift;
 
-    size_t list_idx = find_entry_ub(checkpoints_list, list_count, idx);
-    size_t byte_pos = 0;
-    size_t idx_offset = 0;
-    if (list_idx < list_count) {
-        byte_pos = (list_idx + 1) * CHECKPOINTS_GRANULARITY;
-        idx_offset = read_entry(checkpoints_list, list_idx);
+    size_t list_idx;
+    if (list_count <= MAX_2BYTE_INDEX + 1) {
+        list_idx = find_entry_ub(checkpoints_list, list_count, idx);
     }
-    return lookup_idx(str + byte_pos, size - byte_pos, idx - idx_offset);
+    else {
+        // Most texts have a fairly constant number of bytes per character,
+        // so interpolate the position and search from there.
+        size_t guess_pos = (size_t)((double)idx * size / str8len(str));
+        size_t guess = guess_pos >> shift;
+        list_idx = find_entry_ub_near(checkpoints_list, list_count, guess ? guess - 1 : 0, idx);
+    }
+    return lookup_in_block(str, size, checkpoints_list, list_count, list_idx, idx, shift);
+}
+
+size_t str8getidx(str8 str, size_t byte_pos) {
+    uint8_t type = STR8_TYPE(str);
+    size_t size = str8size(str);
+    if (byte_pos >= size) {
+        return str8len(str);
+    }
+    if (type == STR8_TYPE0) {
+        return count_chars(str, byte_pos);
+    }
+    if (STR8_IS_ASCII(str)) {
+        return byte_pos;
+    }
+    size_t width = STR8_WIDTH(str);
+    if (width) {
+        // characters starting in front of byte_pos
+        return (byte_pos + width - 1) / width;
+    }
+    if (type == STR8_TYPE1 || STR8_INDEX(str) == STR8_INDEX_NONE) {
+        return count_chars(str, byte_pos);
+    }
+    if (STR8_INDEX(str) == STR8_INDEX_CHARS) {
+        return anchors_count_chars_to(str, byte_pos);
+    }
+    if (STR8_INDEX(str) == STR8_INDEX_TWOLEVEL) {
+        return twolevel_count_chars_to(str, byte_pos);
+    }
+    return count_chars_to(str, checkpoints_list(str), size >> STR8_GRANULARITY_SHIFT(str), byte_pos);
+}
+
+size_t str8countrange(str8 str, size_t byte_start, size_t byte_end) {
+    size_t size = str8size(str);
+    if (byte_end > size) {
+        byte_end = size;
+    }
+    if (byte_start > byte_end) {
+        byte_start = byte_end;
+    }
+    uint8_t type = STR8_TYPE(str);
+    bool indexed = type > STR8_TYPE1 && (STR8_IS_ASCII(str) || STR8_WIDTH(str) ||
+                                         STR8_INDEX(str) != STR8_INDEX_NONE);
+    if (!indexed || byte_end - byte_start <= STR8_GRANULARITY(str)) {
+        // counting the range is not more than counting the rest of a block
+        return count_chars(str + byte_start, byte_end - byte_start);
+    }
+    return str8getidx(str, byte_end) - str8getidx(str, byte_start);
 }
@@ -9,6 +9,7 @@
 #define STR8_CHECKPOINTS_H
 
 #include "str8.h"
+#include "str8_header.h"
 #include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
@@ -17,16 +18,71 @@
 #define CHECKPOINTS_GRANULARITY 512
 #endif
 
+#if CHECKPOINTS_GRANULARITY & (CHECKPOINTS_GRANULARITY - 1)
+#error "CHECKPOINTS_GRANULARITY must be a power of two"
+#endif
+
+/** @brief log2(CHECKPOINTS_GRANULARITY) */
+#define CHECKPOINTS_SHIFT ((size_t)__builtin_ctzll(CHECKPOINTS_GRANULARITY))
+/** @brief The finest granularity a string can choose. */
+#define CHECKPOINTS_MIN_GRANULARITY (CHECKPOINTS_GRANULARITY < 64 ? CHECKPOINTS_GRANULARITY : 64)
+
+/**
+ * @brief Return the exponent of the checkpoints granularity of str.
+ *
+ * Strings can have a finer granularity than CHECKPOINTS_GRANULARITY (stored
+ * in the descriptor byte). The size of the list entries depends on the index
+ * only (the zones are the ones of CHECKPOINTS_GRANULARITY), which is fine for
+ * finer granularities since the entries get smaller.
+ */
+#define STR8_GRANULARITY_SHIFT(str) \
+    (STR8_HAS_DESC(str) ? (size_t)(STR8_DESC(str) & STR8_DESC_SHIFT) : CHECKPOINTS_SHIFT)
+/** @brief Return the checkpoints granularity of str. */
+#define STR8_GRANULARITY(str) ((size_t)1 << STR8_GRANULARITY_SHIFT(str))
+/** @brief The descriptor of strings without a descriptor byte. */
+#define CHECKPOINTS_DESC_DEFAULT ((uint8_t)(CHECKPOINTS_SHIFT | STR8_INDEX_LIST))
+/** @brief Return the descriptor of str (CHECKPOINTS_DESC_DEFAULT if it has no descriptor byte). */
+#define STR8_DESCRIPTOR(str) (STR8_HAS_DESC(str) ? STR8_DESC(str) : CHECKPOINTS_DESC_DEFAULT)
+
 #define MAX_2BYTE_INDEX ((UINT16_MAX / CHECKPOINTS_GRANULARITY) - 1)
 #define MAX_4BYTE_INDEX ((UINT32_MAX / CHECKPOINTS_GRANULARITY) - 1)
 #define MAX_8BYTE_INDEX ((UINT64_MAX / CHECKPOINTS_GRANULARITY) - 1)
 
+/** @brief Size of the tail record stored in front of the list entries. */
+#define CHECKPOINTS_TAIL_SIZE (2 * sizeof(uint64_t))
+/**
+ * @brief Minimum number of entries of a list with a tail record.
+ *
+ * The record would be large compared to shorter lists, so they have none
+ * and keep all entries on the grid, their few entries behind an edit are
+ * counted again. The record is at most 1/8 of the entries of a list with one.
+ */
+#define CHECKPOINTS_TAIL_MIN_COUNT 64
+
+/**
+ * @brief Describes where the entries of a list are.
+ *
+ * Entry idx counts the characters in front of byte (idx + 1) * granularity.
+ * Edits that change the size move the entries behind them instead of
+ * recounting them, so the entries from first on are offset bytes in front of
+ * that position (0 <= offset < granularity). The list has size / granularity
+ * entries either way, so its last block can be up to offset bytes longer.
+ * Lists with less than CHECKPOINTS_TAIL_MIN_COUNT entries have no record,
+ * their tail is always {0, 0}.
+ */
+typedef struct {
+    size_t first;   //< First entry that is offset
+    size_t offset;  //< Bytes the entries from first on are in front of the grid
+} checkpoints_tail;
+
 typedef struct {
     void *list;             //< Pointer to existing list of uint16_t entries
     size_t list_capacity;   //< Capacity of the list (should be MAX_2BYTE_INDEX + 1 if it's a temporary list on the stack)
     size_t byte_offset;     //< Offset in bytes where the anaylsis should assume to start
     size_t list_start_idx;  //< The list index that should be written first
     size_t char_idx_offset; //< Offset in characters
+    size_t granularity;     //< Distance of the checkpoints (0 for CHECKPOINTS_GRANULARITY)
+    bool uniform;           //< Detect a uniform character width (no offsets allowed, see str8_analyze())
 } str8_analyze_config;
 
 typedef struct {
@@ -35,9 +91,20 @@ typedef struct {
     size_t list_capacity;
     size_t size;
     size_t length;
+    size_t width;           //< Width shared by all characters (1 for ASCII) or 0
     bool list_created;
 } str8_analyze_results;
 
+/** @brief Describes a replaced range of a string for checkpoints_apply_edit(). */
+typedef struct {
+    size_t byte_start;    //< First byte of the edited range
+    size_t old_byte_end;  //< End of the edited range in bytes before the edit
+    size_t new_byte_end;  //< End of the edited range in bytes after the edit
+    size_t char_start;    //< Character index of byte_start
+    size_t old_char_end;  //< Character index of old_byte_end before the edit
+    size_t new_char_end;  //< Character index of new_byte_end after the edit
+} checkpoints_edit;
+
 void deinit_results(str8_analyze_results *results);
 
 /**
@@ -49,6 +116,13 @@ void deinit_results(str8_analyze_results *results);
  * If a new list is created list_created will be true, false otherwise.
  * 
  * If the max_bytes choppes a multi-byte character it will not be in the list.
+ *
+ * If config.uniform is set (for an analysis without offsets), results->width
+ * is the width shared by all characters (1 for ASCII, 2, 3 or 4) or 0. As
+ * long as the characters have the width of the first one, no entries are
+ * written, so the list is only written (and allocated) if width is 0. The
+ * entries in front of the first character of another width are derived
+ * from the width then.
  */
 uint8_t str8_analyze(
     const char *str,
@@ -57,17 +131,235 @@ uint8_t str8_analyze(
     str8_analyze_results *results);
 
 /**
- * @brief Return the number of bytes the list needs.
+ * @brief Return the number of bytes the list needs (the entries and the tail record).
  * 
  * @param capacity The capacity of the string the list is for.
+ * @param granularity The distance of the checkpoints.
  */
-size_t checkpoints_list_total_size(size_t capacity);
+size_t checkpoints_list_total_size(size_t capacity, size_t granularity);
 
-/** @brief Return a pointer to the begin of the list of str. */
+/** @brief Return a pointer to the first entry of the list of str (behind its tail record). */
 void *checkpoints_list_ptr(str8 str);
 
+/** @brief Return the tail record of list (which needs to have one, see CHECKPOINTS_TAIL_MIN_COUNT). */
+checkpoints_tail checkpoints_read_tail(void *list);
+
+/**
+ * @brief Write the tail record of list ({0, 0} for a list with all entries on the grid).
+ *
+ * list needs to have a record (see CHECKPOINTS_TAIL_MIN_COUNT).
+ */
+void checkpoints_write_tail(void *list, checkpoints_tail tail);
+
+/**
+ * @brief Return the number of bytes the character anchors of a string need.
+ *
+ * The anchors (see STR8_INDEX_CHARS) are the byte offsets of every k' character,
+ * stored with the size of the header fields of type.
+ */
+size_t checkpoints_anchors_total_size(uint8_t type, size_t capacity, size_t k);
+
+/** @brief Return a pointer to the begin of the character anchors of str or NULL. */
+void *checkpoints_anchors_ptr(str8 str);
+
+/**
+ * @brief Write the character anchors of str from the character char_idx on.
+ *
+ * Anchors in front of char_idx are kept, so after a modification only the
+ * part behind the first modified character needs to be scanned.
+ *
+ * @param byte_pos Byte offset of the character char_idx.
+ */
+void checkpoints_fill_anchors(str8 str, size_t byte_pos, size_t char_idx);
+
+/** @brief Blocks per superblock of the two-level index, so the relative counts always fit in 16 bits. */
+#define STR8_TWOLEVEL_BLOCKS \
+    (UINT16_MAX / CHECKPOINTS_GRANULARITY < 64 ? UINT16_MAX / CHECKPOINTS_GRANULARITY : 64)
+
+/**
+ * @brief Return the number of bytes the two-level index of a string needs.
+ *
+ * The two-level index (see STR8_INDEX_TWOLEVEL) stores the characters in
+ * front of every superblock of STR8_TWOLEVEL_BLOCKS blocks with the size of
+ * the header fields of type, and the characters up to the end of every block
+ * relative to its superblock as u16. That is about 2 bytes per block, where
+ * the list needs 4 or 8 outside of its first zone.
+ */
+size_t checkpoints_twolevel_total_size(uint8_t type, size_t capacity, size_t granularity);
+
+/** @brief Return a pointer to the begin of the two-level index of str or NULL. */
+void *checkpoints_twolevel_ptr(str8 str);
+
+/**
+ * @brief Write the two-level index of str for the blocks ending behind byte_pos.
+ *
+ * Like checkpoints_fill_anchors(), the blocks in front of a modification
+ * are kept.
+ *
+ * @param char_idx Number of characters in front of byte_pos.
+ */
+void checkpoints_fill_twolevel(str8 str, size_t byte_pos, size_t char_idx);
+
+/** @brief Return the value of the idx' entry of list (characters in front of checkpoints_entry_pos()). */
+size_t checkpoints_read_entry(void *list, size_t idx);
+
+/** @brief Return the byte position of the idx' entry of list with count entries (see checkpoints_tail). */
+size_t checkpoints_entry_pos(void *list, size_t count, size_t idx, size_t granularity);
+
+/**
+ * @brief Write the checkpoints for size bytes of str starting at byte_start to list.
+ *
+ * If str has a checkpoints list, its entries behind byte_start are copied
+ * with char_start subtracted and become the tail of list, offset by the
+ * position of byte_start within its block (see checkpoints_tail). If the
+ * entries of str have two offsets, one group is rebased instead, counting at
+ * most half a block per entry. Only an entry behind the last one of str is
+ * counted. Without a list the checkpoints are derived like in
+ * checkpoints_copy_range_to().
+ *
+ * @param list The list to write to. It has the granularity of str.
+ * @param str The string the range is taken from.
+ * @param byte_start First byte of the range.
+ * @param char_start Character index of byte_start.
+ * @param size Size of the range in bytes.
+ */
+void checkpoints_copy_range(void *list, str8 str, size_t byte_start, size_t char_start, size_t size);
+
+/**
+ * @brief Like checkpoints_copy_range(), but the range is copied to out_pos.
+ *
+ * @param list The list to write to.
+ * @param out_pos Position of the range in the new string.
+ * @param out_chars Number of characters in front of out_pos in the new string.
+ * @param str The string the range is taken from. It does not need a list.
+ * @param byte_start First byte of the range in str.
+ * @param char_start Character index of byte_start in str.
+ * @param size Size of the range in bytes.
+ * @param granularity The granularity of list (str might have another one).
+ */
+void checkpoints_copy_range_to(void *list, size_t out_pos, size_t out_chars,
+                               str8 str, size_t byte_start, size_t char_start, size_t size,
+                               size_t granularity);
+
+/**
+ * @brief Count the characters of str in [from, to) and write the checkpoints in between.
+ *
+ * @param list The list to write to.
+ * @param str The string the list belongs to.
+ * @param from First byte to count.
+ * @param to End of the range.
+ * @param chars Number of characters in front of from.
+ * @param granularity The granularity of list.
+ * @returns The number of characters in front of to.
+ */
+size_t checkpoints_count_range(void *list, const char *str, size_t from, size_t to, size_t chars,
+                               size_t granularity);
+
+/** @brief Write the entries [from, to) of a list for a pure ASCII string. */
+void checkpoints_fill_ascii(void *list, size_t from, size_t to, size_t granularity);
+
+/** @brief Write the entries [from, to) of a list for a string whose characters all have width bytes. */
+void checkpoints_fill_uniform(void *list, size_t from, size_t to, size_t width, size_t granularity);
+
+/**
+ * @brief Return the byte width shared by all characters of str (2, 3 or 4) or 0.
+ *
+ * @param length The number of characters in str (as counted by str8_analyze()).
+ */
+size_t str8_uniform_width(const char *str, size_t size, size_t length);
+
+/** @brief Add delta (modulo 2^N) to the entries [from, to). */
+void checkpoints_add(void *list, size_t from, size_t to, size_t delta);
+
+/**
+ * @brief Update the list after the bytes [byte_start, byte_end) of str were
+ *        modified without changing the size.
+ *
+ * The blocks overlapping the range are recounted and the difference is
+ * added to the entries behind them (see checkpoints_apply_edit()).
+ *
+ * @param length Length of str before the modification.
+ * @param granularity The granularity of list.
+ * @returns The new length of str.
+ */
+size_t checkpoints_reindex(void *list, const char *str, size_t size,
+                           size_t byte_start, size_t byte_end, size_t length, size_t granularity);
+
+/**
+ * @brief Update the checkpoints list after a range of str was replaced.
+ *
+ * The bytes need to be in place already. Entries in front of the edit are
+ * kept and entries behind it are moved with the bytes: the character delta
+ * is added to them and their offset to the grid changes by the byte delta
+ * (see checkpoints_tail), so they are not counted. Only the blocks between
+ * the last kept and the first moved entry are counted.
+ *
+ * A list has a single offset for its tail. If the entries between the first
+ * offset entry and the edit would end up with another offset than the moved
+ * ones, they are counted as well. That is the distance to the previous
+ * edit, which is short for the usual edits close to each other.
+ *
+ * The offset is stored in the tail record in front of the list (16 bytes),
+ * which only lists of at least CHECKPOINTS_TAIL_MIN_COUNT entries have.
+ * Shorter lists stay on the grid, the entries behind the edit are counted.
+ *
+ * @param list The checkpoints list of str (with the entries before the edit).
+ * @param str The string after the edit.
+ * @param old_size Size of the string before the edit.
+ * @param new_size Size of the string after the edit.
+ * @param edit The edited range.
+ * @param granularity The granularity of list.
+ */
+void checkpoints_apply_edit(void *list, const char *str, size_t old_size, size_t new_size,
+                            const checkpoints_edit *edit, size_t granularity);
+
+/**
+ * @brief Write the entries of the bytes appended to str and return its new length.
+ *
+ * The new entries get the positions of the tail of the list. Only the
+ * appended bytes are counted, new entries in front of old_size (the tail
+ * can put some there) are counted back from old_size.
+ *
+ * @param list The checkpoints list of str.
+ * @param str The string with the appended bytes.
+ * @param old_size Size of the string before the bytes were appended.
+ * @param new_size Size of the string with the appended bytes.
+ * @param length Length of the string before the bytes were appended.
+ * @param granularity The granularity of list.
+ */
+size_t checkpoints_append(void *list, const char *str, size_t old_size, size_t new_size,
+                          size_t length, size_t granularity);
+
 /**
  * @brief Return a pointer to the first byte of the idx' character.
  */
 const char *str8getchar(str8 str, size_t idx);
+
+/**
+ * @brief Get the byte offsets of the characters start and end with one list search.
+ *
+ * The checkpoint of end is searched from the checkpoint of start on.
+ * start <= end <= str8len(str) is required, end == str8len(str) results in
+ * str8size(str).
+ */
+void str8getrange(str8 str, size_t start, size_t end, size_t *byte_start, size_t *byte_end);
+
+/**
+ * @brief Return the number of characters starting in front of byte_pos.
+ *
+ * This is the inverse of str8getchar(): the index of the character at
+ * byte_pos, if byte_pos is the first byte of a character. Only the part of
+ * the block of byte_pos behind its checkpoint (or anchor) is counted.
+ * byte_pos >= str8size(str) results in str8len(str).
+ */
+size_t str8getidx(str8 str, size_t byte_pos);
+
+/**
+ * @brief Return the number of characters starting in [byte_start, byte_end).
+ *
+ * byte_end is clamped to the size of str and byte_start is clamped to
+ * byte_end. Short ranges are counted directly, longer ones by two
+ * str8getidx() calls.
+ */
+size_t str8countrange(str8 str, size_t byte_start, size_t byte_end);
 #endif
\ No newline at end of file
@@ -0,0 +1,44 @@
+#include "str8_compare.h"
+#include <string.h>
+#include "str8_header.h"
+
+bool str8equal(str8 a, str8 b) {
+    size_t size = str8size(a);
+    if (size != str8size(b)) {
+        return false;
+    }
+    if (a == b) {
+        return true;
+    }
+    // the length of type 0 strings is not stored (it would have to be counted),
+    // the length of ASCII strings is their size
+    if (STR8_TYPE(a) != STR8_TYPE0 && STR8_TYPE(b) != STR8_TYPE0 &&
+        !(STR8_IS_ASCII(a) && STR8_IS_ASCII(b)) && str8len(a) != str8len(b)) {
+        return false;
+    }
+    return memcmp(a, b, size) == 0;
+}
+
+int str8compare(str8 a, str8 b) {
+    size_t a_size = str8size(a);
+    size_t b_size = str8size(b);
+    size_t size = a_size < b_size ? a_size : b_size;
+    int result = memcmp(a, b, size);
+    if (result != 0) {
+        return result;
+    }
+    return (a_size > b_size) - (a_size < b_size);
+}
+
+bool str8startswith(str8 str, const char *prefix) {
+    size_t size = str8size(str);
+    size_t prefix_size = strnlen(prefix, size + 1);
+    return prefix_size <= size && memcmp(str, prefix, prefix_size) == 0;
+}
+
+bool str8endswith(str8 str, const char *suffix) {
+    size_t size = str8size(str);
+    size_t suffix_size = strnlen(suffix, size + 1);
+    return suffix_size <= size &&
+           memcmp(str + size - suffix_size, suffix, suffix_size) == 0;
+}
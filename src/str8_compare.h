@@ -0,0 +1,49 @@
+/**
+ * @file str8_compare.h
+ * @brief Equality, ordering and prefix/suffix tests of str8 strings.
+ *
+ * The sizes are taken from the headers, so no string is scanned for its
+ * terminator (only the const char * prefixes, and not further than the
+ * size of str). The bytes are compared with memcmp(), which compares wide
+ * vectors itself.
+ *
+ * UTF-8 preserves the order of the codepoints: the first byte in which two
+ * encodings differ is smaller in the one with the smaller codepoint. So the
+ * order of the unsigned bytes is the codepoint order, for ASCII and
+ * multibyte characters alike, and no character has to be decoded.
+ */
+#ifndef STR8_COMPARE_H
+#define STR8_COMPARE_H
+
+#include "str8.h"
+#include <stdbool.h>
+
+/**
+ * @brief Check if a and b are equal.
+ *
+ * Strings of different sizes, and (if neither is of type 0) of different
+ * lengths, are rejected from their headers.
+ */
+bool str8equal(str8 a, str8 b);
+
+/**
+ * @brief Compare a and b by codepoints.
+ *
+ * A string is smaller than the strings it is a prefix of.
+ *
+ * @returns A negative value if a is smaller than b, 0 if they are equal and
+ *          a positive value if a is larger.
+ */
+int str8compare(str8 a, str8 b);
+
+/** @brief Check if str starts with prefix. */
+bool str8startswith(str8 str, const char *prefix);
+
+/**
+ * @brief Check if str ends with suffix.
+ *
+ * Only the bytes of suffix and the last as many bytes of str are read.
+ */
+bool str8endswith(str8 str, const char *suffix);
+
+#endif
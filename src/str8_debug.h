@@ -25,10 +25,27 @@ void *checkpoints_entry(void *list, size_t idx);
 size_t read_entry(void *list, size_t idx);
 void write_entry(void *list, size_t idx, size_t value);
 size_t find_entry_ub(void *list, size_t list_count, size_t upper_bound);
+size_t find_entry_ub_from(void *list, size_t list_count, size_t from, size_t upper_bound);
+size_t find_entry_ub_near(void *list, size_t list_count, size_t guess, size_t upper_bound);
+size_t count_chars_to(str8 str, void *list, size_t list_count, size_t pos);
+const char *lookup_in_block(str8 str, size_t size, void *list, size_t list_count, size_t list_idx, size_t idx, size_t shift);
+
+/* str8_patterns.h */
+struct str8patterns *patterns_new_(const char **patterns, size_t count, bool automaton);
+
+/* str8_regex.h */
+struct str8regex *regex_new_(const char *pattern, size_t cache_size);
+
+/* str8_rope.h */
+struct str8rope *rope_new_(const char *str, void *(*alloc)(size_t));
+struct str8rope *rope_concat_(struct str8rope *left, struct str8rope *right, struct str8rope *spare,
+                              bool merge, void *(*alloc)(size_t));
+struct str8rope *rope_insert_(struct str8rope *rope, size_t idx, const char *str, void *(*alloc)(size_t));
+struct str8rope *rope_delete_(struct str8rope *rope, size_t start, size_t end, void *(*alloc)(size_t));
 
 /* str8_memory.h */
 size_t calc_total_size(uint8_t type, bool ascii, size_t capacity);
-uint8_t type_from_capacity(size_t cap);
+size_t *refcount_field(str8 str);
 
 #else
 #define STATIC static
@@ -0,0 +1,250 @@
+#include "str8_edit.h"
+#include <stdlib.h>
+#include <string.h>
+#include "str8_header.h"
+#include "str8_checkpoints.h"
+#include "str8_memory.h"
+#include "str8_simd.h"
+#include "str8_debug.h"
+
+/**
+ * @brief Replace the characters [start, end) of str with other_size bytes of other.
+ */
+STATIC str8 str8replace_(str8 str, size_t start, size_t end, const char *other, size_t other_size) {
+    str = str8unshare(str);
+    if (!str) {
+        return NULL;
+    }
+    size_t size = str8size(str);
+    size_t length = str8len(str);
+    if (end > length) {
+        end = length;
+    }
+    if (start > end) {
+        start = end;
+    }
+
+    size_t byte_start, byte_end;
+    str8getrange(str, start, end, &byte_start, &byte_end);
+
+    bool other_ascii = is_ascii(other, other_size);
+    size_t other_length = other_ascii ? other_size : count_chars(other, other_size);
+    size_t new_size = size - (byte_end - byte_start) + other_size;
+    size_t new_length = length - (end - start) + other_length;
+
+    // make sure the string is large enough and has a list if necessary
+    bool ascii = STR8_TYPE(str) != STR8_TYPE0 && STR8_IS_ASCII(str);
+    size_t capacity = str8cap(str);
+    // a string with a uniform width needs a list (see str8grow())
+    if (new_size > capacity || (ascii && !other_ascii) || STR8_WIDTH(str)) {
+        capacity = new_size > capacity ? calc_cap_with_prealloc(new_size) : capacity;
+        str = str8grow(str, capacity, !other_ascii);
+        if (!str) {
+            return NULL;
+        }
+    }
+    void *list = checkpoints_list_ptr(str);
+    size_t granularity = STR8_GRANULARITY(str);
+    if (ascii && list) {
+        // the string was ASCII before, so the list is new
+        checkpoints_fill_ascii(list, 0, size/granularity, granularity);
+    }
+
+    memmove(str + byte_start + other_size, str + byte_end, size - byte_end + 1);  // + '\0'
+    memcpy(str + byte_start, other, other_size);
+
+    if (list) {
+        checkpoints_edit edit = {
+            .byte_start = byte_start,
+            .old_byte_end = byte_end,
+            .new_byte_end = byte_start + other_size,
+            .char_start = start,
+            .old_char_end = end,
+            .new_char_end = start + other_length
+        };
+        checkpoints_apply_edit(list, str, size, new_size, &edit, granularity);
+    }
+    str8setsize(str, new_size);
+    str8setlen(str, new_length);
+    if (checkpoints_anchors_ptr(str)) {
+        // the anchors in front of the edit are still valid
+        checkpoints_fill_anchors(str, byte_start, start);
+    }
+    if (checkpoints_twolevel_ptr(str)) {
+        checkpoints_fill_twolevel(str, byte_start, start);
+    }
+    return str;
+}
+
+str8 str8replace(str8 str, size_t idx, size_t count, const char *other) {
+    // avoid an overflow of idx + count
+    size_t end = count > SIZE_MAX - idx ? SIZE_MAX : idx + count;
+    return str8replace_(str, idx, end, other, strlen(other));
+}
+
+str8 str8insert(str8 str, size_t idx, const char *other) {
+    return str8replace_(str, idx, idx, other, strlen(other));
+}
+
+str8 str8erase(str8 str, size_t idx, size_t count) {
+    size_t end = count > SIZE_MAX - idx ? SIZE_MAX : idx + count;
+    return str8replace_(str, idx, end, "", 0);
+}
+
+str8 str8truncate(str8 str, size_t length) {
+    return str8replace_(str, length, SIZE_MAX, "", 0);
+}
+
+str8 str8reindex(str8 str, size_t byte_start, size_t byte_end) {
+    // the header is updated (and might grow), which the other owners must not see
+    str = str8unshare(str);
+    if (!str) {
+        return NULL;
+    }
+    size_t size = str8size(str);
+    if (byte_end > size) {
+        byte_end = size;
+    }
+    if (byte_start >= byte_end || STR8_TYPE(str) == STR8_TYPE0) {
+        // type 0 does not store the length
+        return str;
+    }
+
+    if (STR8_WIDTH(str)) {
+        // get a list (see str8grow()), it describes the string before the modification
+        str = str8grow(str, str8cap(str), true);
+        if (!str) {
+            return NULL;
+        }
+    }
+    else if (STR8_IS_ASCII(str)) {
+        if (is_ascii(str + byte_start, byte_end - byte_start)) {
+            return str;
+        }
+        // extend the header, the new list describes the ASCII string before
+        // the modification
+        str = str8grow(str, str8cap(str), true);
+        if (!str) {
+            return NULL;
+        }
+        void *list = checkpoints_list_ptr(str);
+        if (list) {
+            checkpoints_fill_ascii(list, 0, size/CHECKPOINTS_GRANULARITY, CHECKPOINTS_GRANULARITY);
+        }
+    }
+
+    void *list = checkpoints_list_ptr(str);
+    if (!list) {
+        // type 1 is small enough to just count, a string without a list has to
+        str8setlen(str, count_chars(str, size));
+        if (checkpoints_anchors_ptr(str)) {
+            checkpoints_fill_anchors(str, 0, 0);
+        }
+        if (checkpoints_twolevel_ptr(str)) {
+            checkpoints_fill_twolevel(str, 0, 0);
+        }
+        return str;
+    }
+
+    str8setlen(str, checkpoints_reindex(list, str, size, byte_start, byte_end, str8len(str),
+                                        STR8_GRANULARITY(str)));
+    return str;
+}
+
+/** @brief An edit of str8applyedits() with clamped indices and byte offsets. */
+typedef struct {
+    size_t start;
+    size_t end;
+    size_t byte_start;
+    size_t byte_end;
+    size_t text_size;
+    size_t text_length;
+} resolved_edit;
+
+str8 str8applyedits(str8 str, const str8edit *edits, size_t count) {
+    size_t size = str8size(str);
+    size_t length = str8len(str);
+
+    resolved_edit *resolved = malloc((count ? count : 1) * sizeof(resolved_edit));
+    if (!resolved) {
+        return NULL;
+    }
+
+    // 1.  Resolve the byte offsets and calculate size and length of the result
+
+    size_t new_size = size;
+    size_t new_length = length;
+    // the result keeps a uniform width if all replacements have it
+    size_t width = STR8_WIDTH(str);
+    for (size_t i=0; i<count; i++) {
+        resolved_edit *r = &resolved[i];
+        r->end = edits[i].end > length ? length : edits[i].end;
+        r->start = edits[i].start > r->end ? r->end : edits[i].start;
+        if (i > 0 && r->start < resolved[i-1].end) {
+            free(resolved);
+            return NULL;
+        }
+        str8getrange(str, r->start, r->end, &r->byte_start, &r->byte_end);
+        r->text_size = strlen(edits[i].text);
+        r->text_length = count_chars(edits[i].text, r->text_size);
+        new_size = new_size - (r->byte_end - r->byte_start) + r->text_size;
+        new_length = new_length - (r->end - r->start) + r->text_length;
+        width = r->text_size == width * r->text_length ? width : 0;
+    }
+
+    // same granularity and kind of index as str
+    uint8_t type = type_from_capacity(new_size);
+    bool ascii = new_size == new_length;
+    str8 new = str8_allocate_desc(type, ascii, ascii ? 0 : width, STR8_DESCRIPTOR(str), new_size, malloc);
+    if (!new) {
+        free(resolved);
+        return NULL;
+    }
+    void *list = checkpoints_list_ptr(new);
+    size_t granularity = STR8_GRANULARITY(new);
+
+    // 2.  Copy the segments and write the checkpoints in between
+
+    size_t pos = 0;        // position in new
+    size_t chars = 0;      // characters in front of pos
+    size_t src_pos = 0;    // position in str
+    size_t src_chars = 0;  // characters in front of src_pos
+    for (size_t i=0; i<=count; i++) {
+        // unchanged part of str in front of the edit (or the rest of str)
+        size_t byte_end = i < count ? resolved[i].byte_start : size;
+        size_t char_end = i < count ? resolved[i].start : length;
+        memcpy(new + pos, str + src_pos, byte_end - src_pos);
+        if (list) {
+            checkpoints_copy_range_to(list, pos, chars, str, src_pos, src_chars, byte_end - src_pos,
+                                      granularity);
+        }
+        pos += byte_end - src_pos;
+        chars += char_end - src_chars;
+        if (i == count) {
+            break;
+        }
+
+        // replacement
+        memcpy(new + pos, edits[i].text, resolved[i].text_size);
+        if (list) {
+            checkpoints_count_range(list, new, pos, pos + resolved[i].text_size, chars,
+                                    granularity);
+        }
+        pos += resolved[i].text_size;
+        chars += resolved[i].text_length;
+        src_pos = resolved[i].byte_end;
+        src_chars = resolved[i].end;
+    }
+    new[new_size] = '\0';
+    str8setsize(new, new_size);
+    str8setlen(new, new_length);
+    if (checkpoints_anchors_ptr(new)) {
+        checkpoints_fill_anchors(new, 0, 0);
+    }
+    if (checkpoints_twolevel_ptr(new)) {
+        checkpoints_fill_twolevel(new, 0, 0);
+    }
+
+    free(resolved);
+    return new;
+}
@@ -0,0 +1,75 @@
+/**
+ * @file str8_edit.h
+ * @brief In-place modifications at character indices.
+ *
+ * The bytes are moved with a single memmove within the capacity of the
+ * string (it grows if necessary). The checkpoints list is repaired
+ * incrementally: entries in front of the edit are kept, entries within it
+ * are recounted and entries behind it are shifted (see
+ * checkpoints_apply_edit()).
+ *
+ * All functions return the modified string, which might have moved (like
+ * str8append()), or NULL on failure. other must not point into str.
+ */
+#ifndef STR8_EDIT_H
+#define STR8_EDIT_H
+
+#include "str8.h"
+#include <stddef.h>
+
+/** @brief A single replacement of an edit script (see str8applyedits()). */
+typedef struct {
+    size_t start;      //< First character to replace
+    size_t end;        //< End of the replaced characters (exclusive)
+    const char *text;  //< Replacement
+} str8edit;
+
+/**
+ * @brief Apply a list of edits to str and return the result as a new string.
+ *
+ * The edits must be sorted by start and must not overlap (start of an edit
+ * >= end of the previous one). Indices refer to str before any edit and are
+ * clamped to its length. The result is written in one pass: its size and
+ * length are computed from the edits up front and the checkpoints list is
+ * built while the segments are copied. The result has the granularity and
+ * the kind of index of str (see STR8_DESCRIPTOR()), anchors and two-level
+ * indices are rebuilt in a second pass. It keeps the uniform width of str if
+ * all replacements have it. str is not modified.
+ *
+ * @returns The new string or NULL if the edits are not sorted or on failure.
+ */
+str8 str8applyedits(str8 str, const str8edit *edits, size_t count);
+
+/**
+ * @brief Replace count characters starting at idx with other.
+ *
+ * idx and count are clamped to the length of str.
+ */
+str8 str8replace(str8 str, size_t idx, size_t count, const char *other);
+
+/** @brief Insert other in front of the idx' character (or append it if idx >= length). */
+str8 str8insert(str8 str, size_t idx, const char *other);
+
+/** @brief Remove count characters starting at idx. */
+str8 str8erase(str8 str, size_t idx, size_t count);
+
+/** @brief Shorten str to length characters. */
+str8 str8truncate(str8 str, size_t length);
+
+/**
+ * @brief Update length and checkpoints after the bytes [byte_start, byte_end)
+ *        were modified directly in the buffer.
+ *
+ * The size must not have changed. Only the checkpoint blocks overlapping the
+ * range are recounted, the resulting difference in characters is added to
+ * the entries behind them. If the range introduced non-ASCII characters
+ * into an ASCII string, its header is extended (the string might move). A
+ * string that becomes ASCII keeps its UTF-8 header, which stays valid.
+ *
+ * A string shared with other owners is copied first (see str8unshare()), so
+ * only the returned string gets the new header. Call str8unshare() before
+ * modifying the buffer, so the other owners keep the old bytes as well.
+ */
+str8 str8reindex(str8 str, size_t byte_start, size_t byte_end);
+
+#endif
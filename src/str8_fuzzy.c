@@ -0,0 +1,257 @@
+#include "str8_fuzzy.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "str8_header.h"
+#include "str8_debug.h"
+
+/** @brief Number of pattern characters per block. */
+#define FUZZY_WORD 64
+#define FUZZY_HIGH ((uint64_t)1 << (FUZZY_WORD - 1))
+
+/**
+ * @brief Bit masks of the characters of a pattern.
+ *
+ * Row r of masks (words entries) has bit i set if character i of the
+ * pattern is the character of the row. Row 0 is the row of characters that
+ * are not in the pattern.
+ */
+typedef struct {
+    size_t length;          //< Number of characters
+    size_t words;           //< Words per row
+    uint64_t *masks;
+    uint32_t *keys;         //< Hash table of the non-ASCII characters (UTF-8 bytes, 0 for empty slots)
+    uint32_t *rows;         //< Row of each key
+    size_t table_size;
+    uint32_t ascii[128];    //< Row of each ASCII character
+    // storage of single-word patterns
+    uint64_t small_masks[FUZZY_WORD + 1];
+    uint32_t small_keys[2 * FUZZY_WORD];
+    uint32_t small_rows[2 * FUZZY_WORD];
+} fuzzy_pattern;
+
+/** @brief Read the non-ASCII character at *p as a key and move behind it. */
+STATIC INLINE uint32_t fuzzy_key(const unsigned char **p) {
+    const unsigned char *u = *p;
+    if (u[0] >= 0xF0) {
+        *p += 4;
+        return u[0] | (uint32_t)u[1] << 8 | (uint32_t)u[2] << 16 | (uint32_t)u[3] << 24;
+    }
+    if (u[0] >= 0xE0) {
+        *p += 3;
+        return u[0] | (uint32_t)u[1] << 8 | (uint32_t)u[2] << 16;
+    }
+    *p += 2;
+    return u[0] | (uint32_t)u[1] << 8;
+}
+
+STATIC INLINE size_t fuzzy_slot(uint32_t key, size_t table_size) {
+    return (key * 2654435761u) & (table_size - 1);
+}
+
+/** @brief Return the row of the character at *p and move behind it. */
+STATIC INLINE uint32_t fuzzy_row(const fuzzy_pattern *pattern, const unsigned char **p) {
+    if (**p < 0x80) {
+        return pattern->ascii[*(*p)++];
+    }
+    uint32_t key = fuzzy_key(p);
+    for (size_t slot=fuzzy_slot(key, pattern->table_size); pattern->keys[slot]; slot=(slot+1)&(pattern->table_size-1)) {
+        if (pattern->keys[slot] == key) {
+            return pattern->rows[slot];
+        }
+    }
+    return 0;
+}
+
+STATIC void fuzzy_free(fuzzy_pattern *pattern) {
+    if (pattern->masks != pattern->small_masks) {
+        free(pattern->masks);
+        free(pattern->keys);
+        free(pattern->rows);
+    }
+}
+
+STATIC int fuzzy_build(fuzzy_pattern *pattern, str8 str) {
+    size_t length = str8len(str);
+    pattern->length = length;
+    pattern->words = length > 0 ? (length + FUZZY_WORD - 1) / FUZZY_WORD : 1;
+    pattern->table_size = 2;
+    while (pattern->table_size < 2 * length) {
+        pattern->table_size *= 2;
+    }
+    // at most one row per character, plus row 0
+    size_t mask_count = (length + 1) * pattern->words;
+    if (pattern->words == 1) {
+        pattern->masks = pattern->small_masks;
+        pattern->keys = pattern->small_keys;
+        pattern->rows = pattern->small_rows;
+        memset(pattern->masks, 0, mask_count * sizeof(uint64_t));
+        memset(pattern->keys, 0, pattern->table_size * sizeof(uint32_t));
+    }
+    else {
+        pattern->masks = calloc(mask_count, sizeof(uint64_t));
+        pattern->keys = calloc(pattern->table_size, sizeof(uint32_t));
+        pattern->rows = malloc(pattern->table_size * sizeof(uint32_t));
+        if (!pattern->masks || !pattern->keys || !pattern->rows) {
+            fuzzy_free(pattern);
+            return -1;
+        }
+    }
+    memset(pattern->ascii, 0, sizeof(pattern->ascii));
+
+    uint32_t rows = 1;
+    const unsigned char *p = (const unsigned char *)str;
+    for (size_t i=0; i<length; i++) {
+        uint32_t row;
+        if (*p < 0x80) {
+            if (!pattern->ascii[*p]) {
+                pattern->ascii[*p] = rows++;
+            }
+            row = pattern->ascii[*p++];
+        }
+        else {
+            uint32_t key = fuzzy_key(&p);
+            size_t slot = fuzzy_slot(key, pattern->table_size);
+            while (pattern->keys[slot] && pattern->keys[slot] != key) {
+                slot = (slot + 1) & (pattern->table_size - 1);
+            }
+            if (!pattern->keys[slot]) {
+                pattern->keys[slot] = key;
+                pattern->rows[slot] = rows++;
+            }
+            row = pattern->rows[slot];
+        }
+        pattern->masks[row * pattern->words + i / FUZZY_WORD] |= (uint64_t)1 << (i % FUZZY_WORD);
+    }
+    return 0;
+}
+
+/**
+ * @brief Advance a block of the vertical deltas (pv, mv) by one column.
+ *
+ * hin is the horizontal delta into the top of the block, the returned one
+ * is the delta out of the row of high.
+ */
+STATIC INLINE int fuzzy_advance(uint64_t *pv, uint64_t *mv, uint64_t eq, int hin, uint64_t high) {
+    uint64_t p = *pv;
+    uint64_t m = *mv;
+    uint64_t xv = eq | m;
+    if (hin < 0) {
+        eq |= 1;
+    }
+    uint64_t xh = (((eq & p) + p) ^ p) | eq;
+    uint64_t ph = m | ~(xh | p);
+    uint64_t mh = p & xh;
+    int hout = ph & high ? 1 : mh & high ? -1 : 0;
+    ph <<= 1;
+    mh <<= 1;
+    if (hin < 0) {
+        mh |= 1;
+    }
+    else if (hin > 0) {
+        ph |= 1;
+    }
+    *pv = mh | ~(xv | ph);
+    *mv = ph & xv;
+    return hout;
+}
+
+/**
+ * @brief Return the distance of pattern and text, or max + 1 if it is larger.
+ *
+ * blocks is scratch space of 2 * pattern->words words.
+ */
+STATIC size_t fuzzy_distance(const fuzzy_pattern *pattern, str8 text, size_t max, uint64_t *blocks) {
+    size_t length = str8len(text);
+    size_t m = pattern->length;
+    if ((m > length ? m - length : length - m) > max) {
+        return max + 1;
+    }
+    if (m == 0) {
+        return length;
+    }
+    bool ascii = STR8_TYPE(text) != STR8_TYPE0 && STR8_IS_ASCII(text);
+    const unsigned char *p = (const unsigned char *)text;
+    // the last row of the column, it changes by at most 1 per character
+    size_t score = m;
+    uint64_t last_high = (uint64_t)1 << ((m - 1) % FUZZY_WORD);
+
+    if (pattern->words == 1) {
+        uint64_t pv = ~(uint64_t)0;
+        uint64_t mv = 0;
+        for (size_t j=0; j<length; j++) {
+            uint32_t row = ascii ? pattern->ascii[*p++] : fuzzy_row(pattern, &p);
+            score += fuzzy_advance(&pv, &mv, pattern->masks[row], 1, last_high);
+            // the remaining characters can lower the distance by one each
+            if (score > length - j - 1 && score - (length - j - 1) > max) {
+                return max + 1;
+            }
+        }
+    }
+    else {
+        size_t words = pattern->words;
+        uint64_t *pv = blocks;
+        uint64_t *mv = blocks + words;
+        for (size_t b=0; b<words; b++) {
+            pv[b] = ~(uint64_t)0;
+            mv[b] = 0;
+        }
+        for (size_t j=0; j<length; j++) {
+            uint32_t row = ascii ? pattern->ascii[*p++] : fuzzy_row(pattern, &p);
+            const uint64_t *eq = pattern->masks + row * words;
+            int h = 1;
+            for (size_t b=0; b+1<words; b++) {
+                h = fuzzy_advance(&pv[b], &mv[b], eq[b], h, FUZZY_HIGH);
+            }
+            score += fuzzy_advance(&pv[words - 1], &mv[words - 1], eq[words - 1], h, last_high);
+            if (score > length - j - 1 && score - (length - j - 1) > max) {
+                return max + 1;
+            }
+        }
+    }
+    return score <= max ? score : max + 1;
+}
+
+size_t str8distancebounded(str8 a, str8 b, size_t max) {
+    // the shorter string is the pattern, so it takes fewer words
+    if (str8len(a) > str8len(b)) {
+        str8 swap = a;
+        a = b;
+        b = swap;
+    }
+    fuzzy_pattern pattern;
+    if (fuzzy_build(&pattern, a) != 0) {
+        return SIZE_MAX;
+    }
+    uint64_t small_blocks[2];
+    uint64_t *blocks = pattern.words == 1 ? small_blocks : malloc(2 * pattern.words * sizeof(uint64_t));
+    size_t distance = blocks ? fuzzy_distance(&pattern, b, max, blocks) : SIZE_MAX;
+    if (blocks != small_blocks) {
+        free(blocks);
+    }
+    fuzzy_free(&pattern);
+    return distance;
+}
+
+size_t str8distance(str8 a, str8 b) {
+    return str8distancebounded(a, b, SIZE_MAX - 1);
+}
+
+int str8distancebatch(str8 pattern, const str8 *candidates, size_t count, size_t max, size_t *distances) {
+    fuzzy_pattern compiled;
+    if (fuzzy_build(&compiled, pattern) != 0) {
+        return -1;
+    }
+    uint64_t *blocks = malloc(2 * compiled.words * sizeof(uint64_t));
+    if (!blocks) {
+        fuzzy_free(&compiled);
+        return -1;
+    }
+    for (size_t i=0; i<count; i++) {
+        distances[i] = fuzzy_distance(&compiled, candidates[i], max, blocks);
+    }
+    free(blocks);
+    fuzzy_free(&compiled);
+    return 0;
+}
@@ -0,0 +1,54 @@
+/**
+ * @file str8_fuzzy.h
+ * @brief Levenshtein distance of str8 strings in characters.
+ *
+ * The distance is the minimal number of inserted, deleted and substituted
+ * characters (codepoints) that turn one string into the other. It is
+ * computed on the UTF-8 bytes with the bit-parallel algorithm of Myers (in
+ * the formulation of Hyyrö): the characters of the pattern (the shorter
+ * string) are bits of a machine word, so one column of the dynamic
+ * programming matrix takes a few word operations per character of the
+ * other string. Patterns of up to 64 characters (see str8len()) use a
+ * single word, longer ones blocks of words.
+ *
+ * The bit masks of the pattern are looked up directly for ASCII characters
+ * and in a small hash table for others. When the other string is pure
+ * ASCII, its bytes are the characters and are not decoded.
+ */
+#ifndef STR8_FUZZY_H
+#define STR8_FUZZY_H
+
+#include "str8.h"
+#include <stddef.h>
+
+/**
+ * @brief Return the Levenshtein distance of a and b in characters.
+ *
+ * @returns The distance or SIZE_MAX if the memory could not be allocated
+ *          (only for strings longer than 64 characters).
+ */
+size_t str8distance(str8 a, str8 b);
+
+/**
+ * @brief Return the Levenshtein distance of a and b if it is at most max.
+ *
+ * Strings whose lengths differ by more than max are not compared, and the
+ * computation stops as soon as the distance can not be max or less.
+ *
+ * @returns The distance, max + 1 if it is larger, or SIZE_MAX if the memory
+ *          could not be allocated.
+ */
+size_t str8distancebounded(str8 a, str8 b, size_t max);
+
+/**
+ * @brief Compute the distances of pattern to count candidates.
+ *
+ * The bit masks of pattern are computed once. Like str8distancebounded(),
+ * distances larger than max are written as max + 1 (pass SIZE_MAX - 1 for
+ * no limit).
+ *
+ * @returns 0 on success or -1 if the memory could not be allocated.
+ */
+int str8distancebatch(str8 pattern, const str8 *candidates, size_t count, size_t max, size_t *distances);
+
+#endif
@@ -10,8 +10,46 @@
 #define STR8_TYPE4  3
 #define STR8_TYPE8  4
 
+#define STR8_FLAG_SHARED 0x08  // 0b00001000
+#define STR8_FLAG_WIDTH  0x30  // 0b00110000
+#define STR8_FLAG_DESC   0x40  // 0b01000000
+#define STR8_FLAG_UTF8   0x80  // 0b10000000
+
 #define STR8_TYPE(str) (((unsigned char*)(str))[-1] & 0x07)  // 0b00000111
-#define STR8_IS_ASCII(str) !(((unsigned char*)(str))[-1] & 0x80)  // 0b10000000
+#define STR8_IS_ASCII(str) !(((unsigned char*)(str))[-1] & STR8_FLAG_UTF8)
+/** @brief Check if str is reference counted (type 0 has no spare bits for the flag). */
+#define STR8_IS_SHARED(str) \
+    (STR8_TYPE(str) != STR8_TYPE0 && (((unsigned char*)(str))[-1] & STR8_FLAG_SHARED))
+/**
+ * @brief Return the byte width shared by all characters of str (2, 3 or 4),
+ *        or 0 if the widths differ (or str is ASCII or type 0).
+ *
+ * Such strings have no checkpoints list, the idx' character is at idx * width.
+ */
+#define STR8_WIDTH(str) \
+    (STR8_TYPE(str) != STR8_TYPE0 && (((unsigned char*)(str))[-1] & STR8_FLAG_WIDTH) ? \
+        (size_t)((((unsigned char*)(str))[-1] & STR8_FLAG_WIDTH) >> 4) + 1 : 0)
+/** @brief Return the bits of the type byte for a uniform width (0, 2, 3 or 4). */
+#define STR8_WIDTH_BITS(width) ((width) ? (((width) - 1) << 4) & STR8_FLAG_WIDTH : 0)
+/**
+ * @brief Check if str has a descriptor byte.
+ *
+ * The descriptor is stored in front of the length field (between the fields
+ * and the checkpoints list). Strings without one use the defaults.
+ */
+#define STR8_HAS_DESC(str) \
+    (STR8_TYPE(str) != STR8_TYPE0 && (((unsigned char*)(str))[-1] & STR8_FLAG_DESC))
+/** @brief Return the descriptor byte of str (only valid if STR8_HAS_DESC(str)). */
+#define STR8_DESC(str) \
+    (((unsigned char*)(str))[-2 - 3 * STR8_FIELD_SIZE(STR8_TYPE(str))])
+#define STR8_DESC_SHIFT 0x1F  // 0b00011111, exponent of the checkpoints granularity
+#define STR8_DESC_INDEX 0x60  // 0b01100000, kind of the index
+#define STR8_INDEX_LIST 0x00  // checkpoints list (characters in front of every granularity' byte)
+#define STR8_INDEX_NONE 0x20  // no index (see str8newunindexed())
+#define STR8_INDEX_CHARS 0x40 // byte offsets of every granularity' character (see str8buildcharindex())
+#define STR8_INDEX_TWOLEVEL 0x60 // characters per superblock and per block relative to it (see str8buildtwolevelindex())
+/** @brief Return the kind of index of str (STR8_INDEX_*). */
+#define STR8_INDEX(str) (STR8_HAS_DESC(str) ? STR8_DESC(str) & STR8_DESC_INDEX : STR8_INDEX_LIST)
 #define STR8_FIELD_SIZE(type) \
     ( \
         (type) == STR8_TYPE1 ? 1 : \
@@ -0,0 +1,125 @@
+#include "str8_index.h"
+#include <stdlib.h>
+#include "str8_header.h"
+#include "str8_simd.h"
+#include "str8_debug.h"
+
+/**
+ * @brief Return the number of characters up to the end of block idx, prev is the value of the previous block.
+ *
+ * The blocks have the granularity of the list of str (1 << shift bytes).
+ * The value is copied from the list, entries off the grid (see
+ * checkpoints_tail) only count the bytes between them and the grid.
+ */
+STATIC INLINE size_t index_block_value(str8 str, void *list, size_t count, size_t idx, size_t prev, size_t shift) {
+    size_t end = (idx + 1) << shift;
+    if (list) {
+        size_t pos = checkpoints_entry_pos(list, count, idx, (size_t)1 << shift);
+        return checkpoints_read_entry(list, idx) + count_chars(str + pos, end - pos);
+    }
+    // ASCII (or too short for a list)
+    return prev + count_chars(str + (end - ((size_t)1 << shift)), (size_t)1 << shift);
+}
+
+/** @brief Return true if str8getchar() does not need a list for str. */
+STATIC INLINE bool index_not_needed(str8 str, size_t count) {
+    return count == 0 || (STR8_TYPE(str) != STR8_TYPE0 && (STR8_IS_ASCII(str) || STR8_WIDTH(str)));
+}
+
+/** @brief Values per cache line, the nodes this many levels ahead are prefetched. */
+#define EYTZINGER_LINE (64 / sizeof(uint64_t))
+
+/** @brief Write the values of the blocks in order to the subtree rooted at k. */
+STATIC void eytzinger_fill(str8eytzinger *index, str8 str, void *list, size_t k,
+                           size_t *block, size_t *prev) {
+    if (k > index->count) {
+        return;
+    }
+    eytzinger_fill(index, str, list, 2 * k, block, prev);
+    *prev = index_block_value(str, list, index->count, *block, *prev, index->shift);
+    index->tree[k] = *prev;
+    (*block)++;
+    eytzinger_fill(index, str, list, 2 * k + 1, block, prev);
+}
+
+/**
+ * @brief Return the in-order rank of node k of a complete tree with n nodes.
+ *
+ * In the perfect tree with the height of the complete one, the rank follows
+ * from the depth and the position of k in its level. The nodes missing in
+ * the last level have the even ranks 2j, the ones in front of k are
+ * subtracted.
+ */
+STATIC INLINE size_t eytzinger_rank(size_t k, size_t n) {
+    size_t depth = 63 - (size_t)__builtin_clzll(k);
+    size_t height = 64 - (size_t)__builtin_clzll(n);
+    size_t rank = ((2 * (k - ((size_t)1 << depth)) + 1) << (height - 1 - depth)) - 1;
+    size_t leaves = (size_t)1 << (height - 1);
+    size_t present = n - leaves + 1;
+    size_t in_front = (rank + 1) / 2 < leaves ? (rank + 1) / 2 : leaves;
+    return rank - (in_front > present ? in_front - present : 0);
+}
+
+int str8eytzingerbuild(str8eytzinger *index, str8 str) {
+    void *list = checkpoints_list_ptr(str);
+    index->shift = list ? STR8_GRANULARITY_SHIFT(str) : CHECKPOINTS_SHIFT;
+    size_t count = str8size(str) >> index->shift;
+    index->count = count;
+    // aligned, so the children of a node block share a cache line
+    size_t tree_size = ((count + 1) * sizeof(uint64_t) + 63) / 64 * 64;
+    void *tree;
+    index->tree = posix_memalign(&tree, 64, tree_size) == 0 ? tree : NULL;
+    if (!index->tree) {
+        return -1;
+    }
+    size_t block = 0;
+    size_t prev = 0;
+    eytzinger_fill(index, str, list, 1, &block, &prev);
+    index->length = prev;
+    return 0;
+}
+
+void str8eytzingerfree(str8eytzinger *index) {
+    free(index->tree);
+    index->tree = NULL;
+    index->count = 0;
+    index->length = 0;
+}
+
+size_t str8eytzingersize(const str8eytzinger *index) {
+    return (index->count + 1) * sizeof(uint64_t);
+}
+
+const char *str8eytzingergetchar(str8 str, const str8eytzinger *index, size_t idx) {
+    if (idx == 0) {
+        return str;
+    }
+    size_t size = str8size(str);
+    if (idx >= size) {  // since character size >= 1
+        return NULL;
+    }
+    if (index_not_needed(str, index->count)) {
+        return str8getchar(str, idx);
+    }
+
+    // descend without branches, k ends up at the first node > idx and chars
+    // at the last node <= idx (its in-order predecessor, the previous block)
+    const uint64_t *tree = index->tree;
+    size_t n = index->count;
+    size_t k = 1;
+    uint64_t chars = 0;
+    while (k <= n) {
+        __builtin_prefetch(tree + (k * EYTZINGER_LINE < n ? k * EYTZINGER_LINE : n));
+        uint64_t value = tree[k];
+        bool right = value <= idx;
+        chars = right ? value : chars;
+        k = 2 * k + right;
+    }
+    // remove the right turns taken after the last left turn
+    k >>= __builtin_ffsll(~(long long)k);
+
+    // k is the block we are looking for (or 0 if idx is behind the last block)
+    size_t block = k ? eytzinger_rank(k, n) : n;
+    size_t byte_pos = block << index->shift;
+    return lookup_idx(str + byte_pos, size - byte_pos, idx - chars);
+}
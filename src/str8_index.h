@@ -0,0 +1,50 @@
+/**
+ * @file str8_index.h
+ * @brief Alternative encodings of the checkpoints list for read-heavy strings.
+ *
+ * The list in the header stores an absolute character count per block in
+ * zones of u16, u32 and u64 entries, which makes every access branch on
+ * the zone. The indices here are built from a finished string and kept
+ * next to it. They must be rebuilt (or freed) when the string is modified.
+ * The two-level index replaces the list in the header instead (see
+ * str8buildtwolevelindex()).
+ *
+ * str8eytzinger stores the absolute counts in Eytzinger (BFS) order, so
+ * the first levels of the search share a few cache lines and the nodes
+ * several levels ahead are prefetched while the current one is compared.
+ * A random lookup costs about two cache misses instead of one per probe.
+ * The index takes 8 bytes per block: the block follows from the in-order
+ * rank of the node found and the characters in front of it from the last
+ * node the search passed to the right.
+ */
+#ifndef STR8_INDEX_H
+#define STR8_INDEX_H
+
+#include "str8.h"
+#include "str8_checkpoints.h"
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    uint64_t *tree;   //< Characters up to the end of each block in BFS order (1-based)
+    size_t count;     //< Number of blocks (size >> shift)
+    size_t shift;     //< Exponent of the block size (the granularity of the list of the string)
+    size_t length;    //< Characters up to the end of the last block
+} str8eytzinger;
+
+/**
+ * @brief Build an Eytzinger ordered index for str.
+ *
+ * @returns 0 on success or -1 if the memory could not be allocated.
+ */
+int str8eytzingerbuild(str8eytzinger *index, str8 str);
+
+void str8eytzingerfree(str8eytzinger *index);
+
+/** @brief Return the number of bytes the index uses. */
+size_t str8eytzingersize(const str8eytzinger *index);
+
+/** @brief Like str8getchar(), but look the block up in index. */
+const char *str8eytzingergetchar(str8 str, const str8eytzinger *index, size_t idx);
+
+#endif
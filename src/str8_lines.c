@@ -0,0 +1,139 @@
+#include "str8_lines.h"
+#include <stdlib.h>
+#include "str8_header.h"
+#include "str8_checkpoints.h"
+#include "str8_simd.h"
+#include "str8_debug.h"
+
+/** @brief Expected bytes per line, used for the first allocation. */
+#define LINES_EXPECTED_LINE_SIZE 128
+
+STATIC int lines_reserve(str8lines *lines, size_t capacity) {
+    uint64_t *offsets = realloc(lines->offsets, capacity * sizeof(uint64_t));
+    if (!offsets) {
+        return -1;
+    }
+    lines->offsets = offsets;
+    uint64_t *chars = realloc(lines->chars, capacity * sizeof(uint64_t));
+    if (!chars) {
+        return -1;
+    }
+    lines->chars = chars;
+    return 0;
+}
+
+int str8linesbuild(str8lines *lines, str8 str) {
+    size_t size = str8size(str);
+    lines->offsets = NULL;
+    lines->chars = NULL;
+    lines->count = 0;
+    lines->size = size;
+    lines->length = str8len(str);
+
+    size_t capacity = size / LINES_EXPECTED_LINE_SIZE + 16;
+    if (lines_reserve(lines, capacity) != 0) {
+        str8linesfree(lines);
+        return -1;
+    }
+    lines->offsets[0] = 0;
+    lines->chars[0] = 0;
+    size_t count = 1;
+    for (;;) {
+        // continue behind the last line start found
+        count += find_line_starts(str, lines->offsets[count - 1], size, lines->chars[count - 1],
+                                  lines->offsets + count, lines->chars + count, capacity - count);
+        if (count < capacity) {
+            break;
+        }
+        capacity *= 2;
+        if (lines_reserve(lines, capacity) != 0) {
+            str8linesfree(lines);
+            return -1;
+        }
+    }
+    lines->count = count;
+    return 0;
+}
+
+void str8linesfree(str8lines *lines) {
+    free(lines->offsets);
+    free(lines->chars);
+    lines->offsets = NULL;
+    lines->chars = NULL;
+    lines->count = 0;
+    lines->size = 0;
+    lines->length = 0;
+}
+
+size_t str8linessize(const str8lines *lines) {
+    return lines->count * 2 * sizeof(uint64_t);
+}
+
+/** @brief Return the last line starting at or in front of value in starts. */
+STATIC INLINE size_t find_line(const uint64_t *starts, size_t count, size_t value) {
+    // starts[0] is 0, so there is always one
+    size_t l = 0;
+    size_t r = count;
+    while (r - l > 1) {
+        size_t mid = l + (r - l) / 2;
+        if (starts[mid] <= value) {
+            l = mid;
+        }
+        else {
+            r = mid;
+        }
+    }
+    return l;
+}
+
+size_t str8linestart(const str8lines *lines, size_t line) {
+    return line < lines->count ? lines->offsets[line] : lines->size;
+}
+
+size_t str8linesidx(const str8lines *lines, size_t line, size_t column) {
+    if (line >= lines->count) {
+        line = lines->count - 1;
+    }
+    // the last line has no newline
+    size_t end = line + 1 < lines->count ? lines->chars[line + 1] - 1 : lines->length;
+    size_t line_length = end - lines->chars[line];
+    return lines->chars[line] + (column < line_length ? column : line_length);
+}
+
+size_t str8linesoffset(str8 str, const str8lines *lines, size_t line, size_t column) {
+    if (line >= lines->count) {
+        line = lines->count - 1;
+    }
+    size_t start = lines->offsets[line];
+    size_t end = line + 1 < lines->count ? lines->offsets[line + 1] - 1 : lines->size;
+    size_t idx = str8linesidx(lines, line, column);
+    if (end - start <= CHECKPOINTS_GRANULARITY) {
+        // short lines are scanned from their start
+        const char *p = lookup_idx(str + start, end - start, idx - lines->chars[line]);
+        return p ? (size_t)(p - str) : end;
+    }
+    const char *p = str8getchar(str, idx);
+    return p ? (size_t)(p - str) : lines->size;
+}
+
+size_t str8linesfromidx(const str8lines *lines, size_t idx, size_t *column) {
+    if (idx > lines->length) {
+        idx = lines->length;
+    }
+    size_t line = find_line(lines->chars, lines->count, idx);
+    if (column) {
+        *column = idx - lines->chars[line];
+    }
+    return line;
+}
+
+size_t str8linesfromoffset(str8 str, const str8lines *lines, size_t byte_pos, size_t *column) {
+    if (byte_pos > lines->size) {
+        byte_pos = lines->size;
+    }
+    size_t line = find_line(lines->offsets, lines->count, byte_pos);
+    if (column) {
+        *column = str8countrange(str, lines->offsets[line], byte_pos);
+    }
+    return line;
+}
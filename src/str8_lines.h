@@ -0,0 +1,81 @@
+/**
+ * @file str8_lines.h
+ * @brief Line index for converting between (line, column) and offsets.
+ *
+ * str8lines stores the byte offset of every line start and the number of
+ * characters in front of it. The index is built from a finished string with
+ * a single scan that counts newlines and characters together, and it is kept
+ * next to the string like the indices of str8_index.h. It must be rebuilt
+ * (or freed) when the string is modified.
+ *
+ * Lines are separated by '\n' (a '\r' in front of it belongs to the line),
+ * so a string with n newlines has n + 1 lines. Lines and columns start at 0
+ * and columns are counted in characters. Converting a line to its start is
+ * O(1), converting an offset to its line is a binary search over the line
+ * starts. The column of a byte offset (and the byte offset of a column) is
+ * resolved with the checkpoints of the string (see str8getidx()), so long
+ * lines are not scanned from their start.
+ */
+#ifndef STR8_LINES_H
+#define STR8_LINES_H
+
+#include "str8.h"
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+    uint64_t *offsets;  //< Byte offset of each line start (offsets[0] is 0)
+    uint64_t *chars;    //< Characters in front of each line start
+    size_t count;       //< Number of lines (newlines + 1)
+    size_t size;        //< Size of the string in bytes
+    size_t length;      //< Length of the string in characters
+} str8lines;
+
+/**
+ * @brief Build the line index of str.
+ *
+ * @returns 0 on success or -1 if the memory could not be allocated.
+ */
+int str8linesbuild(str8lines *lines, str8 str);
+
+void str8linesfree(str8lines *lines);
+
+/** @brief Return the number of bytes the index uses. */
+size_t str8linessize(const str8lines *lines);
+
+/** @brief Return the byte offset of the start of line (the size of the string if line >= lines->count). */
+size_t str8linestart(const str8lines *lines, size_t line);
+
+/**
+ * @brief Return the character index of (line, column).
+ *
+ * column is clamped to the end of the line (the index of its '\n'), line is
+ * clamped to the last line. The string is not accessed.
+ */
+size_t str8linesidx(const str8lines *lines, size_t line, size_t column);
+
+/**
+ * @brief Return the byte offset of (line, column) in str.
+ *
+ * line and column are clamped like by str8linesidx().
+ */
+size_t str8linesoffset(str8 str, const str8lines *lines, size_t line, size_t column);
+
+/**
+ * @brief Return the line of the character idx and write its column to column (if not NULL).
+ *
+ * idx >= str8len(str) results in the end of the last line. The string is not
+ * accessed.
+ */
+size_t str8linesfromidx(const str8lines *lines, size_t idx, size_t *column);
+
+/**
+ * @brief Return the line of the byte at byte_pos and write its column to column (if not NULL).
+ *
+ * The column is the number of characters starting in front of byte_pos in
+ * the line (see str8getidx()). byte_pos >= str8size(str) results in the end
+ * of the last line.
+ */
+size_t str8linesfromoffset(str8 str, const str8lines *lines, size_t byte_pos, size_t *column);
+
+#endif
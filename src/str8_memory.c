@@ -5,10 +5,30 @@
 #include "str8_checkpoints.h"
 #include "str8_simd.h"
 
+/**
+ * @brief Check if a string needs a descriptor byte.
+ *
+ * Only strings that could have a checkpoints list need one, and only if the
+ * descriptor differs from CHECKPOINTS_DESC_DEFAULT.
+ */
+STATIC INLINE bool has_descriptor(uint8_t type, bool ascii, size_t width, uint8_t desc) {
+    return type > STR8_TYPE1 && !ascii && !width && desc != CHECKPOINTS_DESC_DEFAULT;
+}
+
+/** @brief Return the descriptor for a checkpoints list with the given granularity. */
+STATIC INLINE uint8_t desc_from_granularity(size_t granularity) {
+    return (uint8_t)__builtin_ctzll(granularity) | STR8_INDEX_LIST;
+}
+
 /**
  * @brief Calculate the total number of bytes needed for the header.
+ *
+ * Strings with a uniform character width (see STR8_WIDTH()) have no
+ * checkpoints list, the descriptor desc (see STR8_DESCRIPTOR()) decides
+ * about the other ones.
  */
-STATIC size_t calc_header_size(uint8_t type, bool ascii, size_t capacity) {
+STATIC size_t calc_header_size(uint8_t type, bool ascii, size_t width, uint8_t desc,
+                               size_t capacity) {
     if (type == STR8_TYPE0) {
         return 1;
     }
@@ -20,38 +40,89 @@ STATIC size_t calc_header_size(uint8_t type, bool ascii, size_t capacity) {
     }
     // + length field
     size += field_size;
-    if (type == STR8_TYPE1) {
+    if (type == STR8_TYPE1 || width) {
         // type 1 does not have a checkpoints list
         return size;
     }
-    // size of checkpoints list
-    size += checkpoints_list_total_size(capacity);
+    if (has_descriptor(type, ascii, width, desc)) {
+        size += 1;
+    }
+    size_t granularity = (size_t)1 << (desc & STR8_DESC_SHIFT);
+    if ((desc & STR8_DESC_INDEX) == STR8_INDEX_LIST) {
+        // size of checkpoints list
+        size += checkpoints_list_total_size(capacity, granularity);
+    }
+    else if ((desc & STR8_DESC_INDEX) == STR8_INDEX_CHARS) {
+        size += checkpoints_anchors_total_size(type, capacity, granularity);
+    }
+    else if ((desc & STR8_DESC_INDEX) == STR8_INDEX_TWOLEVEL) {
+        size += checkpoints_twolevel_total_size(type, capacity, granularity);
+    }
     return size;
 }
 
-STATIC INLINE void str8init(str8 str, uint8_t type, bool ascii, size_t capacity) {
+/** @brief Return the header size of an existing string. */
+STATIC INLINE size_t str8_header_size(str8 str) {
+    return calc_header_size(STR8_TYPE(str), STR8_IS_ASCII(str), STR8_WIDTH(str),
+                            STR8_DESCRIPTOR(str), str8cap(str));
+}
+
+/** @brief Set the descriptor flag and byte of str if it needs them (see has_descriptor()). */
+STATIC INLINE void str8setdesc(str8 str, uint8_t type, bool ascii, size_t width, uint8_t desc) {
+    if (has_descriptor(type, ascii, width, desc)) {
+        str[-1] |= STR8_FLAG_DESC;
+        STR8_DESC(str) = desc;
+    }
+}
+
+/** @brief Put all entries of the checkpoints list of str (if it has one with entries) on the grid. */
+STATIC INLINE void str8resettail(str8 str) {
+    void *list = checkpoints_list_ptr(str);
+    if (list && str8cap(str) >> STR8_GRANULARITY_SHIFT(str) >= CHECKPOINTS_TAIL_MIN_COUNT) {
+        checkpoints_write_tail(list, (checkpoints_tail){ 0, 0 });
+    }
+}
+
+STATIC INLINE void str8init(str8 str, uint8_t type, bool ascii, size_t width, uint8_t desc,
+                            size_t capacity) {
     str[0] = '\0';
     str[-1] = type;
     if (type != STR8_TYPE0 && !ascii) {
-        str[-1] |= 0x80;
+        str[-1] |= STR8_FLAG_UTF8 | STR8_WIDTH_BITS(width);
     }
+    str8setdesc(str, type, ascii, width, desc);
     str8setsize(str, 0);
     str8setlen(str, 0);
     str8setcap(str, capacity);
+    str8resettail(str);
 }
 
-/** @brief Allocate memory return an initialized str8. */
-str8 str8_allocate(uint8_t type, bool ascii, size_t capacity, str8_allocator alloc) {
-    size_t header_size = calc_header_size(type, ascii, capacity);
+/**
+ * @brief Allocate memory return an initialized str8.
+ *
+ * There is no list if width is set, otherwise desc decides about it.
+ */
+STATIC INLINE str8 str8_allocate_(uint8_t type, bool ascii, size_t width, uint8_t desc,
+                                  size_t capacity, str8_allocator alloc) {
+    size_t header_size = calc_header_size(type, ascii, width, desc, capacity);
     void *mem = alloc(header_size + capacity + 1);  // + '\0'
     if (!mem) {
         return NULL;
     }
     str8 str = (char*)mem + header_size;
-    str8init(str, type, ascii, capacity);
+    str8init(str, type, ascii, width, desc, capacity);
     return str;
 }
 
+str8 str8_allocate(uint8_t type, bool ascii, size_t capacity, str8_allocator alloc) {
+    return str8_allocate_(type, ascii, 0, CHECKPOINTS_DESC_DEFAULT, capacity, alloc);
+}
+
+str8 str8_allocate_desc(uint8_t type, bool ascii, size_t width, uint8_t desc, size_t capacity,
+                        str8_allocator alloc) {
+    return str8_allocate_(type, ascii, width, desc, capacity, alloc);
+}
+
 STATIC INLINE str8 str8new_type0_(const char *str, size_t size, str8_allocator alloc) {
     str8 new = str8_allocate(STR8_TYPE0, false, size, alloc);
     if (!new) {
@@ -63,7 +134,7 @@ STATIC INLINE str8 str8new_type0_(const char *str, size_t size, str8_allocator a
     return new;
 }
 
-STATIC INLINE uint8_t type_from_capacity(size_t cap) {
+uint8_t type_from_capacity(size_t cap) {
     if (cap <= 31) {
         return STR8_TYPE0;
     }
@@ -79,7 +150,23 @@ STATIC INLINE uint8_t type_from_capacity(size_t cap) {
     return STR8_TYPE8;
 }
 
-STATIC INLINE str8 str8newsize_(const char *str, size_t max_size, str8_allocator alloc) {
+size_t granularity_from_size(size_t size) {
+    return size >= STR8_DENSE_THRESHOLD ? STR8_DENSE_GRANULARITY : CHECKPOINTS_GRANULARITY;
+}
+
+/** @brief Clamp granularity to the supported range and round it down to a power of two. */
+STATIC INLINE size_t normalize_granularity(size_t granularity) {
+    if (granularity >= CHECKPOINTS_GRANULARITY) {
+        return CHECKPOINTS_GRANULARITY;
+    }
+    if (granularity <= CHECKPOINTS_MIN_GRANULARITY) {
+        return CHECKPOINTS_MIN_GRANULARITY;
+    }
+    return (size_t)1 << (63 - __builtin_clzll(granularity));
+}
+
+STATIC INLINE str8 str8newsize_(const char *str, size_t max_size, size_t granularity,
+                                str8_allocator alloc) {
     size_t size = strnlen(str, max_size && max_size < 32 ? max_size : 32);
     if (size < 32) {
         return str8new_type0_(str, size, alloc);
@@ -88,7 +175,9 @@ STATIC INLINE str8 str8newsize_(const char *str, size_t max_size, str8_allocator
     uint16_t list[MAX_2BYTE_INDEX + 1];
     str8_analyze_config config = {
         .list = list,
-        .list_capacity = MAX_2BYTE_INDEX + 1
+        .list_capacity = MAX_2BYTE_INDEX + 1,
+        .granularity = granularity,
+        .uniform = true
     };
     str8_analyze_results results;
 
@@ -101,12 +190,15 @@ STATIC INLINE str8 str8newsize_(const char *str, size_t max_size, str8_allocator
     }
     uint8_t type = type_from_capacity(results.size);
     bool ascii = (results.length == results.size);
+    // the list was not written for either of them
+    size_t width = results.width > 1 ? results.width : 0;
 
-    str8 new = str8_allocate(type, ascii, results.size, alloc);
+    str8 new = str8_allocate_(type, ascii, width, desc_from_granularity(granularity), results.size, alloc);
     if (!new) {
         if (results.list_created) {
             free(results.list);
         }
+        return NULL;
     }
     memcpy(new, str, results.size);
     new[results.size] = '\0';
@@ -116,7 +208,12 @@ STATIC INLINE str8 str8newsize_(const char *str, size_t max_size, str8_allocator
         str8setlen(new, results.length);
         void *checkpoints_list = checkpoints_list_ptr(new);
         if (checkpoints_list) {
-            size_t table_size = results.list_created ? checkpoints_list_total_size(results.size) : results.list_size * 2;
+            // the entries only, the tail record is written already
+            size_t tail_size = results.size / granularity >= CHECKPOINTS_TAIL_MIN_COUNT ?
+                               CHECKPOINTS_TAIL_SIZE : 0;
+            size_t table_size = results.list_created ?
+                checkpoints_list_total_size(results.size, granularity) - tail_size :
+                results.list_size * 2;
             memcpy(checkpoints_list, results.list, table_size);
         }
     }
@@ -127,16 +224,214 @@ STATIC INLINE str8 str8newsize_(const char *str, size_t max_size, str8_allocator
 }
 
 str8 str8new(const char *str) {
-    return str8newsize_(str, 0, malloc);
+    return str8newsize_(str, 0, CHECKPOINTS_GRANULARITY, malloc);
 }
 
 str8 str8newsize(const char *str, size_t max_size) {
-    return str8newsize_(str, max_size, malloc);
+    return str8newsize_(str, max_size, CHECKPOINTS_GRANULARITY, malloc);
+}
+
+/**
+ * @brief Return the size of str (at most max_size, 0 for no limit) and
+ *        count its characters.
+ *
+ * The string is processed in chunks, so it is counted while it is in the
+ * cache.
+ */
+STATIC INLINE size_t measure_(const char *str, size_t max_size, size_t *length) {
+    const size_t chunk = 16 * 1024;
+    size_t size = 0;
+    *length = 0;
+    for (;;) {
+        size_t max_chunk = chunk;
+        if (max_size != 0 && max_size - size < max_chunk) {
+            max_chunk = max_size - size;
+        }
+        size_t chunk_size = strnlen(str + size, max_chunk);
+        *length += count_chars(str + size, chunk_size);
+        size += chunk_size;
+        if (chunk_size < chunk) {
+            return size;
+        }
+    }
+}
+
+STATIC INLINE str8 str8newunindexed_(const char *str, size_t max_size, str8_allocator alloc) {
+    size_t length;
+    size_t size = measure_(str, max_size, &length);
+    if (size < 32) {
+        return str8new_type0_(str, size, alloc);
+    }
+    uint8_t type = type_from_capacity(size);
+    bool ascii = (length == size);
+    uint8_t desc = (uint8_t)CHECKPOINTS_SHIFT | STR8_INDEX_NONE;
+    str8 new = str8_allocate_(type, ascii, 0, desc, size, alloc);
+    if (!new) {
+        return NULL;
+    }
+    memcpy(new, str, size);
+    new[size] = '\0';
+    str8setsize(new, size);
+    str8setlen(new, length);
+    return new;
+}
+
+str8 str8newunindexed(const char *str, size_t max_size) {
+    return str8newunindexed_(str, max_size, malloc);
+}
+
+str8 str8newgranularity(const char *str, size_t max_size, size_t granularity) {
+    if (granularity == 0) {
+        // the list is written while the size is determined, so it takes
+        // an extra pass to know it in advance
+        granularity = granularity_from_size(max_size ? strnlen(str, max_size) : strlen(str));
+    }
+    return str8newsize_(str, max_size, normalize_granularity(granularity), malloc);
 }
 
 STATIC INLINE void *get_memory_block_start(str8 str) {
-    size_t header_size = calc_header_size(STR8_TYPE(str), STR8_IS_ASCII(str), str8cap(str));
-    return str - header_size;
+    return str - str8_header_size(str);
+}
+
+/** @brief Return the size of the header extension in front of the memory block. */
+STATIC INLINE size_t calc_extension_size(bool shared) {
+    return shared ? sizeof(size_t) : 0;
+}
+
+/** @brief Return the pointer that was returned by the allocator. */
+STATIC INLINE void *get_allocation_start(str8 str) {
+    return (char*)get_memory_block_start(str) - calc_extension_size(STR8_IS_SHARED(str));
+}
+
+/** @brief Return a pointer to the reference count of a shared string. */
+STATIC INLINE size_t *refcount_field(str8 str) {
+    return (size_t*)get_allocation_start(str);
+}
+
+/**
+ * @brief Copy the header, the checkpoints list and the string in one go.
+ *
+ * The list layout only depends on the entry index, so the whole block from
+ * get_memory_block_start() up to the terminating '\0' can be copied verbatim.
+ * Bytes between size and capacity are not copied.
+ */
+STATIC INLINE str8 str8dup_block_(str8 str, bool shared, str8_allocator alloc) {
+    size_t capacity = str8cap(str);
+    size_t size = str8size(str);
+    size_t header_size = str8_header_size(str);
+    size_t extension_size = calc_extension_size(shared);
+    char *mem = alloc(extension_size + header_size + capacity + 1);  // + '\0'
+    if (!mem) {
+        return NULL;
+    }
+    str8 new = mem + extension_size + header_size;
+    memcpy(new - header_size, get_memory_block_start(str), header_size + size + 1);
+    if (shared) {
+        *(size_t*)mem = 1;
+        new[-1] |= STR8_FLAG_SHARED;
+    }
+    else if (STR8_IS_SHARED(new)) {
+        new[-1] &= ~STR8_FLAG_SHARED;
+    }
+    return new;
+}
+
+/**
+ * @brief Copy str into a new string with capacity == size.
+ *
+ * Only the header is rebuilt. The checkpoints list of the new string is the
+ * prefix of the original list, so it is truncated instead of recomputed.
+ */
+STATIC INLINE str8 str8dup_shrink_(str8 str, str8_allocator alloc) {
+    size_t size = str8size(str);
+    uint8_t type = type_from_capacity(size);
+    if (type == STR8_TYPE0) {
+        return str8new_type0_(str, size, alloc);
+    }
+    bool ascii = STR8_IS_ASCII(str);
+    str8 new = str8_allocate_(type, ascii, STR8_WIDTH(str), STR8_DESCRIPTOR(str), size, alloc);
+    if (!new) {
+        return NULL;
+    }
+    memcpy(new, str, size + 1);
+    str8setsize(new, size);
+    if (!ascii) {
+        str8setlen(new, str8len(str));
+        void *list = checkpoints_list_ptr(new);
+        size_t list_size = checkpoints_list_total_size(size, STR8_GRANULARITY(str));
+        if (list && list_size) {
+            // the entries and the tail record in front of them (if the list has one)
+            size_t tail_size = size >> STR8_GRANULARITY_SHIFT(str) >= CHECKPOINTS_TAIL_MIN_COUNT ?
+                               CHECKPOINTS_TAIL_SIZE : 0;
+            memcpy((char*)list - tail_size, (char*)checkpoints_list_ptr(str) - tail_size, list_size);
+        }
+        if (checkpoints_anchors_ptr(new)) {
+            // the type and so the size of the anchors might differ
+            checkpoints_fill_anchors(new, 0, 0);
+        }
+        if (checkpoints_twolevel_ptr(new)) {
+            // the superblocks are behind the blocks of the capacity
+            checkpoints_fill_twolevel(new, 0, 0);
+        }
+    }
+    return new;
+}
+
+str8 str8dup(str8 str, bool shrink) {
+    if (shrink && str8cap(str) != str8size(str)) {
+        return str8dup_shrink_(str, malloc);
+    }
+    return str8dup_block_(str, false, malloc);
+}
+
+STATIC INLINE str8 str8substr_(str8 str, size_t start, size_t end, str8_allocator alloc) {
+    size_t length = str8len(str);
+    if (end > length) {
+        end = length;
+    }
+    if (start > end) {
+        start = end;
+    }
+    size_t byte_start, byte_end;
+    str8getrange(str, start, end, &byte_start, &byte_end);
+
+    size_t size = byte_end - byte_start;
+    uint8_t type = type_from_capacity(size);
+    if (type == STR8_TYPE0) {
+        return str8new_type0_(str + byte_start, size, alloc);
+    }
+    length = end - start;
+    bool ascii = (length == size);
+    // a part of a string with a uniform width has the same width,
+    // the list gets the granularity of str (see checkpoints_copy_range())
+    size_t width = ascii ? 0 : STR8_WIDTH(str);
+
+    str8 new = str8_allocate_(type, ascii, width, STR8_DESCRIPTOR(str), size, alloc);
+    if (!new) {
+        return NULL;
+    }
+    memcpy(new, str + byte_start, size);
+    new[size] = '\0';
+    str8setsize(new, size);
+
+    if (!ascii) {
+        str8setlen(new, length);
+        void *list = checkpoints_list_ptr(new);
+        if (list) {
+            checkpoints_copy_range(list, str, byte_start, start, size);
+        }
+        if (checkpoints_anchors_ptr(new)) {
+            checkpoints_fill_anchors(new, 0, 0);
+        }
+        if (checkpoints_twolevel_ptr(new)) {
+            checkpoints_fill_twolevel(new, 0, 0);
+        }
+    }
+    return new;
+}
+
+str8 str8substr(str8 str, size_t start, size_t end) {
+    return str8substr_(str, start, end, malloc);
 }
 
 STATIC INLINE void str8free_(str8 str, str8_deallocator dealloc) {
@@ -145,7 +440,10 @@ STATIC INLINE void str8free_(str8 str, str8_deallocator dealloc) {
         dealloc(&str[-1]);
         return;
     }
-    void *mem = get_memory_block_start(str);
+    if (STR8_IS_SHARED(str) && __atomic_sub_fetch(refcount_field(str), 1, __ATOMIC_ACQ_REL) != 0) {
+        return;
+    }
+    void *mem = get_allocation_start(str);
     dealloc(mem);
 }
 
@@ -153,12 +451,213 @@ void str8free(str8 str) {
     str8free_(str, free);
 }
 
+str8 str8share(str8 str) {
+    if (STR8_IS_SHARED(str)) {
+        return str;
+    }
+    size_t size = str8size(str);
+    if (STR8_TYPE(str) == STR8_TYPE0) {
+        // type 0 has no spare bits for the flag, so make it a type 1
+        bool ascii = is_ascii(str, size);
+        size_t header_size = calc_header_size(STR8_TYPE1, ascii, 0, CHECKPOINTS_DESC_DEFAULT, size);
+        size_t extension_size = calc_extension_size(true);
+        char *mem = malloc(extension_size + header_size + size + 1);
+        if (!mem) {
+            return NULL;
+        }
+        str8 new = mem + extension_size + header_size;
+        str8init(new, STR8_TYPE1, ascii, 0, CHECKPOINTS_DESC_DEFAULT, size);
+        memcpy(new, str, size + 1);
+        str8setsize(new, size);
+        str8setlen(new, ascii ? size : count_chars(str, size));
+        new[-1] |= STR8_FLAG_SHARED;
+        *(size_t*)mem = 1;
+        str8free(str);
+        return new;
+    }
+    size_t header_size = str8_header_size(str);
+    size_t extension_size = calc_extension_size(true);
+    char *mem = realloc(get_memory_block_start(str), extension_size + header_size + str8cap(str) + 1);
+    if (!mem) {
+        return NULL;
+    }
+    memmove(mem + extension_size, mem, header_size + size + 1);
+    str8 new = mem + extension_size + header_size;
+    new[-1] |= STR8_FLAG_SHARED;
+    *(size_t*)mem = 1;
+    return new;
+}
+
+str8 str8retain(str8 str) {
+    __atomic_add_fetch(refcount_field(str), 1, __ATOMIC_RELAXED);
+    return str;
+}
+
+/**
+ * @brief Copy on write: return a string that is safe to modify.
+ *
+ * If str is shared with other owners, a copy (with its own reference count)
+ * is returned and the reference to str is dropped. Otherwise str is returned.
+ */
+STATIC INLINE str8 str8cow_(str8 str) {
+    if (!STR8_IS_SHARED(str) || __atomic_load_n(refcount_field(str), __ATOMIC_ACQUIRE) == 1) {
+        return str;
+    }
+    str8 copy = str8dup_block_(str, true, malloc);
+    if (!copy) {
+        return NULL;
+    }
+    str8free(str);
+    return copy;
+}
+
+str8 str8unshare(str8 str) {
+    return str8cow_(str);
+}
+
+/**
+ * @brief Change the size of the header of str to new_header_size.
+ *
+ * The fields and the string are moved, everything in front of the fields
+ * (descriptor byte and checkpoints list) needs to be written by the caller.
+ * str needs to have a length field.
+ */
+STATIC str8 str8resizeheader_(str8 str, size_t new_header_size, str8_reallocator realloc) {
+    size_t header_size = str8_header_size(str);
+    size_t fields_size = 1 + 3 * STR8_FIELD_SIZE(STR8_TYPE(str));
+    // fields, string and '\0'
+    size_t moved_size = fields_size + str8size(str) + 1;
+    size_t extension_size = calc_extension_size(STR8_IS_SHARED(str));
+    size_t capacity = str8cap(str);
+    char *mem = get_allocation_start(str);
+    if (new_header_size < header_size) {
+        // move down first, then shrink
+        size_t diff = header_size - new_header_size;
+        memmove(str - fields_size - diff, str - fields_size, moved_size);
+        str -= diff;
+    }
+    char *new_mem = realloc(mem, extension_size + new_header_size + capacity + 1);
+    if (!new_mem) {
+        // a block that should shrink is large enough anyways
+        return new_header_size > header_size ? NULL : str;
+    }
+    str = new_mem + extension_size + (new_header_size < header_size ? new_header_size : header_size);
+    if (new_header_size > header_size) {
+        size_t diff = new_header_size - header_size;
+        memmove(str - fields_size + diff, str - fields_size, moved_size);
+        str += diff;
+    }
+    return str;
+}
+
+/** @brief Check if str is a string whose index can be chosen (see has_descriptor()). */
+STATIC INLINE bool has_index_choice(str8 str) {
+    return STR8_TYPE(str) > STR8_TYPE1 && !STR8_IS_ASCII(str) && !STR8_WIDTH(str);
+}
+
+/**
+ * @brief Replace the index of str with the one described by desc and write it.
+ *
+ * If an index is built and the characters of str have a uniform width, the
+ * string gets none (see STR8_WIDTH()).
+ */
+STATIC str8 str8setindex_(str8 str, uint8_t desc) {
+    str = str8cow_(str);
+    if (!str) {
+        return NULL;
+    }
+    uint8_t type = STR8_TYPE(str);
+    size_t size = str8size(str);
+    size_t width = 0;
+    if ((desc & STR8_DESC_INDEX) != STR8_INDEX_NONE) {
+        width = str8_uniform_width(str, size, str8len(str));
+    }
+    desc = width ? CHECKPOINTS_DESC_DEFAULT : desc;
+    str = str8resizeheader_(str, calc_header_size(type, false, width, desc, str8cap(str)), realloc);
+    if (!str) {
+        return NULL;
+    }
+    str[-1] = (str[-1] & ~STR8_FLAG_DESC) | STR8_WIDTH_BITS(width);
+    str8setdesc(str, type, false, width, desc);
+    str8resettail(str);
+    void *list = checkpoints_list_ptr(str);
+    if (list) {
+        checkpoints_count_range(list, str, 0, size, 0, STR8_GRANULARITY(str));
+    }
+    if (checkpoints_anchors_ptr(str)) {
+        checkpoints_fill_anchors(str, 0, 0);
+    }
+    if (checkpoints_twolevel_ptr(str)) {
+        checkpoints_fill_twolevel(str, 0, 0);
+    }
+    return str;
+}
+
+str8 str8buildindex(str8 str, size_t granularity) {
+    if (!has_index_choice(str) || STR8_INDEX(str) == STR8_INDEX_LIST) {
+        return str;
+    }
+    if (granularity == 0) {
+        granularity = granularity_from_size(str8size(str));
+    }
+    return str8setindex_(str, desc_from_granularity(normalize_granularity(granularity)));
+}
+
+str8 str8buildcharindex(str8 str, size_t distance) {
+    if (!has_index_choice(str)) {
+        return str;
+    }
+    if (distance == 0) {
+        distance = STR8_ANCHOR_DISTANCE;
+    }
+    distance = distance < STR8_MIN_ANCHOR_DISTANCE ? STR8_MIN_ANCHOR_DISTANCE :
+               distance > STR8_MAX_ANCHOR_DISTANCE ? STR8_MAX_ANCHOR_DISTANCE : distance;
+    // round down to a power of two
+    uint8_t desc = (uint8_t)(63 - __builtin_clzll(distance)) | STR8_INDEX_CHARS;
+    if (STR8_DESCRIPTOR(str) == desc) {
+        return str;
+    }
+    return str8setindex_(str, desc);
+}
+
+str8 str8buildtwolevelindex(str8 str, size_t granularity) {
+    if (!has_index_choice(str)) {
+        return str;
+    }
+    if (granularity == 0) {
+        granularity = granularity_from_size(str8size(str));
+    }
+    uint8_t desc = (uint8_t)__builtin_ctzll(normalize_granularity(granularity)) | STR8_INDEX_TWOLEVEL;
+    if (STR8_DESCRIPTOR(str) == desc) {
+        return str;
+    }
+    return str8setindex_(str, desc);
+}
+
+str8 str8dropindex(str8 str) {
+    if (!has_index_choice(str) || STR8_INDEX(str) == STR8_INDEX_NONE) {
+        return str;
+    }
+    return str8setindex_(str, (uint8_t)CHECKPOINTS_SHIFT | STR8_INDEX_NONE);
+}
+
 STATIC INLINE str8 str8grow_(str8 str, size_t new_capacity, bool utf8, str8_reallocator realloc) {
     uint8_t type = STR8_TYPE(str);
     size_t capacity = str8cap(str);
+    // a string with a uniform width gets a list, as it is about to be modified
+    size_t width = STR8_WIDTH(str);
     
     if (new_capacity <= capacity) {
-        return str;
+        // an ASCII header needs to be extended for UTF-8 content anyways
+        if (!width && (!utf8 || type == STR8_TYPE0 || !STR8_IS_ASCII(str))) {
+            return str;
+        }
+        new_capacity = capacity;
+    }
+
+    str = str8cow_(str);
+    if (!str) {
+        return NULL;
     }
 
     uint8_t new_type = type_from_capacity(new_capacity);
@@ -167,7 +666,8 @@ STATIC INLINE str8 str8grow_(str8 str, size_t new_capacity, bool utf8, str8_real
         // happens again, type 0 is insufficient for that
         new_type = STR8_TYPE1;
     }
-    bool ascii = STR8_IS_ASCII(str);
+    // type 0 uses the flag bit for its size
+    bool ascii = type == STR8_TYPE0 ? is_ascii(str, STR8_TYPE0_SIZE(str)) : STR8_IS_ASCII(str);
     size_t size = str8size(str);
     size_t length = size;
     
@@ -175,26 +675,41 @@ STATIC INLINE str8 str8grow_(str8 str, size_t new_capacity, bool utf8, str8_real
         length = str8len(str);
     }
 
-    size_t header_size = calc_header_size(type, ascii, capacity);
-    size_t new_header_size = calc_header_size(new_type, ascii && !utf8, new_capacity);
-
-    void *mem = get_memory_block_start(str);
-    void *new_mem = realloc(mem, new_header_size + new_capacity + 1);
+    bool shared = STR8_IS_SHARED(str);
+    size_t extension_size = calc_extension_size(shared);
+    // the descriptor is kept, a new list (of a string with a uniform width or
+    // an ASCII string) gets the default one
+    uint8_t desc = STR8_DESCRIPTOR(str);
+    size_t header_size = calc_header_size(type, ascii, width, desc, capacity);
+    size_t new_header_size = calc_header_size(new_type, ascii && !utf8, 0, desc, new_capacity);
+
+    // a list with few entries has no tail record yet
+    bool had_list = checkpoints_list_ptr(str) != NULL;
+    size_t shift = STR8_GRANULARITY_SHIFT(str);
+    bool had_tail = had_list && capacity >> shift >= CHECKPOINTS_TAIL_MIN_COUNT;
+    size_t list_size = had_list ? checkpoints_list_total_size(capacity, (size_t)1 << shift) : 0;
+
+    void *mem = get_allocation_start(str);
+    void *new_mem = realloc(mem, extension_size + new_header_size + new_capacity + 1);
     if (!new_mem) {
         return NULL;
     }
 
     // str might be dangling after realloc
-    str = (char*)new_mem + header_size;
+    str = (char*)new_mem + extension_size + header_size;
 
     // amount mem needs to be moved to the right, to align correctly
     // with the new header size
-    size_t memory_diff = new_header_size - calc_header_size(type, ascii, capacity);
+    size_t memory_diff = new_header_size - header_size;
 
     // 1.  The header size did not change, so everything is still in place
     
     if (memory_diff == 0) {
+        str[-1] &= ~STR8_FLAG_WIDTH;
         str8setcap(str, new_capacity);
+        if (!had_tail) {
+            str8resettail(str);
+        }
         return str;
     }
 
@@ -203,14 +718,43 @@ STATIC INLINE str8 str8grow_(str8 str, size_t new_capacity, bool utf8, str8_real
     memmove(str + memory_diff, str, size + 1);
     // fix str
     str += memory_diff;
+    if (had_list && !had_tail && new_capacity >> shift >= CHECKPOINTS_TAIL_MIN_COUNT) {
+        // the list gets a tail record in front of its entries
+        char *list_start = (char*)new_mem + extension_size;
+        memmove(list_start + CHECKPOINTS_TAIL_SIZE, list_start, list_size);
+    }
     // update fields
     str[-1] = new_type;
     if (!ascii || utf8) {
-        str[-1] |= 0x80;
+        str[-1] |= STR8_FLAG_UTF8;
+    }
+    if (shared) {
+        str[-1] |= STR8_FLAG_SHARED;
     }
+    str8setdesc(str, new_type, ascii && !utf8, 0, desc);
     str8setsize(str, size);
     str8setlen(str, length);
     str8setcap(str, new_capacity);
+    if (!had_tail) {
+        str8resettail(str);
+    }
+
+    if (new_type != type && checkpoints_anchors_ptr(str)) {
+        // the size of the anchors changed with the type
+        checkpoints_fill_anchors(str, 0, 0);
+    }
+    if (checkpoints_twolevel_ptr(str)) {
+        // the superblocks are behind the blocks of the capacity
+        checkpoints_fill_twolevel(str, 0, 0);
+    }
+    void *list = checkpoints_list_ptr(str);
+    if (width && list) {
+        checkpoints_fill_uniform(list, 0, size/CHECKPOINTS_GRANULARITY, width, CHECKPOINTS_GRANULARITY);
+    }
+    else if (!had_list && !ascii && list) {
+        // type 1 had no list, but might have had entries with a fine granularity
+        checkpoints_count_range(list, str, 0, size, 0, STR8_GRANULARITY(str));
+    }
 
     return str;
 }
@@ -219,7 +763,7 @@ str8 str8grow(str8 str, size_t new_capacity, bool utf8) {
     return str8grow_(str, new_capacity, utf8, realloc);
 }
 
-STATIC INLINE size_t calc_cap_with_prealloc(size_t new_size) {
+size_t calc_cap_with_prealloc(size_t new_size) {
     size_t realloc = new_size / 2;
     realloc = realloc > STR8_MAX_PREALLOC ? STR8_MAX_PREALLOC : realloc;
     return new_size + realloc;
@@ -229,6 +773,10 @@ str8 str8append_(str8 str, const char *other, size_t max_size, str8_reallocator
     if (other == NULL || *other == '\0') {
         return str;
     }
+    str = str8cow_(str);
+    if (!str) {
+        return NULL;
+    }
     size_t size = str8size(str);
     size_t capacity = str8cap(str);
     bool ascii = STR8_IS_ASCII(str);
@@ -258,54 +806,32 @@ str8 str8append_(str8 str, const char *other, size_t max_size, str8_reallocator
     new[new_size] = '\0';
     str8setsize(new, new_size);
 
-    if (STR8_TYPE(new) == STR8_TYPE1) {
-        if (!new_ascii) {
-            str8setlen(new, count_chars(new, new_size));
+    // the length is stored (and the list needs updating) if either part is non-ASCII
+    bool has_length = !STR8_IS_ASCII(new);
+
+    if (STR8_TYPE(new) == STR8_TYPE1 || STR8_INDEX(new) != STR8_INDEX_LIST) {
+        // no list to update
+        if (has_length) {
+            str8setlen(new, length + (new_ascii ? other_size : count_chars(other, other_size)));
+        }
+        if (checkpoints_anchors_ptr(new)) {
+            checkpoints_fill_anchors(new, size, length);
+        }
+        if (checkpoints_twolevel_ptr(new)) {
+            checkpoints_fill_twolevel(new, size, length);
         }
         return new;
     }
 
+    size_t granularity = STR8_GRANULARITY(new);
     if (ascii && !new_ascii) {
         // build table for original str
-        void *list_entry = checkpoints_list_ptr(new);
-        for (size_t idx=0; idx<size/CHECKPOINTS_GRANULARITY; idx++) {
-            size_t val = (idx+1) * CHECKPOINTS_GRANULARITY;
-            if (idx <= MAX_2BYTE_INDEX) {
-                *(uint16_t*)list_entry = (uint16_t)val;
-                list_entry += sizeof(uint16_t);
-            }
-            else if (idx <= MAX_4BYTE_INDEX) {
-                *(uint32_t*)list_entry = (uint32_t)val;
-                list_entry += sizeof(uint32_t);
-            }
-            else {
-                *(uint64_t*)list_entry = (uint64_t)val;
-                list_entry += sizeof(uint64_t);
-            }
-        }
+        checkpoints_fill_ascii(checkpoints_list_ptr(new), 0, size/granularity, granularity);
     }
 
-    if (!new_ascii) {
-        void *list = checkpoints_list_ptr(new);
-        size_t new_length;
-            
-        size_t list_capacity = new_capacity / CHECKPOINTS_GRANULARITY;
-        str8_analyze_config config = {
-            .list = list,
-            .list_capacity = list_capacity,
-            .byte_offset = size,
-            .list_start_idx = size / CHECKPOINTS_GRANULARITY,
-            .char_idx_offset = length
-        };
-        str8_analyze_results results;
-        int error = str8_analyze(other, max_size, config, &results);
-        if (error != 0) {
-            str8free(new);
-            return NULL;
-        }
-        new_length = length + results.length;
-        
-        str8setlen(new, new_length);
+    if (has_length) {
+        str8setlen(new, checkpoints_append(checkpoints_list_ptr(new), new, size, new_size, length,
+                                           granularity));
     }
 
     return new;
@@ -10,17 +10,169 @@
 #include "str8_debug.h"
 
 #define STR8_MAX_PREALLOC (1024*1024)
+/** @brief Strings of at least this size get STR8_DENSE_GRANULARITY (see str8newgranularity()). */
+#define STR8_DENSE_THRESHOLD (64*1024*1024)
+#define STR8_DENSE_GRANULARITY 128
+/** @brief Default and range of the distance of character anchors (see str8buildcharindex()). */
+#define STR8_ANCHOR_DISTANCE 64
+#define STR8_MIN_ANCHOR_DISTANCE 8
+#define STR8_MAX_ANCHOR_DISTANCE 65536
 
 typedef void*(*str8_allocator)(size_t);
 typedef void*(*str8_reallocator)(void *, size_t);
 typedef void(*str8_deallocator)(void *);
 
 
+/** @brief Return the smallest type whose fields can hold capacity. */
+uint8_t type_from_capacity(size_t cap);
 str8 str8_allocate(uint8_t type, bool ascii, size_t capacity, str8_allocator alloc);
+/**
+ * @brief Like str8_allocate(), but with a uniform width (see STR8_WIDTH()) and
+ *        the descriptor desc (see STR8_DESCRIPTOR()), e.g. the one of another string.
+ *
+ * The index is left to the caller (the tail record of a list is written).
+ */
+str8 str8_allocate_desc(uint8_t type, bool ascii, size_t width, uint8_t desc, size_t capacity,
+                        str8_allocator alloc);
 str8 str8new(const char *str);
 str8 str8newsize(const char *str, size_t max_size);
+/** @brief Return the checkpoints granularity for a string of size bytes. */
+size_t granularity_from_size(size_t size);
+/**
+ * @brief Like str8newsize(), but with a checkpoints granularity for the string.
+ *
+ * A finer granularity makes str8getchar() faster at the cost of a larger
+ * checkpoints list. The granularity is rounded down to a power of two and
+ * clamped to [CHECKPOINTS_MIN_GRANULARITY, CHECKPOINTS_GRANULARITY].
+ * If it is 0, it is chosen by granularity_from_size() (which needs one more
+ * pass over str).
+ * The granularity is kept by the in-place modifications, str8dup() and
+ * str8substr(). ASCII strings, strings with a uniform width and strings
+ * below 256 bytes have no list and use the default granularity once they
+ * get one.
+ */
+str8 str8newgranularity(const char *str, size_t max_size, size_t granularity);
+/**
+ * @brief Like str8newsize(), but without an index.
+ *
+ * Only size, length and the ASCII flag are determined. Without a list
+ * str8getchar() has to scan the string, so call str8buildindex() before
+ * accessing characters by index. The string stays without an index when it
+ * is modified, parts of it (str8substr()) and copies as well.
+ * This is recorded in the descriptor byte, which ASCII strings and strings
+ * below 256 bytes do not have (they need no list). Such a string gets the
+ * default list once a modification makes it need one (non-ASCII content or
+ * 256 bytes and more), like parts and copies that are ASCII or short do.
+ */
+str8 str8newunindexed(const char *str, size_t max_size);
+/**
+ * @brief Build the checkpoints list of a string without an index (see
+ *        str8newunindexed()), with character anchors or a two-level index.
+ *
+ * granularity is treated like by str8newgranularity(). A string with a
+ * uniform width does not get a list (see STR8_WIDTH()). Strings with a list
+ * are returned unchanged.
+ * str must not be used after the call, use the returned string instead.
+ */
+str8 str8buildindex(str8 str, size_t granularity);
+/**
+ * @brief Replace the index of str with the byte offsets of every distance'
+ *        character (STR8_INDEX_CHARS).
+ *
+ * str8getchar() reads the anchor in front of the character and scans less
+ * than distance characters from there, without a search. The anchors are
+ * rewritten behind the first modified character by every modification, so
+ * this is meant for strings that are mostly read.
+ * distance is rounded down to a power of two and clamped to
+ * [STR8_MIN_ANCHOR_DISTANCE, STR8_MAX_ANCHOR_DISTANCE], 0 selects
+ * STR8_ANCHOR_DISTANCE. ASCII strings, strings with a uniform width and
+ * strings below 256 bytes are returned unchanged, they need no index.
+ * str must not be used after the call, use the returned string instead.
+ */
+str8 str8buildcharindex(str8 str, size_t distance);
+/**
+ * @brief Replace the index of str with a two-level index (STR8_INDEX_TWOLEVEL).
+ *
+ * Instead of the list the header stores the characters in front of every
+ * superblock of STR8_TWOLEVEL_BLOCKS blocks and the characters up to the end
+ * of every block relative to its superblock as u16, about 2 bytes per block
+ * instead of 4 or 8 in the upper zones of the list. str8getchar() searches
+ * the superblocks, which stay in cache, and scans the blocks of one without
+ * branches. Like the anchors, the index is rewritten behind the first
+ * modified character by every modification, so this is meant for strings
+ * that are mostly read.
+ * granularity (the size of a block) is treated like by str8newgranularity().
+ * ASCII strings, strings with a uniform width and strings below 256 bytes
+ * are returned unchanged, they need no index.
+ * str must not be used after the call, use the returned string instead.
+ */
+str8 str8buildtwolevelindex(str8 str, size_t granularity);
+/**
+ * @brief Remove the index of str (checkpoints list, anchors or two-level index) to save memory.
+ *
+ * Strings without an index are returned unchanged.
+ * str must not be used after the call, use the returned string instead.
+ */
+str8 str8dropindex(str8 str);
+/** @brief Free str, or drop a reference if str is shared. */
 void str8free(str8 str);
+
+/**
+ * @brief Return a copy of str.
+ *
+ * Without shrink the memory block (header, checkpoints list and string) is
+ * copied as is, so no analysis of the string is necessary.
+ * With shrink the copy gets capacity == size. Only the header is rebuilt and
+ * the checkpoints list is truncated to the entries covering the string.
+ */
+str8 str8dup(str8 str, bool shrink);
+/**
+ * @brief Return a new string with the characters [start, end) of str.
+ *
+ * end is clamped to the length of str and start is clamped to end.
+ * Both boundaries are resolved with a single checkpoints list search and the
+ * checkpoints of the new string are derived from the list of str, so the
+ * substring is not analyzed again.
+ */
+str8 str8substr(str8 str, size_t start, size_t end);
+
+/**
+ * @brief Turn str into a reference counted string.
+ *
+ * The reference count is stored in front of the header, so retaining and
+ * releasing is O(1) and all owners share the same memory block (including
+ * the checkpoints list). Mutating functions (str8grow(), str8append(), ...)
+ * copy the string if it is referenced more than once.
+ * str must not be used after the call, use the returned string instead.
+ *
+ * @returns The shared string (with a reference count of 1) or NULL on failure.
+ */
+str8 str8share(str8 str);
+
+/** @brief Add a reference to a shared string. Release it with str8free(). */
+str8 str8retain(str8 str);
+
+/**
+ * @brief Return a string that can be modified without affecting other owners.
+ *
+ * If str is shared with other owners it is copied and the reference to str
+ * is dropped. Call this before writing to the buffer directly.
+ */
+str8 str8unshare(str8 str);
+
+/**
+ * @brief Make sure str can hold new_capacity bytes.
+ *
+ * If utf8 is set, an ASCII header is extended for UTF-8 content (length
+ * field and checkpoints list), even if the capacity is sufficient already.
+ * The entries of the new list are not initialized.
+ * A string with a uniform width (see STR8_WIDTH()) always gets a list
+ * (with initialized entries), since its content is about to change.
+ */
 str8 str8grow(str8 str, size_t new_capacity, bool utf8);
+
+/** @brief Return the capacity to allocate for a string growing to new_size. */
+size_t calc_cap_with_prealloc(size_t new_size);
 str8 str8append(str8 str, const char *other);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,371 @@
+#include "str8_ngram.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include "str8_header.h"
+#include "str8_checkpoints.h"
+#include "str8_simd.h"
+#include "str8_debug.h"
+
+/** @brief Bytes of the string per bucket, the buckets are about as large. */
+#define NGRAM_BYTES_PER_BUCKET 16
+#define NGRAM_MIN_BITS 8
+#define NGRAM_MAX_BITS 24
+/** @brief Maximum number of build threads. */
+#define NGRAM_MAX_THREADS 64
+/** @brief Minimum number of trigrams per build thread. */
+#define NGRAM_MIN_CHUNK (1 << 16)
+
+/** @brief Header of a serialized index. */
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t bits;
+    uint64_t count;
+    uint64_t size;
+} ngram_header;
+
+static const char ngram_magic[4] = { 'S', '8', 'N', 'G' };
+#define NGRAM_VERSION 1
+
+/** @brief Return the bucket of the trigram at p. */
+STATIC INLINE uint32_t ngram_bucket(const char *p, size_t bits) {
+    const uint8_t *u = (const uint8_t *)p;
+    uint32_t trigram = (uint32_t)u[0] | (uint32_t)u[1] << 8 | (uint32_t)u[2] << 16;
+    return (trigram * 2654435761u) >> (32 - bits);
+}
+
+STATIC INLINE size_t ngram_bucket_count(const str8ngram *index) {
+    return (size_t)1 << index->bits;
+}
+
+/** @brief Work of one build thread: the trigrams starting in [first, end). */
+typedef struct {
+    str8ngram *index;
+    const char *str;
+    uint32_t *cursors;  //< Counters of the buckets of this thread
+    size_t first;
+    size_t end;
+    bool fill;          //< Write the postings instead of counting them
+} ngram_job;
+
+/**
+ * @brief Count the trigrams of the part of job per bucket or write them.
+ *
+ * While writing, the cursors are the next free slots of the buckets.
+ */
+STATIC void *ngram_run(void *arg) {
+    ngram_job *job = arg;
+    str8ngram *index = job->index;
+    uint32_t *cursors = job->cursors;
+    if (job->fill) {
+        for (size_t pos=job->first; pos<job->end; pos++) {
+            index->postings[cursors[ngram_bucket(job->str + pos, index->bits)]++] = (uint32_t)pos;
+        }
+    }
+    else {
+        for (size_t pos=job->first; pos<job->end; pos++) {
+            cursors[ngram_bucket(job->str + pos, index->bits)]++;
+        }
+    }
+    return NULL;
+}
+
+/** @brief Run the jobs in their own threads (or in this one if a thread can not be created). */
+STATIC void ngram_run_jobs(ngram_job *jobs, size_t count) {
+    pthread_t threads[NGRAM_MAX_THREADS];
+    bool started[NGRAM_MAX_THREADS];
+    for (size_t t=1; t<count; t++) {
+        started[t] = pthread_create(&threads[t], NULL, ngram_run, &jobs[t]) == 0;
+    }
+    ngram_run(&jobs[0]);
+    for (size_t t=1; t<count; t++) {
+        if (started[t]) {
+            pthread_join(threads[t], NULL);
+        }
+        else {
+            ngram_run(&jobs[t]);
+        }
+    }
+}
+
+int str8ngrambuild(str8ngram *index, str8 str, size_t threads) {
+    size_t size = str8size(str);
+    index->starts = NULL;
+    index->postings = NULL;
+    index->size = size;
+    index->count = size >= STR8_NGRAM_SIZE ? size - STR8_NGRAM_SIZE + 1 : 0;
+    if (size >= UINT32_MAX) {
+        str8ngramfree(index);
+        return -1;
+    }
+    size_t bits = NGRAM_MIN_BITS;
+    while (bits < NGRAM_MAX_BITS && ((size_t)1 << bits) * NGRAM_BYTES_PER_BUCKET < size) {
+        bits++;
+    }
+    index->bits = bits;
+    size_t buckets = ngram_bucket_count(index);
+
+    // every thread needs its own counters (about a quarter of the size of
+    // the string), so all of them together may not exceed the postings, and
+    // more threads than chunks of NGRAM_MIN_CHUNK bytes do not pay off
+    threads = threads > index->count / buckets ? index->count / buckets : threads;
+    threads = threads > index->count / NGRAM_MIN_CHUNK ? index->count / NGRAM_MIN_CHUNK : threads;
+    threads = threads < 1 ? 1 : threads > NGRAM_MAX_THREADS ? NGRAM_MAX_THREADS : threads;
+    uint32_t *cursors = calloc(threads * buckets, sizeof(uint32_t));
+    index->starts = malloc((buckets + 1) * sizeof(uint32_t));
+    index->postings = malloc((index->count ? index->count : 1) * sizeof(uint32_t));
+    if (!cursors || !index->starts || !index->postings) {
+        free(cursors);
+        str8ngramfree(index);
+        return -1;
+    }
+
+    ngram_job jobs[NGRAM_MAX_THREADS];
+    for (size_t t=0; t<threads; t++) {
+        jobs[t] = (ngram_job){
+            .index = index,
+            .str = str,
+            .cursors = cursors + t * buckets,
+            .first = t * index->count / threads,
+            .end = (t + 1) * index->count / threads,
+            .fill = false
+        };
+    }
+
+    // 1.  Count the trigrams of each part per bucket
+
+    ngram_run_jobs(jobs, threads);
+
+    // 2.  Turn the counters into the first slot of each part in each bucket,
+    //     the parts follow each other in the order of the string
+
+    uint32_t offset = 0;
+    for (size_t b=0; b<buckets; b++) {
+        index->starts[b] = offset;
+        for (size_t t=0; t<threads; t++) {
+            uint32_t count = jobs[t].cursors[b];
+            jobs[t].cursors[b] = offset;
+            offset += count;
+        }
+    }
+    index->starts[buckets] = offset;
+
+    // 3.  Write the postings, so they are sorted in every bucket
+
+    for (size_t t=0; t<threads; t++) {
+        jobs[t].fill = true;
+    }
+    ngram_run_jobs(jobs, threads);
+    free(cursors);
+    return 0;
+}
+
+void str8ngramfree(str8ngram *index) {
+    free(index->starts);
+    free(index->postings);
+    index->starts = NULL;
+    index->postings = NULL;
+    index->bits = 0;
+    index->count = 0;
+    index->size = 0;
+}
+
+size_t str8ngramsize(const str8ngram *index) {
+    return (ngram_bucket_count(index) + 1 + index->count) * sizeof(uint32_t);
+}
+
+/** @brief A posting list and the position of its trigram in the needle. */
+typedef struct {
+    const uint32_t *postings;
+    size_t count;
+    size_t shift;
+    size_t cursor;
+} ngram_list;
+
+/** @brief Return the first index >= from of a value >= target in list (or list->count). */
+STATIC INLINE size_t ngram_gallop(const ngram_list *list, size_t from, size_t target) {
+    // double the step until the target is passed, then search the last step
+    size_t step = 1;
+    size_t hi = from;
+    while (hi < list->count && list->postings[hi] < target) {
+        from = hi + 1;
+        hi += step;
+        step *= 2;
+    }
+    hi = hi < list->count ? hi : list->count;
+    while (from < hi) {
+        size_t mid = from + (hi - from) / 2;
+        if (list->postings[mid] < target) {
+            from = mid + 1;
+        }
+        else {
+            hi = mid;
+        }
+    }
+    return from;
+}
+
+/** @brief Collects the matches of a search and translates them to character indices. */
+typedef struct {
+    str8 str;
+    bool ascii;
+    size_t *results;
+    size_t capacity;
+    size_t count;
+    size_t counted_pos;    //< Byte offset of the previous match
+    size_t counted_chars;  //< Character index of the previous match
+} ngram_results;
+
+STATIC INLINE void ngram_add_result(ngram_results *r, size_t byte_pos) {
+    if (r->count < r->capacity) {
+        // the matches are ascending, so count from the previous one
+        r->counted_chars += r->ascii ? byte_pos - r->counted_pos :
+                                       str8countrange(r->str, r->counted_pos, byte_pos);
+        r->counted_pos = byte_pos;
+        r->results[r->count] = r->counted_chars;
+    }
+    r->count++;
+}
+
+size_t str8ngramfind(str8 str, const str8ngram *index, const char *needle, size_t *results, size_t capacity) {
+    size_t size = str8size(str);
+    size_t needle_size = strlen(needle);
+    ngram_results r = {
+        .str = str,
+        .ascii = STR8_TYPE(str) != STR8_TYPE0 && STR8_IS_ASCII(str),
+        .results = results,
+        .capacity = capacity
+    };
+    if (needle_size == 0 || needle_size > size) {
+        return 0;
+    }
+    if (needle_size < STR8_NGRAM_SIZE || index->size != size) {
+        // no trigram to look up or the index was not built for str, scan the string
+        const char *match = str;
+        while ((match = find_bytes(match, size - (match - str), needle, needle_size))) {
+            ngram_add_result(&r, match - str);
+            match++;
+        }
+        return r.count;
+    }
+
+    // 1.  Select the rarest posting lists of the trigrams of the needle
+
+    ngram_list lists[STR8_NGRAM_MAX_LISTS];
+    size_t list_count = 0;
+    for (size_t shift=0; shift+STR8_NGRAM_SIZE<=needle_size; shift++) {
+        uint32_t bucket = ngram_bucket(needle + shift, index->bits);
+        ngram_list list = {
+            .postings = index->postings + index->starts[bucket],
+            .count = index->starts[bucket + 1] - index->starts[bucket],
+            .shift = shift
+        };
+        // insert sorted by count, dropping the most frequent one if full
+        size_t i = list_count < STR8_NGRAM_MAX_LISTS ? list_count++ : STR8_NGRAM_MAX_LISTS;
+        for (; i > 0 && lists[i - 1].count > list.count; i--) {
+            if (i < STR8_NGRAM_MAX_LISTS) {
+                lists[i] = lists[i - 1];
+            }
+        }
+        if (i < STR8_NGRAM_MAX_LISTS) {
+            lists[i] = list;
+        }
+    }
+
+    // 2.  Intersect the lists, shifted to the start of the needle, and
+    //     compare the candidates (the buckets are hashed)
+
+    const ngram_list *base = &lists[0];
+    for (size_t i=0; i<base->count; i++) {
+        size_t pos = base->postings[i];
+        if (pos < base->shift) {
+            continue;
+        }
+        size_t candidate = pos - base->shift;
+        if (candidate + needle_size > size) {
+            break;
+        }
+        bool found = true;
+        for (size_t k=1; k<list_count && found; k++) {
+            ngram_list *list = &lists[k];
+            list->cursor = ngram_gallop(list, list->cursor, candidate + list->shift);
+            if (list->cursor == list->count) {
+                return r.count;
+            }
+            found = list->postings[list->cursor] == candidate + list->shift;
+        }
+        if (found && memcmp(str + candidate, needle, needle_size) == 0) {
+            ngram_add_result(&r, candidate);
+        }
+    }
+    return r.count;
+}
+
+size_t str8ngramserializedsize(const str8ngram *index) {
+    return sizeof(ngram_header) + str8ngramsize(index);
+}
+
+size_t str8ngramserialize(const str8ngram *index, void *buffer) {
+    ngram_header header = {
+        .version = NGRAM_VERSION,
+        .bits = index->bits,
+        .count = index->count,
+        .size = index->size
+    };
+    memcpy(header.magic, ngram_magic, sizeof(ngram_magic));
+    char *p = buffer;
+    memcpy(p, &header, sizeof(header));
+    p += sizeof(header);
+    size_t starts_size = (ngram_bucket_count(index) + 1) * sizeof(uint32_t);
+    memcpy(p, index->starts, starts_size);
+    p += starts_size;
+    memcpy(p, index->postings, index->count * sizeof(uint32_t));
+    p += index->count * sizeof(uint32_t);
+    return p - (char *)buffer;
+}
+
+int str8ngramdeserialize(str8ngram *index, const void *buffer, size_t size) {
+    ngram_header header;
+    if (size < sizeof(header)) {
+        return -1;
+    }
+    memcpy(&header, buffer, sizeof(header));
+    if (memcmp(header.magic, ngram_magic, sizeof(ngram_magic)) != 0 || header.version != NGRAM_VERSION ||
+        header.bits < NGRAM_MIN_BITS || header.bits > NGRAM_MAX_BITS || header.count >= UINT32_MAX) {
+        return -1;
+    }
+    index->bits = header.bits;
+    index->count = header.count;
+    index->size = header.size;
+    // the header, the starts and the postings must fit (bits and count are
+    // bounded, so this does not overflow)
+    size_t buckets = ngram_bucket_count(index);
+    size_t starts_size = (buckets + 1) * sizeof(uint32_t);
+    if (size - sizeof(header) < starts_size ||
+        size - sizeof(header) - starts_size < index->count * sizeof(uint32_t)) {
+        return -1;
+    }
+    index->starts = malloc(starts_size);
+    index->postings = malloc((index->count ? index->count : 1) * sizeof(uint32_t));
+    if (!index->starts || !index->postings) {
+        str8ngramfree(index);
+        return -1;
+    }
+    const char *p = (const char *)buffer + sizeof(header);
+    memcpy(index->starts, p, starts_size);
+    // the buckets are read as postings[starts[b], starts[b + 1])
+    for (size_t b=0; b<buckets; b++) {
+        if (index->starts[b] > index->starts[b + 1]) {
+            str8ngramfree(index);
+            return -1;
+        }
+    }
+    if (index->starts[buckets] != index->count) {
+        str8ngramfree(index);
+        return -1;
+    }
+    memcpy(index->postings, p + starts_size, index->count * sizeof(uint32_t));
+    return 0;
+}
@@ -0,0 +1,100 @@
+/**
+ * @file str8_ngram.h
+ * @brief Trigram index for repeated substring searches on large strings.
+ *
+ * str8ngram stores the byte offset of every trigram (3 consecutive bytes) of
+ * a string in posting lists, one per bucket of hashed trigrams. A search
+ * looks up the trigrams of the needle, intersects the rarest posting lists
+ * (shifted by the position of their trigram in the needle) and compares the
+ * remaining candidates with the string, so it does not depend on the size
+ * of the string but on the number of candidates. Needles shorter than a
+ * trigram are searched with find_bytes().
+ *
+ * Like the indices of str8_index.h, the index is built next to a finished
+ * string and has to be rebuilt when the string is modified. It takes 4 bytes
+ * per byte of the string (plus the buckets), so it is meant for large
+ * strings that are searched many times. Strings of 4 GiB and more are not
+ * supported.
+ */
+#ifndef STR8_NGRAM_H
+#define STR8_NGRAM_H
+
+#include "str8.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief Size of the n-grams. */
+#define STR8_NGRAM_SIZE 3
+/** @brief Maximum number of posting lists intersected by a search. */
+#define STR8_NGRAM_MAX_LISTS 4
+
+typedef struct {
+    uint32_t *starts;    //< Start of the posting list of each bucket in postings (buckets + 1 entries)
+    uint32_t *postings;  //< Byte offsets of the trigrams, ascending per bucket
+    size_t bits;         //< Number of buckets is 1 << bits
+    size_t count;        //< Number of postings
+    size_t size;         //< Size of the indexed string in bytes
+} str8ngram;
+
+/**
+ * @brief Build the trigram index of str with threads threads.
+ *
+ * The string is split into one part per thread. Each thread counts the
+ * trigrams of its part per bucket, then the counters are turned into the
+ * slots of the parts in the posting lists and each thread writes the
+ * postings of its part. Every thread needs 4 bytes per bucket, about a
+ * quarter of the size of the string, so threads is reduced until all
+ * counters together take at most as much memory as the postings (and parts
+ * are at least 64 KiB). threads <= 1 builds the index in the calling thread.
+ *
+ * @returns 0 on success or -1 if the memory could not be allocated or str
+ *          is too large.
+ */
+int str8ngrambuild(str8ngram *index, str8 str, size_t threads);
+
+void str8ngramfree(str8ngram *index);
+
+/** @brief Return the number of bytes the index uses. */
+size_t str8ngramsize(const str8ngram *index);
+
+/**
+ * @brief Find the matches of needle in str (indexed by index).
+ *
+ * The character indices of the first capacity matches are written to
+ * results in ascending order (overlapping matches included). They are
+ * counted from the previous match or resolved with the checkpoints of str.
+ * If the size of str differs from the one index was built for (str was
+ * modified), str is scanned with find_bytes() instead.
+ *
+ * @returns The number of matches (which can be larger than capacity).
+ */
+size_t str8ngramfind(str8 str, const str8ngram *index, const char *needle, size_t *results, size_t capacity);
+
+/** @brief Return the number of bytes str8ngramserialize() writes. */
+size_t str8ngramserializedsize(const str8ngram *index);
+
+/**
+ * @brief Write index to buffer (str8ngramserializedsize() bytes).
+ *
+ * The format is the memory layout of the index in the byte order of the
+ * machine, behind a header with the parameters. It can be stored next to
+ * the string and loaded with str8ngramdeserialize(), so the index does not
+ * have to be rebuilt.
+ *
+ * @returns The number of bytes written.
+ */
+size_t str8ngramserialize(const str8ngram *index, void *buffer);
+
+/**
+ * @brief Load an index written by str8ngramserialize().
+ *
+ * Besides the header, the starts of the buckets are checked (they must not
+ * decrease and end at the number of postings) and everything must fit in
+ * size bytes. The postings themselves are not checked.
+ *
+ * @returns 0 on success or -1 if buffer does not hold an index or the
+ *          memory could not be allocated.
+ */
+int str8ngramdeserialize(str8ngram *index, const void *buffer, size_t size);
+
+#endif
@@ -0,0 +1,376 @@
+#include "str8_patterns.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "str8_header.h"
+#include "str8_checkpoints.h"
+#include "str8_simd.h"
+#include "str8_debug.h"
+
+/** @brief Number of Teddy buckets (one bit of the nibble tables each). */
+#define TEDDY_BUCKETS 8
+/** @brief Number of bytes at the end of the patterns used by the Teddy filter. */
+#define TEDDY_WIDTH 3
+/** @brief Set in a transition of the automaton if the target state has matches. */
+#define AC_MATCH 0x80000000u
+/** @brief A missing transition while the trie is built. */
+#define AC_NONE UINT32_MAX
+
+struct str8patterns {
+    char *data;           //< The patterns, each terminated by '\0'
+    size_t *offsets;      //< Offset of each pattern in data
+    size_t *sizes;        //< Size of each pattern in bytes
+    size_t count;         //< Number of patterns
+    size_t active;        //< Number of non-empty patterns
+    bool any_ascii;       //< There is a pattern without non-ASCII bytes
+    bool automaton;       //< Use the automaton instead of Teddy
+
+    // Teddy
+    size_t *order;                       //< Non-empty patterns by size (descending), then index
+    size_t buckets[TEDDY_BUCKETS + 1];   //< Range of each bucket in order
+    size_t width;                        //< Number of fingerprint bytes
+    uint8_t lo[TEDDY_WIDTH][16];         //< Buckets by the low nibble of each fingerprint byte
+    uint8_t hi[TEDDY_WIDTH][16];         //< Buckets by the high nibble of each fingerprint byte
+
+    // Aho-Corasick
+    uint8_t classes[256];     //< Class of each byte (0 for bytes not in any pattern)
+    size_t class_count;       //< Number of classes
+    uint32_t *transitions;    //< Row of the next state per state and class (with AC_MATCH)
+    uint32_t *dict;           //< Next state with patterns along the suffix links (0 if none)
+    uint32_t *output_start;   //< Patterns ending at state s are outputs[output_start[s]..output_start[s+1]]
+    uint32_t *outputs;        //< Pattern indices, ascending per state
+    size_t state_count;       //< Number of states
+};
+
+/** @brief Sort the non-empty patterns by size (descending) and index and fill the buckets and tables. */
+STATIC int teddy_build(str8patterns *set) {
+    set->order = malloc((set->active ? set->active : 1) * sizeof(size_t));
+    if (!set->order) {
+        return -1;
+    }
+    size_t n = 0;
+    size_t min_size = SIZE_MAX;
+    for (size_t p=0; p<set->count; p++) {
+        size_t size = set->sizes[p];
+        if (size == 0) {
+            continue;
+        }
+        min_size = size < min_size ? size : min_size;
+        // insertion sort, there are only a few patterns
+        size_t i = n++;
+        for (; i > 0 && set->sizes[set->order[i - 1]] < size; i--) {
+            set->order[i] = set->order[i - 1];
+        }
+        set->order[i] = p;
+    }
+
+    set->width = min_size < TEDDY_WIDTH ? min_size : TEDDY_WIDTH;
+    memset(set->lo, 0, sizeof(set->lo));
+    memset(set->hi, 0, sizeof(set->hi));
+    // the buckets are consecutive ranges of order, so the matches at a
+    // position are found in the order of the patterns
+    for (size_t b=0; b<=TEDDY_BUCKETS; b++) {
+        set->buckets[b] = b * n / TEDDY_BUCKETS;
+    }
+    for (size_t b=0; b<TEDDY_BUCKETS; b++) {
+        for (size_t i=set->buckets[b]; i<set->buckets[b + 1]; i++) {
+            size_t p = set->order[i];
+            const uint8_t *end = (const uint8_t *)set->data + set->offsets[p] + set->sizes[p];
+            for (size_t k=0; k<set->width; k++) {
+                uint8_t c = end[k - set->width];
+                set->lo[k][c & 0x0F] |= 1u << b;
+                set->hi[k][c >> 4] |= 1u << b;
+            }
+        }
+    }
+    return 0;
+}
+
+/** @brief Return true if patterns end at state. */
+STATIC INLINE bool has_outputs(const str8patterns *set, uint32_t state) {
+    return set->output_start[state + 1] > set->output_start[state];
+}
+
+/** @brief Build the trie of the patterns and turn it into a DFA with the suffix links. */
+STATIC int automaton_build(str8patterns *set) {
+    memset(set->classes, 0, sizeof(set->classes));
+    set->class_count = 1;
+    size_t max_states = 1;
+    for (size_t p=0; p<set->count; p++) {
+        const uint8_t *pattern = (const uint8_t *)set->data + set->offsets[p];
+        for (size_t i=0; i<set->sizes[p]; i++) {
+            // '\0' is not part of a pattern, so 0 marks a byte without class
+            if (!set->classes[pattern[i]]) {
+                set->classes[pattern[i]] = (uint8_t)set->class_count++;
+            }
+        }
+        max_states += set->sizes[p];
+    }
+    size_t classes = set->class_count;
+    if (max_states * classes >= AC_MATCH) {
+        // the rows would not fit next to the flag
+        return -1;
+    }
+
+    uint32_t *pattern_state = malloc((set->count ? set->count : 1) * sizeof(uint32_t));
+    uint32_t *fail = malloc(max_states * sizeof(uint32_t));
+    uint32_t *queue = malloc(max_states * sizeof(uint32_t));
+    set->transitions = malloc(max_states * classes * sizeof(uint32_t));
+    if (!pattern_state || !fail || !queue || !set->transitions) {
+        free(pattern_state);
+        free(fail);
+        free(queue);
+        return -1;
+    }
+
+    // 1.  Build the trie
+
+    uint32_t *transitions = set->transitions;
+    memset(transitions, 0xFF, classes * sizeof(uint32_t));
+    size_t state_count = 1;
+    for (size_t p=0; p<set->count; p++) {
+        const uint8_t *pattern = (const uint8_t *)set->data + set->offsets[p];
+        uint32_t state = 0;
+        for (size_t i=0; i<set->sizes[p]; i++) {
+            uint32_t *t = &transitions[state * classes + set->classes[pattern[i]]];
+            if (*t == AC_NONE) {
+                *t = (uint32_t)state_count;
+                memset(&transitions[state_count * classes], 0xFF, classes * sizeof(uint32_t));
+                state_count++;
+            }
+            state = *t;
+        }
+        pattern_state[p] = state;
+    }
+    set->state_count = state_count;
+
+    // 2.  Collect the patterns of each state (the root has none)
+
+    set->output_start = calloc(state_count + 1, sizeof(uint32_t));
+    set->outputs = malloc((set->active ? set->active : 1) * sizeof(uint32_t));
+    set->dict = calloc(state_count, sizeof(uint32_t));
+    if (!set->output_start || !set->outputs || !set->dict) {
+        free(pattern_state);
+        free(fail);
+        free(queue);
+        return -1;
+    }
+    for (size_t p=0; p<set->count; p++) {
+        if (set->sizes[p]) {
+            set->output_start[pattern_state[p] + 1]++;
+        }
+    }
+    for (size_t s=0; s<state_count; s++) {
+        set->output_start[s + 1] += set->output_start[s];
+    }
+    // fill with queue as the write position of each state
+    memcpy(queue, set->output_start, state_count * sizeof(uint32_t));
+    for (size_t p=0; p<set->count; p++) {
+        if (set->sizes[p]) {
+            set->outputs[queue[pattern_state[p]]++] = (uint32_t)p;
+        }
+    }
+
+    // 3.  Complete the transitions along the suffix links (breadth first, so
+    //     the links of shorter prefixes are done already)
+
+    size_t head = 0;
+    size_t tail = 0;
+    for (size_t a=0; a<classes; a++) {
+        uint32_t t = transitions[a];
+        if (t == AC_NONE) {
+            transitions[a] = 0;
+        }
+        else {
+            fail[t] = 0;
+            queue[tail++] = t;
+        }
+    }
+    while (head < tail) {
+        uint32_t s = queue[head++];
+        for (size_t a=0; a<classes; a++) {
+            uint32_t t = transitions[s * classes + a];
+            uint32_t via_fail = transitions[fail[s] * classes + a];
+            if (t == AC_NONE) {
+                transitions[s * classes + a] = via_fail;
+                continue;
+            }
+            fail[t] = via_fail;
+            set->dict[t] = has_outputs(set, via_fail) ? via_fail : set->dict[via_fail];
+            queue[tail++] = t;
+        }
+    }
+
+    // 4.  Store the offsets of the rows of the targets (so the scan does not
+    //     multiply) and mark the transitions into states with matches
+
+    for (size_t i=0; i<state_count * classes; i++) {
+        uint32_t t = transitions[i];
+        transitions[i] = (uint32_t)(t * classes) | (has_outputs(set, t) || set->dict[t] ? AC_MATCH : 0);
+    }
+    uint32_t *shrunk = realloc(transitions, state_count * classes * sizeof(uint32_t));
+    set->transitions = shrunk ? shrunk : transitions;
+
+    free(pattern_state);
+    free(fail);
+    free(queue);
+    return 0;
+}
+
+STATIC str8patterns *patterns_new_(const char **patterns, size_t count, bool automaton) {
+    str8patterns *set = calloc(1, sizeof(str8patterns));
+    if (!set) {
+        return NULL;
+    }
+    set->count = count;
+    set->automaton = automaton;
+    set->offsets = malloc((count ? count : 1) * sizeof(size_t));
+    set->sizes = malloc((count ? count : 1) * sizeof(size_t));
+    if (!set->offsets || !set->sizes) {
+        str8patternsfree(set);
+        return NULL;
+    }
+    size_t total = 0;
+    for (size_t p=0; p<count; p++) {
+        set->sizes[p] = strlen(patterns[p]);
+        set->offsets[p] = total;
+        total += set->sizes[p] + 1;
+        if (set->sizes[p]) {
+            set->active++;
+            set->any_ascii |= is_ascii(patterns[p], set->sizes[p]);
+        }
+    }
+    set->data = malloc(total ? total : 1);
+    if (!set->data) {
+        str8patternsfree(set);
+        return NULL;
+    }
+    for (size_t p=0; p<count; p++) {
+        memcpy(set->data + set->offsets[p], patterns[p], set->sizes[p] + 1);
+    }
+
+    if ((automaton ? automaton_build(set) : teddy_build(set)) != 0) {
+        str8patternsfree(set);
+        return NULL;
+    }
+    return set;
+}
+
+str8patterns *str8patternsnew(const char **patterns, size_t count) {
+    return patterns_new_(patterns, count, count > STR8_PATTERNS_TEDDY_MAX);
+}
+
+void str8patternsfree(str8patterns *set) {
+    if (!set) {
+        return;
+    }
+    free(set->data);
+    free(set->offsets);
+    free(set->sizes);
+    free(set->order);
+    free(set->transitions);
+    free(set->dict);
+    free(set->output_start);
+    free(set->outputs);
+    free(set);
+}
+
+size_t str8patternscount(const str8patterns *set) {
+    return set->count;
+}
+
+/** @brief State of a scan, translates the byte offsets of the matches to character indices. */
+typedef struct {
+    str8 str;
+    const str8patterns *set;
+    bool ascii;              //< The byte offsets are the character indices
+    size_t counted_pos;      //< Byte offset the characters are counted up to
+    size_t counted_chars;    //< Characters in front of counted_pos
+    str8_match_callback callback;
+    void *data;
+    size_t count;            //< Matches reported
+} match_reporter;
+
+/** @brief Report a match of pattern ending in front of end, return false to stop the scan. */
+STATIC INLINE bool report_match(match_reporter *r, size_t pattern, size_t end) {
+    size_t size = r->set->sizes[pattern];
+    str8match match = { .pattern = pattern, .byte_pos = end - size, .size = size };
+    if (r->ascii) {
+        match.idx = match.byte_pos;
+    }
+    else if (match.byte_pos >= r->counted_pos) {
+        // counted from the previous match, or with the checkpoints if that is far away
+        r->counted_chars += str8countrange(r->str, r->counted_pos, match.byte_pos);
+        r->counted_pos = match.byte_pos;
+        match.idx = r->counted_chars;
+    }
+    else {
+        // a longer match starts in front of the previous one
+        match.idx = r->counted_chars - count_chars(r->str + match.byte_pos, r->counted_pos - match.byte_pos);
+    }
+    r->count++;
+    return r->callback(&match, r->data);
+}
+
+STATIC void teddy_scan(const str8patterns *set, const char *str, size_t size, match_reporter *r) {
+    uint8_t buckets;
+    for (size_t end=0; (end = find_nibble_match(str, end, size, set->lo, set->hi, set->width, &buckets)) < size;
+         end++) {
+        for (; buckets; buckets &= buckets - 1) {
+            size_t b = __builtin_ctz(buckets);
+            for (size_t i=set->buckets[b]; i<set->buckets[b + 1]; i++) {
+                size_t p = set->order[i];
+                size_t pattern_size = set->sizes[p];
+                if (pattern_size <= end + 1 &&
+                    memcmp(str + end + 1 - pattern_size, set->data + set->offsets[p], pattern_size) == 0 &&
+                    !report_match(r, p, end + 1)) {
+                    return;
+                }
+            }
+        }
+    }
+}
+
+STATIC void automaton_scan(const str8patterns *set, const char *str, size_t size, match_reporter *r) {
+    const uint32_t *transitions = set->transitions;
+    const uint8_t *classes = set->classes;
+    // offset of the row of the current state
+    uint32_t row = 0;
+    for (size_t pos=0; pos<size; pos++) {
+        uint32_t next = transitions[row + classes[(uint8_t)str[pos]]];
+        row = next & ~AC_MATCH;
+        if (!(next & AC_MATCH)) {
+            continue;
+        }
+        // the patterns of the state first, then the shorter ones along the suffix links
+        uint32_t state = (uint32_t)(row / set->class_count);
+        for (uint32_t t = has_outputs(set, state) ? state : set->dict[state]; t; t = set->dict[t]) {
+            for (uint32_t i=set->output_start[t]; i<set->output_start[t + 1]; i++) {
+                if (!report_match(r, set->outputs[i], pos + 1)) {
+                    return;
+                }
+            }
+        }
+    }
+}
+
+size_t str8patternsscan(const str8patterns *set, str8 str, str8_match_callback callback, void *data) {
+    match_reporter r = {
+        .str = str,
+        .set = set,
+        .ascii = STR8_TYPE(str) != STR8_TYPE0 && STR8_IS_ASCII(str),
+        .callback = callback,
+        .data = data
+    };
+    if (set->active == 0 || (r.ascii && !set->any_ascii)) {
+        // patterns with non-ASCII characters do not match in ASCII strings
+        return 0;
+    }
+    if (set->automaton) {
+        automaton_scan(set, str, str8size(str), &r);
+    }
+    else {
+        teddy_scan(set, str, str8size(str), &r);
+    }
+    return r.count;
+}
@@ -0,0 +1,66 @@
+/**
+ * @file str8_patterns.h
+ * @brief Search for many literals in one pass over a string.
+ *
+ * A str8patterns set is compiled once and can be used to scan any number of
+ * strings. Every occurrence of every pattern is reported, overlapping ones
+ * included, ordered by the end of the match, then by size (longer first),
+ * then by the index of the pattern.
+ *
+ * Small sets (up to STR8_PATTERNS_TEDDY_MAX patterns) are searched with the
+ * Teddy filter (see find_nibble_match()): the patterns are sorted into 8
+ * buckets and the last bytes of every position are matched against the
+ * nibbles of the last bytes of the patterns of all buckets at once. Only the
+ * patterns of the matching buckets are compared at the positions found.
+ * Larger sets are compiled into an Aho-Corasick automaton (a DFA over byte
+ * classes), which takes one table lookup per byte, regardless of the number
+ * of patterns.
+ *
+ * Character indices of matches are counted from the previous match (or
+ * resolved with the checkpoints if it is far away), pure ASCII strings use
+ * the byte offsets.
+ */
+#ifndef STR8_PATTERNS_H
+#define STR8_PATTERNS_H
+
+#include "str8.h"
+#include <stddef.h>
+#include <stdbool.h>
+
+/** @brief Sets with more patterns are searched with an automaton. */
+#define STR8_PATTERNS_TEDDY_MAX 32
+
+typedef struct str8patterns str8patterns;
+
+typedef struct {
+    size_t pattern;   //< Index of the pattern in the set
+    size_t idx;       //< Character index of the match
+    size_t byte_pos;  //< Byte offset of the match
+    size_t size;      //< Size of the match in bytes
+} str8match;
+
+/** @brief Called for every match, returning false stops the scan. */
+typedef bool (*str8_match_callback)(const str8match *match, void *data);
+
+/**
+ * @brief Compile count patterns into a set.
+ *
+ * The patterns are copied. Empty patterns never match.
+ *
+ * @returns The set or NULL if the memory could not be allocated.
+ */
+str8patterns *str8patternsnew(const char **patterns, size_t count);
+
+void str8patternsfree(str8patterns *set);
+
+/** @brief Return the number of patterns of set. */
+size_t str8patternscount(const str8patterns *set);
+
+/**
+ * @brief Report every match of the patterns of set in str to callback.
+ *
+ * @returns The number of matches reported.
+ */
+size_t str8patternsscan(const str8patterns *set, str8 str, str8_match_callback callback, void *data);
+
+#endif
@@ -0,0 +1,1318 @@
+#include "str8_regex.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include "str8_header.h"
+#include "str8_checkpoints.h"
+#include "str8_debug.h"
+
+#define REGEX_NONE UINT32_MAX
+#define REGEX_UNBOUNDED UINT32_MAX
+#define REGEX_NOT_FOUND SIZE_MAX
+#define REGEX_MAX_CODEPOINT 0x10FFFF
+/** @brief Maximum nesting of groups and quantifiers. */
+#define REGEX_MAX_DEPTH 256
+/** @brief Maximum number of instructions of a program. */
+#define REGEX_MAX_INSTS (1 << 20)
+
+/* --- Parser --- */
+
+enum { NODE_EMPTY, NODE_CLASS, NODE_CONCAT, NODE_ALTERNATE, NODE_REPEAT, NODE_BEGIN, NODE_END };
+
+typedef struct {
+    uint8_t kind;
+    bool greedy;           //< NODE_REPEAT
+    uint32_t min;          //< NODE_REPEAT
+    uint32_t max;          //< NODE_REPEAT, REGEX_UNBOUNDED for no limit
+    uint32_t ranges;       //< NODE_CLASS: first (lo, hi) pair in the ranges of the parser
+    uint32_t range_count;  //< NODE_CLASS
+    uint32_t child;        //< First child
+    uint32_t next;         //< Next sibling
+} regex_node;
+
+typedef struct {
+    const char *p;
+    regex_node *nodes;
+    size_t node_count;
+    size_t node_capacity;
+    uint32_t *ranges;      //< Sorted (lo, hi) pairs of codepoints of the classes
+    size_t range_count;    //< Number of pairs
+    size_t range_capacity;
+    size_t depth;
+    bool failed;
+} regex_parser;
+
+static const uint32_t regex_digit[] = { '0', '9' };
+static const uint32_t regex_word[] = { '0', '9', 'A', 'Z', '_', '_', 'a', 'z' };
+static const uint32_t regex_space[] = { '\t', '\r', ' ', ' ' };
+static const uint32_t regex_newline[] = { '\n', '\n' };
+
+STATIC INLINE uint32_t regex_fail(regex_parser *parser) {
+    parser->failed = true;
+    return REGEX_NONE;
+}
+
+STATIC uint32_t regex_add_node(regex_parser *parser, uint8_t kind) {
+    if (parser->failed) {
+        return REGEX_NONE;
+    }
+    if (parser->node_count == parser->node_capacity) {
+        size_t capacity = parser->node_capacity ? 2 * parser->node_capacity : 32;
+        regex_node *nodes = realloc(parser->nodes, capacity * sizeof(regex_node));
+        if (!nodes) {
+            return regex_fail(parser);
+        }
+        parser->nodes = nodes;
+        parser->node_capacity = capacity;
+    }
+    parser->nodes[parser->node_count] = (regex_node){
+        .kind = kind,
+        .greedy = true,
+        .child = REGEX_NONE,
+        .next = REGEX_NONE
+    };
+    return parser->node_count++;
+}
+
+STATIC void regex_add_range(regex_parser *parser, uint32_t lo, uint32_t hi) {
+    if (parser->range_count == parser->range_capacity) {
+        size_t capacity = parser->range_capacity ? 2 * parser->range_capacity : 32;
+        uint32_t *ranges = realloc(parser->ranges, 2 * capacity * sizeof(uint32_t));
+        if (!ranges) {
+            regex_fail(parser);
+            return;
+        }
+        parser->ranges = ranges;
+        parser->range_capacity = capacity;
+    }
+    parser->ranges[2 * parser->range_count] = lo;
+    parser->ranges[2 * parser->range_count + 1] = hi;
+    parser->range_count++;
+}
+
+/** @brief Add the sorted ranges of set (or the ranges between them if negate). */
+STATIC void regex_add_set(regex_parser *parser, const uint32_t *set, size_t count, bool negate) {
+    uint32_t lo = 0;
+    for (size_t i=0; i<count; i++) {
+        if (!negate) {
+            regex_add_range(parser, set[2 * i], set[2 * i + 1]);
+        }
+        else {
+            if (set[2 * i] > lo) {
+                regex_add_range(parser, lo, set[2 * i] - 1);
+            }
+            lo = set[2 * i + 1] + 1;
+        }
+    }
+    if (negate && lo <= REGEX_MAX_CODEPOINT) {
+        regex_add_range(parser, lo, REGEX_MAX_CODEPOINT);
+    }
+}
+
+static int regex_compare_ranges(const void *a, const void *b) {
+    uint32_t lo_a = *(const uint32_t *)a;
+    uint32_t lo_b = *(const uint32_t *)b;
+    return lo_a < lo_b ? -1 : lo_a > lo_b;
+}
+
+/** @brief Sort and merge the ranges from first on, and complement them if negate. */
+STATIC void regex_finish_class(regex_parser *parser, size_t first, bool negate) {
+    if (parser->failed) {
+        return;
+    }
+    uint32_t *ranges = parser->ranges + 2 * first;
+    size_t count = parser->range_count - first;
+    qsort(ranges, count, 2 * sizeof(uint32_t), regex_compare_ranges);
+    size_t merged = 0;
+    for (size_t i=0; i<count; i++) {
+        if (merged > 0 && ranges[2 * i] <= ranges[2 * merged - 1] + 1) {
+            if (ranges[2 * i + 1] > ranges[2 * merged - 1]) {
+                ranges[2 * merged - 1] = ranges[2 * i + 1];
+            }
+        }
+        else {
+            ranges[2 * merged] = ranges[2 * i];
+            ranges[2 * merged + 1] = ranges[2 * i + 1];
+            merged++;
+        }
+    }
+    parser->range_count = first + merged;
+    if (negate) {
+        uint32_t *set = malloc((2 * merged + 1) * sizeof(uint32_t));
+        if (!set) {
+            regex_fail(parser);
+            return;
+        }
+        memcpy(set, ranges, 2 * merged * sizeof(uint32_t));
+        parser->range_count = first;
+        regex_add_set(parser, set, merged, true);
+        free(set);
+    }
+}
+
+/** @brief Add a class node of the ranges from first on. */
+STATIC uint32_t regex_add_class(regex_parser *parser, size_t first, bool negate) {
+    regex_finish_class(parser, first, negate);
+    uint32_t node = regex_add_node(parser, NODE_CLASS);
+    if (node != REGEX_NONE) {
+        parser->nodes[node].ranges = first;
+        parser->nodes[node].range_count = parser->range_count - first;
+    }
+    return node;
+}
+
+/** @brief Decode the UTF-8 character at the position of parser. */
+STATIC uint32_t regex_parse_codepoint(regex_parser *parser) {
+    const uint8_t *u = (const uint8_t *)parser->p;
+    uint32_t codepoint;
+    size_t size;
+    if (u[0] < 0x80) {
+        codepoint = u[0];
+        size = 1;
+    }
+    else if ((u[0] & 0xE0) == 0xC0) {
+        codepoint = u[0] & 0x1F;
+        size = 2;
+    }
+    else if ((u[0] & 0xF0) == 0xE0) {
+        codepoint = u[0] & 0x0F;
+        size = 3;
+    }
+    else if ((u[0] & 0xF8) == 0xF0) {
+        codepoint = u[0] & 0x07;
+        size = 4;
+    }
+    else {
+        return regex_fail(parser);
+    }
+    for (size_t i=1; i<size; i++) {
+        // stops at the terminating null byte
+        if ((u[i] & 0xC0) != 0x80) {
+            return regex_fail(parser);
+        }
+        codepoint = codepoint << 6 | (u[i] & 0x3F);
+    }
+    if (codepoint > REGEX_MAX_CODEPOINT || (codepoint >= 0xD800 && codepoint <= 0xDFFF)) {
+        return regex_fail(parser);
+    }
+    parser->p += size;
+    return codepoint;
+}
+
+STATIC INLINE int regex_hex_digit(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/** @brief Parse \xHH or \x{H...} (behind the 'x'). */
+STATIC uint32_t regex_parse_hex(regex_parser *parser) {
+    uint32_t codepoint = 0;
+    if (*parser->p == '{') {
+        parser->p++;
+        size_t digits = 0;
+        for (; regex_hex_digit(*parser->p) >= 0 && digits < 6; digits++) {
+            codepoint = codepoint << 4 | regex_hex_digit(*parser->p++);
+        }
+        if (digits == 0 || *parser->p != '}') {
+            return regex_fail(parser);
+        }
+        parser->p++;
+    }
+    else {
+        for (size_t digits=0; digits<2; digits++) {
+            if (regex_hex_digit(*parser->p) < 0) {
+                return regex_fail(parser);
+            }
+            codepoint = codepoint << 4 | regex_hex_digit(*parser->p++);
+        }
+    }
+    if (codepoint > REGEX_MAX_CODEPOINT || (codepoint >= 0xD800 && codepoint <= 0xDFFF)) {
+        return regex_fail(parser);
+    }
+    return codepoint;
+}
+
+/**
+ * @brief Parse the escape sequence behind a '\'.
+ *
+ * @returns The character or REGEX_NONE for a class (\d, ...), which is added
+ *          to the ranges.
+ */
+STATIC uint32_t regex_parse_escape(regex_parser *parser) {
+    char c = *parser->p++;
+    switch (c) {
+        case 'd': case 'D':
+            regex_add_set(parser, regex_digit, 1, c == 'D');
+            return REGEX_NONE;
+        case 'w': case 'W':
+            regex_add_set(parser, regex_word, 4, c == 'W');
+            return REGEX_NONE;
+        case 's': case 'S':
+            regex_add_set(parser, regex_space, 2, c == 'S');
+            return REGEX_NONE;
+        case 'n': return '\n';
+        case 't': return '\t';
+        case 'r': return '\r';
+        case 'f': return '\f';
+        case 'v': return '\v';
+        case 'x': return regex_parse_hex(parser);
+        case '\0':
+            parser->p--;
+            return regex_fail(parser);
+        default:
+            // unknown letters are reserved
+            if ((unsigned char)c >= 0x80 || isalnum((unsigned char)c)) {
+                return regex_fail(parser);
+            }
+            return (unsigned char)c;
+    }
+}
+
+/** @brief Parse a class behind the '['. */
+STATIC uint32_t regex_parse_class(regex_parser *parser) {
+    size_t first = parser->range_count;
+    bool negate = *parser->p == '^';
+    if (negate) {
+        parser->p++;
+    }
+    // a ']' at the start is a character
+    for (bool start=true; start || *parser->p != ']'; start=false) {
+        if (*parser->p == '\0') {
+            return regex_fail(parser);
+        }
+        uint32_t lo;
+        if (*parser->p == '\\') {
+            parser->p++;
+            lo = regex_parse_escape(parser);
+            if (lo == REGEX_NONE) {
+                if (parser->failed) {
+                    return REGEX_NONE;
+                }
+                continue;
+            }
+        }
+        else {
+            lo = regex_parse_codepoint(parser);
+        }
+        uint32_t hi = lo;
+        if (parser->p[0] == '-' && parser->p[1] != ']' && parser->p[1] != '\0') {
+            parser->p++;
+            if (*parser->p == '\\') {
+                parser->p++;
+                hi = regex_parse_escape(parser);
+            }
+            else {
+                hi = regex_parse_codepoint(parser);
+            }
+            if (hi == REGEX_NONE || hi < lo) {
+                return regex_fail(parser);
+            }
+        }
+        if (parser->failed) {
+            return REGEX_NONE;
+        }
+        regex_add_range(parser, lo, hi);
+    }
+    parser->p++;
+    return regex_add_class(parser, first, negate);
+}
+
+STATIC uint32_t regex_parse_alternate(regex_parser *parser);
+
+STATIC uint32_t regex_parse_atom(regex_parser *parser) {
+    size_t first = parser->range_count;
+    uint32_t node;
+    switch (*parser->p) {
+        case '(':
+            parser->p++;
+            if (parser->p[0] == '?' && parser->p[1] == ':') {
+                parser->p += 2;
+            }
+            if (++parser->depth > REGEX_MAX_DEPTH) {
+                return regex_fail(parser);
+            }
+            node = regex_parse_alternate(parser);
+            parser->depth--;
+            if (parser->failed || *parser->p != ')') {
+                return regex_fail(parser);
+            }
+            parser->p++;
+            return node;
+        case '[':
+            parser->p++;
+            return regex_parse_class(parser);
+        case '.':
+            parser->p++;
+            regex_add_set(parser, regex_newline, 1, true);
+            return regex_add_class(parser, first, false);
+        case '^':
+            parser->p++;
+            return regex_add_node(parser, NODE_BEGIN);
+        case '$':
+            parser->p++;
+            return regex_add_node(parser, NODE_END);
+        case '\\': {
+            parser->p++;
+            uint32_t codepoint = regex_parse_escape(parser);
+            if (codepoint != REGEX_NONE) {
+                regex_add_range(parser, codepoint, codepoint);
+            }
+            return parser->failed ? REGEX_NONE : regex_add_class(parser, first, false);
+        }
+        case '*': case '+': case '?':
+            // nothing to repeat
+            return regex_fail(parser);
+        default: {
+            uint32_t codepoint = regex_parse_codepoint(parser);
+            if (parser->failed) {
+                return REGEX_NONE;
+            }
+            regex_add_range(parser, codepoint, codepoint);
+            return regex_add_class(parser, first, false);
+        }
+    }
+}
+
+/** @brief Parse a number of a quantifier (larger numbers are clamped above STR8_REGEX_MAX_REPEAT). */
+STATIC bool regex_parse_number(const char **p, uint32_t *number) {
+    if (!isdigit((unsigned char)**p)) {
+        return false;
+    }
+    *number = 0;
+    for (; isdigit((unsigned char)**p); (*p)++) {
+        if (*number <= STR8_REGEX_MAX_REPEAT) {
+            *number = 10 * *number + (**p - '0');
+        }
+    }
+    return true;
+}
+
+/** @brief Parse {n}, {n,} or {n,m}, returns false (without moving) if there is none. */
+STATIC bool regex_parse_counts(regex_parser *parser, uint32_t *min, uint32_t *max) {
+    const char *p = parser->p + 1;
+    if (!regex_parse_number(&p, min)) {
+        return false;
+    }
+    *max = *min;
+    if (*p == ',') {
+        p++;
+        *max = REGEX_UNBOUNDED;
+        if (*p != '}' && !regex_parse_number(&p, max)) {
+            return false;
+        }
+    }
+    if (*p != '}') {
+        return false;
+    }
+    parser->p = p + 1;
+    return true;
+}
+
+STATIC uint32_t regex_parse_repeat(regex_parser *parser) {
+    uint32_t node = regex_parse_atom(parser);
+    for (size_t depth=0; !parser->failed; depth++) {
+        uint32_t min, max;
+        char c = *parser->p;
+        if (c == '*' || c == '+' || c == '?') {
+            min = c == '+';
+            max = c == '?' ? 1 : REGEX_UNBOUNDED;
+            parser->p++;
+        }
+        else if (c == '{' && regex_parse_counts(parser, &min, &max)) {
+            if (min > STR8_REGEX_MAX_REPEAT || (max != REGEX_UNBOUNDED && (max > STR8_REGEX_MAX_REPEAT || max < min))) {
+                return regex_fail(parser);
+            }
+        }
+        else {
+            break;
+        }
+        if (depth == REGEX_MAX_DEPTH) {
+            return regex_fail(parser);
+        }
+        bool greedy = *parser->p != '?';
+        if (!greedy) {
+            parser->p++;
+        }
+        uint32_t repeat = regex_add_node(parser, NODE_REPEAT);
+        if (repeat != REGEX_NONE) {
+            regex_node *r = &parser->nodes[repeat];
+            r->min = min;
+            r->max = max;
+            r->greedy = greedy;
+            r->child = node;
+        }
+        node = repeat;
+    }
+    return parser->failed ? REGEX_NONE : node;
+}
+
+STATIC uint32_t regex_parse_concat(regex_parser *parser) {
+    uint32_t first = REGEX_NONE;
+    uint32_t last = REGEX_NONE;
+    size_t count = 0;
+    while (!parser->failed && *parser->p != '\0' && *parser->p != '|' && *parser->p != ')') {
+        uint32_t node = regex_parse_repeat(parser);
+        if (node == REGEX_NONE) {
+            break;
+        }
+        if (last == REGEX_NONE) {
+            first = node;
+        }
+        else {
+            parser->nodes[last].next = node;
+        }
+        last = node;
+        count++;
+    }
+    if (parser->failed) {
+        return REGEX_NONE;
+    }
+    if (count == 1) {
+        return first;
+    }
+    uint32_t concat = regex_add_node(parser, count == 0 ? NODE_EMPTY : NODE_CONCAT);
+    if (concat != REGEX_NONE) {
+        parser->nodes[concat].child = first;
+    }
+    return concat;
+}
+
+STATIC uint32_t regex_parse_alternate(regex_parser *parser) {
+    uint32_t first = regex_parse_concat(parser);
+    if (first == REGEX_NONE || *parser->p != '|') {
+        return first;
+    }
+    uint32_t last = first;
+    while (*parser->p == '|') {
+        parser->p++;
+        uint32_t node = regex_parse_concat(parser);
+        if (node == REGEX_NONE) {
+            return REGEX_NONE;
+        }
+        parser->nodes[last].next = node;
+        last = node;
+    }
+    uint32_t alternate = regex_add_node(parser, NODE_ALTERNATE);
+    if (alternate != REGEX_NONE) {
+        parser->nodes[alternate].child = first;
+    }
+    return alternate;
+}
+
+/* --- Programs --- */
+
+enum { INST_RANGE, INST_SPLIT, INST_MATCH, INST_BEGIN, INST_END, INST_FAIL };
+
+typedef struct {
+    uint8_t kind;
+    uint8_t lo;     //< INST_RANGE
+    uint8_t hi;     //< INST_RANGE
+    uint32_t out;
+    uint32_t out1;  //< INST_SPLIT, lower priority than out
+} regex_inst;
+
+/** @brief Value of a transition that was not computed yet. */
+#define DFA_UNKNOWN UINT32_MAX
+/** @brief Set in a transition if the target state is a match. */
+#define DFA_MATCH 0x80000000u
+/** @brief The state without NFA states, no match can follow. */
+#define DFA_DEAD 0
+
+/**
+ * @brief Lazy DFA of a program.
+ *
+ * A state is an ordered set of NFA states (instructions) after following
+ * the epsilon transitions, in the order of their priority. States are
+ * referenced by their first transition (id * stride), a transition is the
+ * reference of the target state with DFA_MATCH set if the target contains
+ * INST_MATCH.
+ */
+typedef struct {
+    uint32_t *trans;       //< stride transitions per state, the last one for the end of the string
+    uint32_t *set_starts;  //< Start of the set of each state in sets (states + 1 entries)
+    uint32_t *sets;
+    size_t set_count;
+    size_t set_capacity;
+    size_t state_count;
+    size_t state_capacity;
+    uint32_t *table;       //< Hash table of the states (id + 1, 0 for empty slots)
+    size_t table_size;
+    uint32_t starts[2];    //< Start transitions (not) at the start of the string
+    uint32_t accel_state;  //< A state that only one byte leaves (DFA_UNKNOWN for none)
+    int accel_byte;        //< The byte that leaves accel_state, -1 if no byte does
+    size_t cache_size;     //< The cache is flushed when it takes more bytes
+    uint32_t *stack;       //< Scratch space for the epsilon closures
+    uint32_t *marks;       //< Generation in which each instruction was added
+    uint32_t generation;
+    uint32_t *current;     //< The set being built
+    uint32_t *source;      //< Copy of the source state during a flush
+} regex_dfa;
+
+typedef struct {
+    regex_inst *insts;
+    size_t count;
+    size_t capacity;
+    uint32_t start;
+    bool leftmost;           //< Drop the states behind a match (leftmost-first)
+    uint8_t classes[256];    //< Class of each byte, the bytes of a class have the same transitions
+    uint8_t class_bytes[256];//< A byte of each class
+    size_t class_count;
+    size_t stride;           //< class_count + 1
+    regex_dfa dfa;
+} regex_prog;
+
+struct str8regex {
+    regex_prog forward;        //< Finds the end of the leftmost match
+    regex_prog reverse;        //< Finds the start of a match from its end
+    regex_prog ascii_forward;  //< Both without non-ASCII characters
+    regex_prog ascii_reverse;
+};
+
+typedef struct {
+    const regex_parser *parser;
+    regex_prog *prog;
+    bool reverse;  //< Compile the reversed pattern
+    bool ascii;    //< Drop the non-ASCII characters of the classes
+    bool failed;
+} regex_compiler;
+
+STATIC uint32_t regex_emit(regex_compiler *c, uint8_t kind, uint8_t lo, uint8_t hi, uint32_t out, uint32_t out1) {
+    regex_prog *prog = c->prog;
+    if (c->failed || out == REGEX_NONE) {
+        c->failed = true;
+        return REGEX_NONE;
+    }
+    if (prog->count == prog->capacity) {
+        size_t capacity = prog->capacity ? 2 * prog->capacity : 64;
+        regex_inst *insts = capacity <= REGEX_MAX_INSTS ? realloc(prog->insts, capacity * sizeof(regex_inst)) : NULL;
+        if (!insts) {
+            c->failed = true;
+            return REGEX_NONE;
+        }
+        prog->insts = insts;
+        prog->capacity = capacity;
+    }
+    prog->insts[prog->count] = (regex_inst){ .kind = kind, .lo = lo, .hi = hi, .out = out, .out1 = out1 };
+    return prog->count++;
+}
+
+STATIC INLINE size_t regex_encode(uint32_t codepoint, uint8_t *bytes) {
+    if (codepoint < 0x80) {
+        bytes[0] = codepoint;
+        return 1;
+    }
+    if (codepoint < 0x800) {
+        bytes[0] = 0xC0 | codepoint >> 6;
+        bytes[1] = 0x80 | (codepoint & 0x3F);
+        return 2;
+    }
+    if (codepoint < 0x10000) {
+        bytes[0] = 0xE0 | codepoint >> 12;
+        bytes[1] = 0x80 | (codepoint >> 6 & 0x3F);
+        bytes[2] = 0x80 | (codepoint & 0x3F);
+        return 3;
+    }
+    bytes[0] = 0xF0 | codepoint >> 18;
+    bytes[1] = 0x80 | (codepoint >> 12 & 0x3F);
+    bytes[2] = 0x80 | (codepoint >> 6 & 0x3F);
+    bytes[3] = 0x80 | (codepoint & 0x3F);
+    return 4;
+}
+
+/**
+ * @brief Add the UTF-8 byte sequences of the codepoints [lo, hi] as alternatives to entry.
+ *
+ * The range is split until the codepoints of each part have the same
+ * encoded length and differ only in trailing bytes that cover all
+ * continuation bytes, so each part is a sequence of byte ranges.
+ */
+STATIC void regex_compile_range(regex_compiler *c, uint32_t lo, uint32_t hi, uint32_t next, uint32_t *entry) {
+    if (lo <= 0xDFFF && hi >= 0xD800) {
+        // surrogates are not encoded
+        if (lo < 0xD800) {
+            regex_compile_range(c, lo, 0xD7FF, next, entry);
+        }
+        if (hi > 0xDFFF) {
+            regex_compile_range(c, 0xE000, hi, next, entry);
+        }
+        return;
+    }
+    static const uint32_t length_ends[] = { 0x7F, 0x7FF, 0xFFFF };
+    for (size_t i=0; i<3; i++) {
+        if (lo <= length_ends[i] && hi > length_ends[i]) {
+            regex_compile_range(c, lo, length_ends[i], next, entry);
+            regex_compile_range(c, length_ends[i] + 1, hi, next, entry);
+            return;
+        }
+    }
+    uint8_t lo_bytes[4], hi_bytes[4];
+    size_t size = regex_encode(lo, lo_bytes);
+    for (size_t i=1; i<size; i++) {
+        uint32_t mask = ((uint32_t)1 << (6 * i)) - 1;
+        if ((lo & ~mask) != (hi & ~mask)) {
+            if ((lo & mask) != 0) {
+                regex_compile_range(c, lo, lo | mask, next, entry);
+                regex_compile_range(c, (lo | mask) + 1, hi, next, entry);
+                return;
+            }
+            if ((hi & mask) != mask) {
+                regex_compile_range(c, lo, (hi & ~mask) - 1, next, entry);
+                regex_compile_range(c, hi & ~mask, hi, next, entry);
+                return;
+            }
+        }
+    }
+    regex_encode(hi, hi_bytes);
+    uint32_t sequence = next;
+    for (size_t k=0; k<size; k++) {
+        size_t i = c->reverse ? k : size - 1 - k;
+        sequence = regex_emit(c, INST_RANGE, lo_bytes[i], hi_bytes[i], sequence, REGEX_NONE);
+    }
+    *entry = *entry == REGEX_NONE ? sequence : regex_emit(c, INST_SPLIT, 0, 0, *entry, sequence);
+}
+
+/** @brief Return the children of node in an array (free it) or NULL. */
+STATIC uint32_t *regex_children(regex_compiler *c, const regex_node *node, size_t *count) {
+    const regex_node *nodes = c->parser->nodes;
+    *count = 0;
+    for (uint32_t child=node->child; child!=REGEX_NONE; child=nodes[child].next) {
+        (*count)++;
+    }
+    uint32_t *children = malloc(*count * sizeof(uint32_t));
+    if (!children) {
+        c->failed = true;
+        return NULL;
+    }
+    size_t i = 0;
+    for (uint32_t child=node->child; child!=REGEX_NONE; child=nodes[child].next) {
+        children[i++] = child;
+    }
+    return children;
+}
+
+/**
+ * @brief Compile node in front of next.
+ *
+ * The program is built from its end, so every fragment knows its
+ * continuation and no jumps have to be patched (but loops).
+ *
+ * @returns The entry instruction of node.
+ */
+STATIC uint32_t regex_compile_node(regex_compiler *c, uint32_t index, uint32_t next) {
+    const regex_node *node = &c->parser->nodes[index];
+    if (c->failed) {
+        return REGEX_NONE;
+    }
+    switch (node->kind) {
+        case NODE_EMPTY:
+            return next;
+        case NODE_BEGIN:
+            return regex_emit(c, c->reverse ? INST_END : INST_BEGIN, 0, 0, next, REGEX_NONE);
+        case NODE_END:
+            return regex_emit(c, c->reverse ? INST_BEGIN : INST_END, 0, 0, next, REGEX_NONE);
+        case NODE_CLASS: {
+            const uint32_t *ranges = c->parser->ranges + 2 * node->ranges;
+            uint32_t entry = REGEX_NONE;
+            for (size_t i=0; i<node->range_count; i++) {
+                uint32_t lo = ranges[2 * i];
+                uint32_t hi = ranges[2 * i + 1];
+                if (c->ascii) {
+                    if (lo > 0x7F) {
+                        break;
+                    }
+                    hi = hi > 0x7F ? 0x7F : hi;
+                }
+                regex_compile_range(c, lo, hi, next, &entry);
+            }
+            return entry != REGEX_NONE ? entry : regex_emit(c, INST_FAIL, 0, 0, next, REGEX_NONE);
+        }
+        case NODE_CONCAT: {
+            size_t count;
+            uint32_t *children = regex_children(c, node, &count);
+            uint32_t entry = next;
+            for (size_t k=0; k<count && children; k++) {
+                entry = regex_compile_node(c, children[c->reverse ? k : count - 1 - k], entry);
+            }
+            free(children);
+            return entry;
+        }
+        case NODE_ALTERNATE: {
+            // the first alternative has the highest priority
+            size_t count;
+            uint32_t *children = regex_children(c, node, &count);
+            if (!children || count == 0) {
+                free(children);
+                return REGEX_NONE;
+            }
+            uint32_t entry = regex_compile_node(c, children[count - 1], next);
+            for (size_t k=count-1; k>0; k--) {
+                uint32_t alternative = regex_compile_node(c, children[k - 1], next);
+                entry = regex_emit(c, INST_SPLIT, 0, 0, alternative, entry);
+            }
+            free(children);
+            return entry;
+        }
+        case NODE_REPEAT: {
+            bool greedy = node->greedy;
+            uint32_t child = node->child;
+            uint32_t min = node->min;
+            uint32_t entry = next;
+            if (node->max == REGEX_UNBOUNDED) {
+                // x* loops through a split, x+ enters the loop through x
+                uint32_t loop = regex_emit(c, INST_SPLIT, 0, 0, next, next);
+                uint32_t body = regex_compile_node(c, child, loop);
+                if (c->failed) {
+                    return REGEX_NONE;
+                }
+                c->prog->insts[loop].out = greedy ? body : next;
+                c->prog->insts[loop].out1 = greedy ? next : body;
+                entry = loop;
+                if (min > 0) {
+                    entry = body;
+                    min--;
+                }
+            }
+            else {
+                // x{n,m} is n times x, then m - n nested (x(x)?)?
+                for (uint32_t k=node->min; k<node->max; k++) {
+                    uint32_t body = regex_compile_node(c, child, entry);
+                    entry = greedy ? regex_emit(c, INST_SPLIT, 0, 0, body, next)
+                                   : regex_emit(c, INST_SPLIT, 0, 0, next, body);
+                }
+            }
+            for (uint32_t k=0; k<min; k++) {
+                entry = regex_compile_node(c, child, entry);
+            }
+            return entry;
+        }
+    }
+    return REGEX_NONE;
+}
+
+STATIC bool regex_dfa_flush(regex_prog *prog);
+
+/** @brief Compile the pattern parsed by parser into prog. */
+STATIC bool regex_compile(regex_prog *prog, const regex_parser *parser, uint32_t root,
+                          bool reverse, bool ascii, size_t cache_size) {
+    regex_compiler c = { .parser = parser, .prog = prog, .reverse = reverse, .ascii = ascii };
+    uint32_t match = regex_emit(&c, INST_MATCH, 0, 0, 0, REGEX_NONE);
+    uint32_t start = regex_compile_node(&c, root, match);
+    if (!reverse) {
+        // the forward search is unanchored: a loop over any byte with a lower priority
+        uint32_t loop = regex_emit(&c, INST_SPLIT, 0, 0, start, start);
+        uint32_t any = regex_emit(&c, INST_RANGE, 0x00, 0xFF, loop, REGEX_NONE);
+        if (!c.failed) {
+            prog->insts[loop].out1 = any;
+        }
+        start = loop;
+    }
+    if (c.failed) {
+        return false;
+    }
+    prog->start = start;
+    prog->leftmost = !reverse;
+
+    // bytes that are not separated by the bounds of any range have the same transitions
+    bool bounds[257] = { false };
+    for (size_t i=0; i<prog->count; i++) {
+        if (prog->insts[i].kind == INST_RANGE) {
+            bounds[prog->insts[i].lo] = true;
+            bounds[prog->insts[i].hi + 1] = true;
+        }
+    }
+    size_t class = 0;
+    for (size_t b=0; b<256; b++) {
+        class += b > 0 && bounds[b];
+        prog->classes[b] = class;
+        prog->class_bytes[class] = b;
+    }
+    prog->class_count = class + 1;
+    prog->stride = prog->class_count + 1;
+
+    regex_dfa *dfa = &prog->dfa;
+    dfa->cache_size = cache_size;
+    dfa->stack = malloc((2 * prog->count + 2) * sizeof(uint32_t));
+    dfa->marks = calloc(prog->count, sizeof(uint32_t));
+    dfa->current = malloc(prog->count * sizeof(uint32_t));
+    dfa->source = malloc(prog->count * sizeof(uint32_t));
+    if (!dfa->stack || !dfa->marks || !dfa->current || !dfa->source) {
+        return false;
+    }
+    return regex_dfa_flush(prog);
+}
+
+/* --- Lazy DFA --- */
+
+STATIC INLINE size_t regex_dfa_memory(const regex_prog *prog) {
+    const regex_dfa *dfa = &prog->dfa;
+    return (dfa->state_capacity * (prog->stride + 1) + dfa->set_capacity + dfa->table_size) * sizeof(uint32_t);
+}
+
+STATIC INLINE uint32_t regex_hash(const uint32_t *set, size_t count) {
+    uint32_t hash = 2166136261u;
+    for (size_t i=0; i<count; i++) {
+        hash = (hash ^ set[i]) * 16777619u;
+    }
+    return hash;
+}
+
+/** @brief Return the id of the state of set, add it if it does not exist (REGEX_NONE if out of memory). */
+STATIC uint32_t regex_dfa_add(regex_prog *prog, const uint32_t *set, size_t count) {
+    regex_dfa *dfa = &prog->dfa;
+    uint32_t hash = regex_hash(set, count);
+    size_t mask = dfa->table_size - 1;
+    for (size_t slot=hash&mask; dfa->table_size && dfa->table[slot]; slot=(slot+1)&mask) {
+        uint32_t id = dfa->table[slot] - 1;
+        uint32_t *other = dfa->sets + dfa->set_starts[id];
+        if (dfa->set_starts[id + 1] - dfa->set_starts[id] == count &&
+            (count == 0 || memcmp(other, set, count * sizeof(uint32_t)) == 0)) {
+            return id;
+        }
+    }
+
+    if (dfa->state_count == dfa->state_capacity) {
+        size_t capacity = dfa->state_capacity ? 2 * dfa->state_capacity : 16;
+        uint32_t *trans = realloc(dfa->trans, capacity * prog->stride * sizeof(uint32_t));
+        if (trans) {
+            dfa->trans = trans;
+        }
+        uint32_t *set_starts = realloc(dfa->set_starts, (capacity + 1) * sizeof(uint32_t));
+        if (set_starts) {
+            dfa->set_starts = set_starts;
+        }
+        if (!trans || !set_starts) {
+            return REGEX_NONE;
+        }
+        dfa->state_capacity = capacity;
+    }
+    if (dfa->set_count + count > dfa->set_capacity) {
+        size_t capacity = dfa->set_capacity ? 2 * dfa->set_capacity : 64;
+        while (capacity < dfa->set_count + count) {
+            capacity *= 2;
+        }
+        uint32_t *sets = realloc(dfa->sets, capacity * sizeof(uint32_t));
+        if (!sets) {
+            return REGEX_NONE;
+        }
+        dfa->sets = sets;
+        dfa->set_capacity = capacity;
+    }
+    if (2 * (dfa->state_count + 1) > dfa->table_size) {
+        size_t size = dfa->table_size ? 2 * dfa->table_size : 64;
+        uint32_t *table = calloc(size, sizeof(uint32_t));
+        if (!table) {
+            return REGEX_NONE;
+        }
+        for (size_t id=0; id<dfa->state_count; id++) {
+            uint32_t *other = dfa->sets + dfa->set_starts[id];
+            size_t slot = regex_hash(other, dfa->set_starts[id + 1] - dfa->set_starts[id]) & (size - 1);
+            while (table[slot]) {
+                slot = (slot + 1) & (size - 1);
+            }
+            table[slot] = id + 1;
+        }
+        free(dfa->table);
+        dfa->table = table;
+        dfa->table_size = size;
+    }
+
+    uint32_t id = dfa->state_count++;
+    if (count > 0) {
+        memcpy(dfa->sets + dfa->set_count, set, count * sizeof(uint32_t));
+    }
+    dfa->set_starts[id] = dfa->set_count;
+    dfa->set_count += count;
+    dfa->set_starts[id + 1] = dfa->set_count;
+    memset(dfa->trans + id * prog->stride, 0xFF, prog->stride * sizeof(uint32_t));  // DFA_UNKNOWN
+    size_t slot = hash & (dfa->table_size - 1);
+    while (dfa->table[slot]) {
+        slot = (slot + 1) & (dfa->table_size - 1);
+    }
+    dfa->table[slot] = id + 1;
+    return id;
+}
+
+/** @brief Drop all states but the dead one (id 0) and release their memory. */
+STATIC bool regex_dfa_flush(regex_prog *prog) {
+    regex_dfa *dfa = &prog->dfa;
+    free(dfa->trans);
+    free(dfa->set_starts);
+    free(dfa->sets);
+    free(dfa->table);
+    dfa->trans = NULL;
+    dfa->set_starts = NULL;
+    dfa->sets = NULL;
+    dfa->table = NULL;
+    dfa->set_count = dfa->set_capacity = 0;
+    dfa->state_count = dfa->state_capacity = 0;
+    dfa->table_size = 0;
+    dfa->starts[0] = dfa->starts[1] = DFA_UNKNOWN;
+    dfa->accel_state = DFA_UNKNOWN;
+    return regex_dfa_add(prog, dfa->current, 0) == DFA_DEAD;
+}
+
+/** @brief Start a new set (the instructions added to the last one may be added again). */
+STATIC INLINE void regex_dfa_new_set(regex_prog *prog) {
+    regex_dfa *dfa = &prog->dfa;
+    if (++dfa->generation == 0) {
+        memset(dfa->marks, 0, prog->count * sizeof(uint32_t));
+        dfa->generation = 1;
+    }
+}
+
+/**
+ * @brief Add the instructions reachable from start to the current set.
+ *
+ * The instructions are added depth first, out before out1, which is the
+ * order of their priority.
+ *
+ * @returns false if the set is complete: a match was added and the program
+ *          is leftmost, so all following instructions have a lower priority.
+ */
+STATIC bool regex_closure(regex_prog *prog, uint32_t start, bool at_begin, bool at_end, size_t *count, bool *match) {
+    regex_dfa *dfa = &prog->dfa;
+    size_t top = 0;
+    dfa->stack[top++] = start;
+    while (top > 0) {
+        uint32_t i = dfa->stack[--top];
+        if (dfa->marks[i] == dfa->generation) {
+            continue;
+        }
+        dfa->marks[i] = dfa->generation;
+        const regex_inst *inst = &prog->insts[i];
+        switch (inst->kind) {
+            case INST_SPLIT:
+                dfa->stack[top++] = inst->out1;
+                dfa->stack[top++] = inst->out;
+                break;
+            case INST_BEGIN:
+                if (at_begin) {
+                    dfa->stack[top++] = inst->out;
+                }
+                break;
+            case INST_END:
+                // kept until the end of the string is known
+                if (at_end) {
+                    dfa->stack[top++] = inst->out;
+                }
+                else {
+                    dfa->current[(*count)++] = i;
+                }
+                break;
+            case INST_RANGE:
+                dfa->current[(*count)++] = i;
+                break;
+            case INST_MATCH:
+                dfa->current[(*count)++] = i;
+                *match = true;
+                if (prog->leftmost) {
+                    return false;
+                }
+                break;
+            case INST_FAIL:
+                break;
+        }
+    }
+    return true;
+}
+
+/** @brief Return the transition into the state of the current set (DFA_UNKNOWN if out of memory). */
+STATIC INLINE uint32_t regex_dfa_target(regex_prog *prog, size_t count, bool match) {
+    uint32_t id = regex_dfa_add(prog, prog->dfa.current, count);
+    return id == REGEX_NONE ? DFA_UNKNOWN : (id * prog->stride) | (match ? DFA_MATCH : 0);
+}
+
+STATIC void regex_dfa_accelerate(regex_prog *prog, uint32_t state);
+
+/** @brief Return the start transition of prog (DFA_UNKNOWN if out of memory). */
+STATIC uint32_t regex_dfa_start(regex_prog *prog, bool at_begin) {
+    regex_dfa *dfa = &prog->dfa;
+    if (dfa->starts[at_begin] != DFA_UNKNOWN) {
+        return dfa->starts[at_begin];
+    }
+    if (regex_dfa_memory(prog) > dfa->cache_size && !regex_dfa_flush(prog)) {
+        return DFA_UNKNOWN;
+    }
+    size_t count = 0;
+    bool match = false;
+    regex_dfa_new_set(prog);
+    regex_closure(prog, prog->start, at_begin, false, &count, &match);
+    dfa->starts[at_begin] = regex_dfa_target(prog, count, match);
+    if (prog->leftmost && dfa->starts[at_begin] != DFA_UNKNOWN) {
+        regex_dfa_accelerate(prog, dfa->starts[at_begin] & ~DFA_MATCH);
+    }
+    return dfa->starts[at_begin];
+}
+
+/**
+ * @brief Compute the transition of *state for class (prog->class_count for
+ *        the end of the string).
+ *
+ * If the cache is full, it is flushed and the state is added again, so
+ * *state changes.
+ *
+ * @returns The transition or DFA_UNKNOWN if out of memory.
+ */
+STATIC uint32_t regex_dfa_next(regex_prog *prog, uint32_t *state, size_t class) {
+    regex_dfa *dfa = &prog->dfa;
+    uint32_t id = *state / prog->stride;
+    const uint32_t *set = dfa->sets + dfa->set_starts[id];
+    size_t set_count = dfa->set_starts[id + 1] - dfa->set_starts[id];
+    bool at_end = class == prog->class_count;
+    uint8_t byte = prog->class_bytes[at_end ? 0 : class];
+
+    size_t count = 0;
+    bool match = false;
+    regex_dfa_new_set(prog);
+    for (size_t i=0; i<set_count; i++) {
+        const regex_inst *inst = &prog->insts[set[i]];
+        bool follow = at_end ? inst->kind == INST_END
+                             : inst->kind == INST_RANGE && inst->lo <= byte && byte <= inst->hi;
+        if (follow && !regex_closure(prog, inst->out, false, at_end, &count, &match)) {
+            break;
+        }
+    }
+
+    if (regex_dfa_memory(prog) > dfa->cache_size) {
+        memcpy(dfa->source, set, set_count * sizeof(uint32_t));
+        id = regex_dfa_flush(prog) ? regex_dfa_add(prog, dfa->source, set_count) : REGEX_NONE;
+        if (id == REGEX_NONE) {
+            return DFA_UNKNOWN;
+        }
+        *state = id * prog->stride;
+    }
+    uint32_t target = regex_dfa_target(prog, count, match);
+    if (target != DFA_UNKNOWN) {
+        dfa->trans[*state + class] = target;
+    }
+    return target;
+}
+
+/**
+ * @brief Make state the accelerated state if all bytes but one (or all)
+ *        loop back to it.
+ *
+ * The search skips to the next occurrence of that byte with memchr() while
+ * it is in the state, which is the unanchored start state of patterns
+ * starting with a literal. If no byte leaves the state (like for non-ASCII
+ * literals in ASCII strings), it skips to the end.
+ */
+STATIC void regex_dfa_accelerate(regex_prog *prog, uint32_t state) {
+    regex_dfa *dfa = &prog->dfa;
+    size_t exits = 0;
+    int exit_byte = -1;
+    for (size_t class=0; class<prog->class_count; class++) {
+        uint32_t value = dfa->trans[state + class];
+        if (value == DFA_UNKNOWN) {
+            // the cache must not be flushed here
+            if (regex_dfa_memory(prog) > dfa->cache_size) {
+                return;
+            }
+            value = regex_dfa_next(prog, &state, class);
+            if (value == DFA_UNKNOWN) {
+                return;
+            }
+        }
+        if (value == state) {
+            continue;
+        }
+        for (size_t b=0; b<256; b++) {
+            if (prog->classes[b] == class) {
+                exit_byte = b;
+                exits++;
+            }
+        }
+        if (exits > 1) {
+            return;
+        }
+    }
+    if (exits <= 1) {
+        dfa->accel_state = state;
+        dfa->accel_byte = exit_byte;
+    }
+}
+
+/** @brief Return the end of the leftmost(-first) match behind pos or REGEX_NOT_FOUND. */
+STATIC size_t regex_forward(regex_prog *prog, const char *str, size_t pos, size_t size) {
+    const uint8_t *u = (const uint8_t *)str;
+    uint32_t value = regex_dfa_start(prog, pos == 0);
+    if (value == DFA_UNKNOWN) {
+        return REGEX_NOT_FOUND;
+    }
+    size_t end = value & DFA_MATCH ? pos : REGEX_NOT_FOUND;
+    uint32_t state = value & ~DFA_MATCH;
+    const uint32_t *trans = prog->dfa.trans;
+    uint32_t accel_state = prog->dfa.accel_state;
+    for (; pos<size; pos++) {
+        if (state == accel_state) {
+            int byte = prog->dfa.accel_byte;
+            const uint8_t *next = byte >= 0 ? memchr(u + pos, byte, size - pos) : NULL;
+            if (!next) {
+                pos = size;
+                break;
+            }
+            pos = next - u;
+        }
+        size_t class = prog->classes[u[pos]];
+        value = trans[state + class];
+        if (value == DFA_UNKNOWN) {
+            value = regex_dfa_next(prog, &state, class);
+            if (value == DFA_UNKNOWN) {
+                return REGEX_NOT_FOUND;
+            }
+            trans = prog->dfa.trans;
+            accel_state = prog->dfa.accel_state;
+        }
+        if (value & DFA_MATCH) {
+            end = pos + 1;
+        }
+        state = value & ~DFA_MATCH;
+        if (state == DFA_DEAD) {
+            return end;
+        }
+    }
+    value = trans[state + prog->class_count];
+    if (value == DFA_UNKNOWN) {
+        value = regex_dfa_next(prog, &state, prog->class_count);
+    }
+    return value != DFA_UNKNOWN && value & DFA_MATCH ? size : end;
+}
+
+/** @brief Return the first start >= first of a match ending at pos or REGEX_NOT_FOUND. */
+STATIC size_t regex_reverse(regex_prog *prog, const char *str, size_t first, size_t pos, size_t size) {
+    const uint8_t *u = (const uint8_t *)str;
+    uint32_t value = regex_dfa_start(prog, pos == size);
+    if (value == DFA_UNKNOWN) {
+        return REGEX_NOT_FOUND;
+    }
+    size_t start = value & DFA_MATCH ? pos : REGEX_NOT_FOUND;
+    uint32_t state = value & ~DFA_MATCH;
+    const uint32_t *trans = prog->dfa.trans;
+    for (; pos>first; pos--) {
+        size_t class = prog->classes[u[pos - 1]];
+        value = trans[state + class];
+        if (value == DFA_UNKNOWN) {
+            value = regex_dfa_next(prog, &state, class);
+            if (value == DFA_UNKNOWN) {
+                return REGEX_NOT_FOUND;
+            }
+            trans = prog->dfa.trans;
+        }
+        if (value & DFA_MATCH) {
+            start = pos - 1;
+        }
+        state = value & ~DFA_MATCH;
+        if (state == DFA_DEAD) {
+            return start;
+        }
+    }
+    if (pos == 0) {
+        // the start of the string is the end of the reversed one
+        value = trans[state + prog->class_count];
+        if (value == DFA_UNKNOWN) {
+            value = regex_dfa_next(prog, &state, prog->class_count);
+        }
+        if (value != DFA_UNKNOWN && value & DFA_MATCH) {
+            start = 0;
+        }
+    }
+    return start;
+}
+
+STATIC void regex_prog_free(regex_prog *prog) {
+    regex_dfa *dfa = &prog->dfa;
+    free(prog->insts);
+    free(dfa->trans);
+    free(dfa->set_starts);
+    free(dfa->sets);
+    free(dfa->table);
+    free(dfa->stack);
+    free(dfa->marks);
+    free(dfa->current);
+    free(dfa->source);
+}
+
+STATIC str8regex *regex_new_(const char *pattern, size_t cache_size) {
+    regex_parser parser = { .p = pattern };
+    uint32_t root = regex_parse_alternate(&parser);
+    if (!parser.failed && *parser.p != '\0') {
+        // unmatched ')'
+        parser.failed = true;
+    }
+    str8regex *re = parser.failed ? NULL : calloc(1, sizeof(str8regex));
+    if (re && !(regex_compile(&re->forward, &parser, root, false, false, cache_size) &&
+                regex_compile(&re->reverse, &parser, root, true, false, cache_size) &&
+                regex_compile(&re->ascii_forward, &parser, root, false, true, cache_size) &&
+                regex_compile(&re->ascii_reverse, &parser, root, true, true, cache_size))) {
+        str8regexfree(re);
+        re = NULL;
+    }
+    free(parser.nodes);
+    free(parser.ranges);
+    return re;
+}
+
+str8regex *str8regexnew(const char *pattern) {
+    return regex_new_(pattern, STR8_REGEX_CACHE_SIZE);
+}
+
+void str8regexfree(str8regex *re) {
+    if (!re) {
+        return;
+    }
+    regex_prog_free(&re->forward);
+    regex_prog_free(&re->reverse);
+    regex_prog_free(&re->ascii_forward);
+    regex_prog_free(&re->ascii_reverse);
+    free(re);
+}
+
+bool str8regexsearch(str8regex *re, str8 str, size_t start, str8regexmatch *match) {
+    size_t size = str8size(str);
+    bool ascii = STR8_TYPE(str) != STR8_TYPE0 && STR8_IS_ASCII(str);
+    size_t byte_start;
+    if (ascii) {
+        if (start > size) {
+            return false;
+        }
+        byte_start = start;
+    }
+    else {
+        size_t length = str8len(str);
+        if (start > length) {
+            return false;
+        }
+        byte_start = start < length ? (size_t)(str8getchar(str, start) - str) : size;
+    }
+
+    regex_prog *forward = ascii ? &re->ascii_forward : &re->forward;
+    regex_prog *reverse = ascii ? &re->ascii_reverse : &re->reverse;
+    size_t end = regex_forward(forward, str, byte_start, size);
+    if (end == REGEX_NOT_FOUND) {
+        return false;
+    }
+    size_t begin = regex_reverse(reverse, str, byte_start, end, size);
+    if (begin == REGEX_NOT_FOUND) {
+        return false;
+    }
+    match->byte_pos = begin;
+    match->size = end - begin;
+    if (ascii) {
+        match->idx = begin;
+        match->length = end - begin;
+    }
+    else {
+        match->idx = start + str8countrange(str, byte_start, begin);
+        match->length = str8countrange(str, begin, end);
+    }
+    return true;
+}
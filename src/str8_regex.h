@@ -0,0 +1,75 @@
+/**
+ * @file str8_regex.h
+ * @brief Regular expressions over the characters of a str8.
+ *
+ * A pattern is compiled once into byte-level automata: character classes
+ * (including '.') are sets of codepoints, which are translated into the
+ * UTF-8 byte sequences of the codepoints, so a match never splits a
+ * character. The automata are run as lazy DFAs: the states are built when a
+ * search first needs them and kept in a cache of bounded size (it is
+ * flushed when full), so every byte takes one table lookup after warmup.
+ *
+ * A search runs a forward DFA (with an implicit non-greedy ".*" in front)
+ * to find the end of the leftmost match, then a reverse DFA from that end
+ * to find its start. Matches follow the leftmost-first semantics of Perl:
+ * alternatives are tried from left to right, quantifiers are greedy unless
+ * followed by '?'. For pure ASCII strings, automata compiled without the
+ * non-ASCII byte sequences are used and the byte offsets are the character
+ * indices, other strings count the characters with the checkpoints.
+ *
+ * Supported syntax:
+ *  - literal characters (UTF-8), '.' (any character but '\n')
+ *  - [...] and [^...] with characters and ranges of characters
+ *  - \d \w \s \D \W \S (ASCII only), \n \t \r \f \v, \xHH, \x{H...}, and
+ *    '\' before any punctuation character for the character itself
+ *  - (...) and (?:...) as (non-capturing) groups, '|' for alternatives
+ *  - * + ? {n} {n,} {n,m} (at most STR8_REGEX_MAX_REPEAT), '?' after a
+ *    quantifier makes it non-greedy
+ *  - ^ and $ for the start and the end of the string
+ *
+ * A compiled regex keeps the DFA cache, so it must not be used by several
+ * threads at once.
+ */
+#ifndef STR8_REGEX_H
+#define STR8_REGEX_H
+
+#include "str8.h"
+#include <stddef.h>
+#include <stdbool.h>
+
+/** @brief Maximum count of a {n,m} quantifier. */
+#define STR8_REGEX_MAX_REPEAT 1000
+/** @brief Default size of the DFA cache of each automaton in bytes. */
+#define STR8_REGEX_CACHE_SIZE (1 << 20)
+
+typedef struct str8regex str8regex;
+
+typedef struct {
+    size_t idx;       //< Character index of the match
+    size_t length;    //< Length of the match in characters
+    size_t byte_pos;  //< Byte offset of the match
+    size_t size;      //< Size of the match in bytes
+} str8regexmatch;
+
+/**
+ * @brief Compile pattern.
+ *
+ * @returns The regex or NULL if pattern is invalid, too large or the memory
+ *          could not be allocated.
+ */
+str8regex *str8regexnew(const char *pattern);
+
+void str8regexfree(str8regex *re);
+
+/**
+ * @brief Find the leftmost match of re in str that starts at character index
+ *        start or later.
+ *
+ * To find all matches, search again from the end of the previous match (or
+ * one character behind it for an empty match).
+ *
+ * @returns true and fills match if there is a match.
+ */
+bool str8regexsearch(str8regex *re, str8 str, size_t start, str8regexmatch *match);
+
+#endif
@@ -0,0 +1,529 @@
+#include "str8_rope.h"
+#include <stdlib.h>
+#include <string.h>
+#include "str8_header.h"
+#include "str8_checkpoints.h"
+#include "str8_memory.h"
+#include "str8_edit.h"
+#include "str8_debug.h"
+
+STATIC INLINE uint8_t rope_height(const str8rope *rope) {
+    return rope ? rope->height : 0;
+}
+
+/** @brief Recalculate the cached values of an inner node from its children. */
+STATIC INLINE void rope_update(str8rope *node) {
+    node->size = node->left->size + node->right->size;
+    node->length = node->left->length + node->right->length;
+    uint8_t hl = node->left->height;
+    uint8_t hr = node->right->height;
+    node->height = (hl > hr ? hl : hr) + 1;
+}
+
+/** @brief Turn node into a leaf holding str. */
+STATIC INLINE void rope_set_leaf(str8rope *node, str8 str) {
+    node->left = NULL;
+    node->right = NULL;
+    node->leaf = str;
+    node->size = str8size(str);
+    node->length = str8len(str);
+    node->height = 0;
+}
+
+/**
+ * @brief Create a leaf for the non-empty str (consumed).
+ *
+ * @returns The leaf or NULL if str is NULL or the leaf could not be allocated.
+ */
+STATIC str8rope *rope_leaf_(str8 str, str8_allocator alloc) {
+    if (!str) {
+        return NULL;
+    }
+    str8rope *leaf = alloc(sizeof(str8rope));
+    if (!leaf) {
+        str8free(str);
+        return NULL;
+    }
+    rope_set_leaf(leaf, str);
+    return leaf;
+}
+
+/**
+ * @brief Create an inner node for left and right.
+ *
+ * spare is used as the node if it is not NULL, so the call cannot fail then.
+ *
+ * @returns The node or NULL if it could not be allocated (left and right are
+ *          left untouched then).
+ */
+STATIC str8rope *rope_node_(str8rope *left, str8rope *right, str8rope *spare, str8_allocator alloc) {
+    str8rope *node = spare ? spare : alloc(sizeof(str8rope));
+    if (!node) {
+        return NULL;
+    }
+    node->left = left;
+    node->right = right;
+    node->leaf = NULL;
+    rope_update(node);
+    return node;
+}
+
+STATIC str8rope *rope_rotate_right(str8rope *node) {
+    str8rope *left = node->left;
+    node->left = left->right;
+    rope_update(node);
+    left->right = node;
+    rope_update(left);
+    return left;
+}
+
+STATIC str8rope *rope_rotate_left(str8rope *node) {
+    str8rope *right = node->right;
+    node->right = right->left;
+    rope_update(node);
+    right->left = node;
+    rope_update(right);
+    return right;
+}
+
+/** @brief Restore the AVL property of node if its subtrees differ in height by 2. */
+STATIC str8rope *rope_rebalance(str8rope *node) {
+    rope_update(node);
+    int balance = (int)node->left->height - (int)node->right->height;
+    if (balance > 1) {
+        if (rope_height(node->left->left) < rope_height(node->left->right)) {
+            node->left = rope_rotate_left(node->left);
+        }
+        return rope_rotate_right(node);
+    }
+    if (balance < -1) {
+        if (rope_height(node->right->right) < rope_height(node->right->left)) {
+            node->right = rope_rotate_right(node->right);
+        }
+        return rope_rotate_left(node);
+    }
+    return node;
+}
+
+/** @brief Build a balanced rope from the leaves [lo, hi), which are freed on failure. */
+STATIC str8rope *rope_build_(str8rope **leaves, size_t lo, size_t hi, str8_allocator alloc) {
+    if (hi - lo == 1) {
+        return leaves[lo];
+    }
+    size_t mid = lo + (hi - lo) / 2;
+    str8rope *left = rope_build_(leaves, lo, mid, alloc);
+    if (!left) {
+        for (size_t i=mid; i<hi; i++) {
+            str8ropefree(leaves[i]);
+        }
+        return NULL;
+    }
+    str8rope *right = rope_build_(leaves, mid, hi, alloc);
+    if (!right) {
+        str8ropefree(left);
+        return NULL;
+    }
+    str8rope *node = rope_node_(left, right, NULL, alloc);
+    if (!node) {
+        str8ropefree(left);
+        str8ropefree(right);
+    }
+    return node;
+}
+
+STATIC str8rope *rope_new_(const char *str, str8_allocator alloc) {
+    size_t size = strlen(str);
+    if (size == 0) {
+        return NULL;
+    }
+    size_t count = size / STR8_ROPE_LEAF_SIZE + 1;
+    // cutting at character boundaries might need some more leaves
+    count += count / 2 + 1;
+    str8rope **leaves = alloc(count * sizeof(str8rope*));
+    if (!leaves) {
+        return NULL;
+    }
+    size_t leaf_count = 0;
+    size_t pos = 0;
+    while (pos < size) {
+        size_t max = size - pos > STR8_ROPE_LEAF_SIZE ? STR8_ROPE_LEAF_SIZE : size - pos;
+        size_t cut = max;
+        // do not split a multi-byte character
+        while (pos + cut < size && cut > 0 && (str[pos + cut] & 0xC0) == 0x80) {
+            cut--;
+        }
+        if (cut == 0) {
+            // no character boundary at all (invalid UTF-8)
+            cut = max;
+        }
+        leaves[leaf_count] = rope_leaf_(str8newsize(str + pos, cut), alloc);
+        if (!leaves[leaf_count]) {
+            for (size_t i=0; i<leaf_count; i++) {
+                str8ropefree(leaves[i]);
+            }
+            free(leaves);
+            return NULL;
+        }
+        leaf_count++;
+        pos += cut;
+    }
+    str8rope *rope = rope_build_(leaves, 0, leaf_count, alloc);
+    free(leaves);
+    return rope;
+}
+
+str8rope *str8ropenew(const char *str) {
+    return rope_new_(str, malloc);
+}
+
+void str8ropefree(str8rope *rope) {
+    if (!rope) {
+        return;
+    }
+    if (rope->leaf) {
+        str8free(rope->leaf);
+    }
+    else {
+        str8ropefree(rope->left);
+        str8ropefree(rope->right);
+    }
+    free(rope);
+}
+
+size_t str8ropelen(const str8rope *rope) {
+    return rope ? rope->length : 0;
+}
+
+size_t str8ropesize(const str8rope *rope) {
+    return rope ? rope->size : 0;
+}
+
+const char *str8ropegetchar(const str8rope *rope, size_t idx) {
+    if (!rope || idx >= rope->length) {
+        return NULL;
+    }
+    while (!rope->leaf) {
+        if (idx < rope->left->length) {
+            rope = rope->left;
+        }
+        else {
+            idx -= rope->left->length;
+            rope = rope->right;
+        }
+    }
+    return str8getchar(rope->leaf, idx);
+}
+
+/**
+ * @brief Concatenate left and right (see str8ropeconcat()).
+ *
+ * The node joining them is spare if it is not NULL (spare is freed if no
+ * node is needed), so the call cannot fail then. Small leaves are only
+ * merged if merge is set.
+ */
+STATIC str8rope *rope_concat_(str8rope *left, str8rope *right, str8rope *spare, bool merge,
+                              str8_allocator alloc) {
+    if (!left || !right) {
+        free(spare);
+        return left ? left : right;
+    }
+    if (left->height > right->height + 1) {
+        str8rope *joined = rope_concat_(left->right, right, spare, merge, alloc);
+        if (!joined) {
+            return NULL;
+        }
+        left->right = joined;
+        return rope_rebalance(left);
+    }
+    if (right->height > left->height + 1) {
+        str8rope *joined = rope_concat_(left, right->left, spare, merge, alloc);
+        if (!joined) {
+            return NULL;
+        }
+        right->left = joined;
+        return rope_rebalance(right);
+    }
+    if (merge && left->leaf && right->leaf && left->size + right->size <= STR8_ROPE_LEAF_SIZE) {
+        // merge small leaves to keep the tree compact
+        str8 merged = str8append(left->leaf, right->leaf);
+        if (merged) {
+            rope_set_leaf(left, merged);
+            str8ropefree(right);
+            free(spare);
+            return left;
+        }
+    }
+    return rope_node_(left, right, spare, alloc);
+}
+
+str8rope *str8ropeconcat(str8rope *left, str8rope *right) {
+    return rope_concat_(left, right, NULL, true, malloc);
+}
+
+/** @brief The halves of the leaf a split cuts through, allocated in advance. */
+typedef struct {
+    str8rope *left;
+    str8rope *right;
+} rope_cut;
+
+/**
+ * @brief Allocate the halves of the leaf that splitting rope at idx cuts through.
+ *
+ * cut is set to NULL halves if idx is at a leaf boundary.
+ *
+ * @returns 0 or -1 if memory could not be allocated.
+ */
+STATIC int rope_prepare_cut_(const str8rope *rope, size_t idx, rope_cut *cut, str8_allocator alloc) {
+    cut->left = NULL;
+    cut->right = NULL;
+    if (!rope || idx == 0 || idx >= rope->length) {
+        return 0;
+    }
+    while (!rope->leaf) {
+        if (idx < rope->left->length) {
+            rope = rope->left;
+        }
+        else if (idx == rope->left->length) {
+            return 0;
+        }
+        else {
+            idx -= rope->left->length;
+            rope = rope->right;
+        }
+    }
+    cut->left = rope_leaf_(str8substr(rope->leaf, 0, idx), alloc);
+    cut->right = rope_leaf_(str8substr(rope->leaf, idx, rope->length), alloc);
+    if (!cut->left || !cut->right) {
+        str8ropefree(cut->left);
+        str8ropefree(cut->right);
+        cut->left = NULL;
+        cut->right = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Split rope in front of the idx' character (see str8ropesplit()).
+ *
+ * Only the leaf that is cut through needs memory, its halves are taken from
+ * cut (prepared by rope_prepare_cut_() for the same rope and idx) or
+ * allocated before anything is changed. The inner nodes on the path are
+ * reused for the concatenations, so nothing can fail after the leaf is cut.
+ * The concatenations do not merge leaves, so other leaves stay as they are.
+ */
+STATIC int rope_split_(str8rope *rope, size_t idx, str8rope **left, str8rope **right,
+                       rope_cut *cut, str8_allocator alloc) {
+    if (!rope || idx == 0) {
+        *left = NULL;
+        *right = rope;
+        return 0;
+    }
+    if (idx >= rope->length) {
+        *left = rope;
+        *right = NULL;
+        return 0;
+    }
+    if (rope->leaf) {
+        rope_cut halves = {NULL, NULL};
+        if (cut && cut->left) {
+            halves = *cut;
+        }
+        else if (rope_prepare_cut_(rope, idx, &halves, alloc) != 0) {
+            return -1;
+        }
+        str8ropefree(rope);
+        *left = halves.left;
+        *right = halves.right;
+        return 0;
+    }
+    str8rope *l = rope->left;
+    str8rope *r = rope->right;
+    str8rope *middle;
+    if (idx < l->length) {
+        if (rope_split_(l, idx, left, &middle, cut, alloc) != 0) {
+            return -1;
+        }
+        *right = rope_concat_(middle, r, rope, false, alloc);
+    }
+    else if (idx == l->length) {
+        free(rope);
+        *left = l;
+        *right = r;
+    }
+    else {
+        if (rope_split_(r, idx - l->length, &middle, right, cut, alloc) != 0) {
+            return -1;
+        }
+        *left = rope_concat_(l, middle, rope, false, alloc);
+    }
+    return 0;
+}
+
+int str8ropesplit(str8rope *rope, size_t idx, str8rope **left, str8rope **right) {
+    return rope_split_(rope, idx, left, right, NULL, malloc);
+}
+
+/**
+ * @brief Insert str into the leaf containing idx if it stays small enough.
+ *
+ * @returns false if the leaf is too large (nothing is changed then).
+ */
+STATIC bool rope_insert_in_leaf(str8rope *rope, size_t idx, const char *str, size_t size) {
+    if (rope->leaf) {
+        if (rope->size + size > STR8_ROPE_LEAF_SIZE) {
+            return false;
+        }
+        str8 leaf = str8insert(rope->leaf, idx, str);
+        if (!leaf) {
+            return false;
+        }
+        rope_set_leaf(rope, leaf);
+        return true;
+    }
+    bool inserted;
+    if (idx <= rope->left->length) {
+        inserted = rope_insert_in_leaf(rope->left, idx, str, size);
+    }
+    else {
+        inserted = rope_insert_in_leaf(rope->right, idx - rope->left->length, str, size);
+    }
+    if (inserted) {
+        rope_update(rope);
+    }
+    return inserted;
+}
+
+STATIC str8rope *rope_insert_(str8rope *rope, size_t idx, const char *str, str8_allocator alloc) {
+    size_t size = strlen(str);
+    if (size == 0) {
+        return rope;
+    }
+    if (rope && rope_insert_in_leaf(rope, idx > rope->length ? rope->length : idx, str, size)) {
+        return rope;
+    }
+    // everything is allocated up front, so rope is only changed once nothing can fail
+    rope_cut cut;
+    str8rope *middle = rope_new_(str, alloc);
+    str8rope *spare_left = alloc(sizeof(str8rope));
+    str8rope *spare_right = alloc(sizeof(str8rope));
+    if (!middle || !spare_left || !spare_right || rope_prepare_cut_(rope, idx, &cut, alloc) != 0) {
+        str8ropefree(middle);
+        free(spare_left);
+        free(spare_right);
+        return NULL;
+    }
+    str8rope *left, *right;
+    rope_split_(rope, idx, &left, &right, &cut, alloc);
+    left = rope_concat_(left, middle, spare_left, true, alloc);
+    return rope_concat_(left, right, spare_right, true, alloc);
+}
+
+str8rope *str8ropeinsert(str8rope *rope, size_t idx, const char *str) {
+    return rope_insert_(rope, idx, str, malloc);
+}
+
+/**
+ * @brief Remove the characters [start, end) from a leaf that keeps some of its content.
+ *
+ * @returns 1 if the characters were removed, 0 if they do not lie in such a
+ *          leaf and -1 if memory could not be allocated (nothing is changed
+ *          then).
+ */
+STATIC int rope_erase_in_leaf(str8rope *rope, size_t start, size_t end) {
+    if (rope->leaf) {
+        if (end > rope->length || (start == 0 && end == rope->length)) {
+            return 0;
+        }
+        str8 leaf = str8erase(rope->leaf, start, end - start);
+        if (!leaf) {
+            return -1;
+        }
+        rope_set_leaf(rope, leaf);
+        return 1;
+    }
+    int erased;
+    if (start < rope->left->length) {
+        erased = rope_erase_in_leaf(rope->left, start, end);
+    }
+    else {
+        erased = rope_erase_in_leaf(rope->right, start - rope->left->length, end - rope->left->length);
+    }
+    if (erased == 1) {
+        rope_update(rope);
+    }
+    return erased;
+}
+
+STATIC str8rope *rope_delete_(str8rope *rope, size_t start, size_t end, str8_allocator alloc) {
+    if (!rope || start >= end || start >= rope->length) {
+        return rope;
+    }
+    if (end > rope->length) {
+        end = rope->length;
+    }
+    if (start == 0 && end == rope->length) {
+        str8ropefree(rope);
+        return NULL;
+    }
+    int erased = rope_erase_in_leaf(rope, start, end);
+    if (erased != 0) {
+        return erased > 0 ? rope : NULL;
+    }
+    // the cuts go through different leaves, which are split in advance
+    rope_cut cut_start, cut_end;
+    str8rope *spare = alloc(sizeof(str8rope));
+    if (!spare || rope_prepare_cut_(rope, start, &cut_start, alloc) != 0) {
+        free(spare);
+        return NULL;
+    }
+    if (rope_prepare_cut_(rope, end, &cut_end, alloc) != 0) {
+        str8ropefree(cut_start.left);
+        str8ropefree(cut_start.right);
+        free(spare);
+        return NULL;
+    }
+    str8rope *left, *middle, *right;
+    rope_split_(rope, start, &left, &right, &cut_start, alloc);
+    rope_split_(right, end - start, &middle, &right, &cut_end, alloc);
+    str8ropefree(middle);
+    return rope_concat_(left, right, spare, true, alloc);
+}
+
+str8rope *str8ropedelete(str8rope *rope, size_t start, size_t end) {
+    return rope_delete_(rope, start, end, malloc);
+}
+
+/** @brief Copy the leaves of rope to str at pos and write the checkpoints in between. */
+STATIC void rope_flatten(const str8rope *rope, str8 str, void *list, size_t *pos, size_t *chars) {
+    if (!rope->leaf) {
+        rope_flatten(rope->left, str, list, pos, chars);
+        rope_flatten(rope->right, str, list, pos, chars);
+        return;
+    }
+    memcpy(str + *pos, rope->leaf, rope->size);
+    if (list) {
+        checkpoints_copy_range_to(list, *pos, *chars, rope->leaf, 0, 0, rope->size,
+                                  CHECKPOINTS_GRANULARITY);
+    }
+    *pos += rope->size;
+    *chars += rope->length;
+}
+
+str8 str8ropeflatten(const str8rope *rope) {
+    if (!rope) {
+        return str8new("");
+    }
+    uint8_t type = type_from_capacity(rope->size);
+    str8 str = str8_allocate(type, rope->size == rope->length, rope->size, malloc);
+    if (!str) {
+        return NULL;
+    }
+    size_t pos = 0;
+    size_t chars = 0;
+    rope_flatten(rope, str, checkpoints_list_ptr(str), &pos, &chars);
+    str[pos] = '\0';
+    str8setsize(str, rope->size);
+    str8setlen(str, rope->length);
+    return str;
+}
@@ -0,0 +1,98 @@
+/**
+ * @file str8_rope.h
+ * @brief Balanced rope of str8 leaves for large, frequently edited texts.
+ *
+ * Inner nodes cache the size and length of their subtree, so a character
+ * index is found by descending the tree and then using the checkpoints list
+ * of the leaf. The tree is kept AVL balanced, concatenation and splitting
+ * (and therefore insertion and deletion) are O(log n) plus the cost of
+ * splitting a single leaf.
+ *
+ * The empty rope is NULL. All functions taking ropes (except the read-only
+ * ones) consume them, use the returned rope instead. If memory cannot be
+ * allocated they return NULL (or -1) and leave their arguments as they were,
+ * so the caller still owns them.
+ */
+#ifndef STR8_ROPE_H
+#define STR8_ROPE_H
+
+#include "str8.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief Maximum size of a leaf in bytes, so leaves only use the 2 byte zone of the list. */
+#define STR8_ROPE_LEAF_SIZE (32 * 1024)
+
+typedef struct str8rope {
+    struct str8rope *left;   //< Left subtree (inner nodes only)
+    struct str8rope *right;  //< Right subtree (inner nodes only)
+    str8 leaf;               //< Content (leaves only)
+    size_t size;             //< Size of the subtree in bytes
+    size_t length;           //< Length of the subtree in characters
+    uint8_t height;          //< Height of the subtree (0 for leaves)
+} str8rope;
+
+/** @brief Create a rope from str, split into leaves of at most STR8_ROPE_LEAF_SIZE bytes. */
+str8rope *str8ropenew(const char *str);
+
+/** @brief Free rope and all its leaves. */
+void str8ropefree(str8rope *rope);
+
+size_t str8ropelen(const str8rope *rope);
+size_t str8ropesize(const str8rope *rope);
+
+/**
+ * @brief Return a pointer to the first byte of the idx' character.
+ *
+ * The pointer points into a leaf and is valid until the rope is modified.
+ *
+ * @returns The pointer or NULL if idx is out of bounds.
+ */
+const char *str8ropegetchar(const str8rope *rope, size_t idx);
+
+/**
+ * @brief Concatenate left and right.
+ *
+ * @returns The rope or NULL if memory could not be allocated (for two
+ *          non-empty ropes, left and right are left intact then).
+ */
+str8rope *str8ropeconcat(str8rope *left, str8rope *right);
+
+/**
+ * @brief Split rope in front of the idx' character.
+ *
+ * @param rope The rope to split (consumed).
+ * @param idx Number of characters that go to left (clamped to the length).
+ * @param left Receives the characters [0, idx).
+ * @param right Receives the remaining characters.
+ * @returns 0 or -1 if memory could not be allocated (rope is left intact and
+ *          left and right are not written then).
+ */
+int str8ropesplit(str8rope *rope, size_t idx, str8rope **left, str8rope **right);
+
+/**
+ * @brief Insert str in front of the idx' character.
+ *
+ * @returns The rope or NULL if memory could not be allocated (rope is left
+ *          intact then).
+ */
+str8rope *str8ropeinsert(str8rope *rope, size_t idx, const char *str);
+
+/**
+ * @brief Remove the characters [start, end).
+ *
+ * @returns The rope, which is NULL if it became empty, or NULL if memory
+ *          could not be allocated (rope is left intact then, this can only
+ *          happen if the result is not empty).
+ */
+str8rope *str8ropedelete(str8rope *rope, size_t start, size_t end);
+
+/**
+ * @brief Copy the content of rope into a single str8.
+ *
+ * The leaves are copied in one pass and the checkpoints of the result are
+ * derived from the lists of the leaves.
+ */
+str8 str8ropeflatten(const str8rope *rope);
+
+#endif
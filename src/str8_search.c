@@ -0,0 +1,58 @@
+#include "str8_search.h"
+#include <string.h>
+#include "str8_header.h"
+#include "str8_checkpoints.h"
+#include "str8_simd.h"
+#include "str8_debug.h"
+
+size_t str8findbyte(str8 str, const char *needle, size_t byte_start) {
+    size_t size = str8size(str);
+    if (byte_start > size) {
+        return STR8_NOT_FOUND;
+    }
+    const char *match = find_bytes(str + byte_start, size - byte_start, needle, strlen(needle));
+    return match ? (size_t)(match - str) : STR8_NOT_FOUND;
+}
+
+size_t str8rfindbyte(str8 str, const char *needle, size_t byte_end) {
+    size_t size = str8size(str);
+    if (byte_end > size) {
+        byte_end = size;
+    }
+    const char *match = rfind_bytes(str, byte_end, needle, strlen(needle));
+    return match ? (size_t)(match - str) : STR8_NOT_FOUND;
+}
+
+size_t str8find(str8 str, const char *needle, size_t start, size_t *byte_pos) {
+    size_t length = str8len(str);
+    if (start > length) {
+        return STR8_NOT_FOUND;
+    }
+    const char *p = start < length ? str8getchar(str, start) : str + str8size(str);
+    size_t byte_start = p - str;
+    size_t match = str8findbyte(str, needle, byte_start);
+    if (match == STR8_NOT_FOUND) {
+        return STR8_NOT_FOUND;
+    }
+    if (byte_pos) {
+        *byte_pos = match;
+    }
+    return start + str8countrange(str, byte_start, match);
+}
+
+size_t str8rfind(str8 str, const char *needle, size_t end, size_t *byte_pos) {
+    size_t length = str8len(str);
+    if (end > length) {
+        end = length;
+    }
+    const char *p = end < length ? str8getchar(str, end) : str + str8size(str);
+    size_t byte_end = p - str;
+    size_t match = str8rfindbyte(str, needle, byte_end);
+    if (match == STR8_NOT_FOUND) {
+        return STR8_NOT_FOUND;
+    }
+    if (byte_pos) {
+        *byte_pos = match;
+    }
+    return end - str8countrange(str, match, byte_end);
+}
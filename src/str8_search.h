@@ -0,0 +1,52 @@
+/**
+ * @file str8_search.h
+ * @brief Substring search on str8.
+ *
+ * The bytes are searched with find_bytes() and rfind_bytes(). The character
+ * index to start at is resolved by the lookup of str8getchar(), and the
+ * character index of a match is counted from there (or resolved with the
+ * checkpoints of the string if the match is far away, see str8countrange()),
+ * so the string is never counted from its start.
+ */
+#ifndef STR8_SEARCH_H
+#define STR8_SEARCH_H
+
+#include "str8.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/** @brief Result of the search functions if there is no match. */
+#define STR8_NOT_FOUND SIZE_MAX
+
+/**
+ * @brief Return the byte offset of the first match of needle at or behind byte_start.
+ *
+ * An empty needle matches at byte_start (if it is not behind the end of str).
+ */
+size_t str8findbyte(str8 str, const char *needle, size_t byte_start);
+
+/**
+ * @brief Return the byte offset of the last match of needle that ends at or in front of byte_end.
+ *
+ * byte_end is clamped to the size of str. An empty needle matches at byte_end.
+ */
+size_t str8rfindbyte(str8 str, const char *needle, size_t byte_end);
+
+/**
+ * @brief Return the character index of the first match of needle at or behind the character start.
+ *
+ * If byte_pos is not NULL, the byte offset of the match is written to it.
+ * An empty needle matches at start (if it is not behind the end of str).
+ */
+size_t str8find(str8 str, const char *needle, size_t start, size_t *byte_pos);
+
+/**
+ * @brief Return the character index of the last match of needle within the first end characters.
+ *
+ * end is clamped to the length of str, so SIZE_MAX searches the whole
+ * string. If byte_pos is not NULL, the byte offset of the match is written
+ * to it. An empty needle matches at end.
+ */
+size_t str8rfind(str8 str, const char *needle, size_t end, size_t *byte_pos);
+
+#endif
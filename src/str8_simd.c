@@ -55,6 +55,91 @@ const char *lookup_idx_scalar(const char *str, size_t size, size_t *char_count,
     return NULL;
 }
 
+static inline __attribute__((always_inline))
+size_t count_le_u16_scalar(const uint16_t *values, size_t count, uint16_t bound) {
+    size_t result = 0;
+    for (size_t i=0; i<count; i++) {
+        result += values[i] <= bound;
+    }
+    return result;
+}
+
+/**
+ * @brief Scan [from, to) of str for line starts, count is the number of entries already written.
+ *
+ * @returns The new number of entries (at most capacity).
+ */
+static inline __attribute__((always_inline))
+size_t find_line_starts_scalar(const char *str, size_t from, size_t to, size_t *char_count,
+                               uint64_t *offsets, uint64_t *chars, size_t count, size_t capacity) {
+    for (size_t pos=from; pos<to && count<capacity; pos++) {
+        *char_count += (str[pos] & 0xC0) != 0x80;
+        if (str[pos] == '\n') {
+            offsets[count] = pos + 1;
+            chars[count] = *char_count;
+            count++;
+        }
+    }
+    return count;
+}
+
+/** @brief Return true if a candidate at p (first and last byte match already) is the needle. */
+static inline __attribute__((always_inline))
+bool match_inner(const char *p, const char *needle, size_t needle_size) {
+    return needle_size < 3 || memcmp(p + 1, needle + 1, needle_size - 2) == 0;
+}
+
+/** @brief Return the first match of needle starting in [from, to) of str (needle_size >= 1). */
+static inline __attribute__((always_inline))
+const char *find_bytes_scalar(const char *str, size_t from, size_t to, const char *needle, size_t needle_size) {
+    const char first = needle[0];
+    const char last = needle[needle_size - 1];
+    for (size_t pos=from; pos<to; pos++) {
+        if (str[pos] == first && str[pos + needle_size - 1] == last && match_inner(str + pos, needle, needle_size)) {
+            return str + pos;
+        }
+    }
+    return NULL;
+}
+
+/** @brief Return the last match of needle starting in [from, to) of str (needle_size >= 1). */
+static inline __attribute__((always_inline))
+const char *rfind_bytes_scalar(const char *str, size_t from, size_t to, const char *needle, size_t needle_size) {
+    const char first = needle[0];
+    const char last = needle[needle_size - 1];
+    for (size_t pos=to; pos>from; pos--) {
+        if (str[pos - 1] == first && str[pos + needle_size - 2] == last &&
+            match_inner(str + pos - 1, needle, needle_size)) {
+            return str + pos - 1;
+        }
+    }
+    return NULL;
+}
+
+/** @brief Return the buckets the fingerprint ending at str[end] belongs to (see find_nibble_match()). */
+static inline __attribute__((always_inline))
+uint8_t nibble_buckets_scalar(const char *str, size_t end, const uint8_t lo[][16], const uint8_t hi[][16],
+                              size_t width) {
+    uint8_t buckets = 0xFF;
+    for (size_t k=0; k<width; k++) {
+        uint8_t c = (uint8_t)str[end + 1 - width + k];
+        buckets &= lo[k][c & 0x0F] & hi[k][c >> 4];
+    }
+    return buckets;
+}
+
+static inline __attribute__((always_inline))
+size_t find_nibble_match_scalar(const char *str, size_t from, size_t size, const uint8_t lo[][16],
+                                const uint8_t hi[][16], size_t width, uint8_t *buckets) {
+    for (size_t end=from; end<size; end++) {
+        *buckets = nibble_buckets_scalar(str, end, lo, hi, width);
+        if (*buckets) {
+            return end;
+        }
+    }
+    return size;
+}
+
 #if defined(__x86_64__) || defined(_M_X64)
 
 /**
@@ -241,6 +326,186 @@ const char *lookup_idx(const char *str, size_t size, size_t target_idx) {
     }
 }
 
+/**
+ * @brief Scan the aligned range [from, to) of str for line starts, like find_line_starts_scalar().
+ *
+ * The newlines and the continuation bytes of a chunk are found with two
+ * compares, the characters in front of a line start are the bytes in front
+ * of it minus the continuation bytes among them.
+ */
+static inline __attribute__((always_inline))
+size_t find_line_starts_avx2(const char *str, size_t from, size_t to, size_t *char_count,
+                             uint64_t *offsets, uint64_t *chars, size_t count, size_t capacity) {
+    const size_t V = sizeof(__m256i);
+    const __m256i mask_c0 = _mm256_set1_epi8((char)0xC0);
+    const __m256i mask_80 = _mm256_set1_epi8((char)0x80);
+    const __m256i newline = _mm256_set1_epi8('\n');
+
+    for (size_t pos=from; pos<to; pos+=V) {
+        __m256i chunk = load_bytes_insecure(str + pos);
+        uint32_t cont = (uint32_t)_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_and_si256(chunk, mask_c0), mask_80));
+        uint32_t nl = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, newline));
+        for (; nl; nl &= nl - 1) {
+            if (count == capacity) {
+                return count;
+            }
+            unsigned bit = __builtin_ctz(nl);
+            // the bytes up to and including the newline
+            uint32_t in_front = bit == 31 ? UINT32_MAX : (2u << bit) - 1;
+            offsets[count] = pos + bit + 1;
+            chars[count] = *char_count + bit + 1 - __builtin_popcount(cont & in_front);
+            count++;
+        }
+        *char_count += V - __builtin_popcount(cont);
+    }
+    return count;
+}
+
+
+size_t find_line_starts(const char *str, size_t from, size_t size, size_t chars_in_front,
+                        uint64_t *offsets, uint64_t *chars, size_t capacity) {
+    const size_t V = sizeof(__m256i);
+    size_t char_count = chars_in_front;
+    size_t count = 0;
+
+    // --- Scalar prefix to align to a 32-byte boundary ---
+    size_t aligned = align_to(str + from, V) - str;
+    if (aligned > size) {
+        return find_line_starts_scalar(str, from, size, &char_count, offsets, chars, count, capacity);
+    }
+    count = find_line_starts_scalar(str, from, aligned, &char_count, offsets, chars, count, capacity);
+
+    // --- SIMD main loop ---
+    size_t simd_end = aligned + ((size - aligned) & ~(V - 1));
+    if (count < capacity) {
+        count = find_line_starts_avx2(str, aligned, simd_end, &char_count, offsets, chars, count, capacity);
+    }
+
+    // --- Scalar tail ---
+    if (count < capacity) {
+        count = find_line_starts_scalar(str, simd_end, size, &char_count, offsets, chars, count, capacity);
+    }
+    return count;
+}
+
+/**
+ * @brief Return the positions in [pos, pos + 32) where the first and the last byte of the needle match.
+ *
+ * Bit i is set if str[pos + i] is the first byte and str[pos + i + needle_size - 1]
+ * the last byte of the needle. All 32 + needle_size - 1 bytes need to be in bounds.
+ */
+static inline __attribute__((always_inline))
+uint32_t match_candidates(const char *str, size_t pos, size_t needle_size, __m256i first, __m256i last) {
+    __m256i a = _mm256_loadu_si256((const __m256i *)(str + pos));
+    __m256i b = _mm256_loadu_si256((const __m256i *)(str + pos + needle_size - 1));
+    __m256i eq = _mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last));
+    return (uint32_t)_mm256_movemask_epi8(eq);
+}
+
+const char *find_bytes(const char *str, size_t size, const char *needle, size_t needle_size) {
+    if (needle_size == 0) {
+        return str;
+    }
+    if (needle_size > size) {
+        return NULL;
+    }
+    if (needle_size == 1) {
+        return memchr(str, needle[0], size);
+    }
+    const size_t V = sizeof(__m256i);
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[needle_size - 1]);
+    // positions a match can start at
+    size_t count = size - needle_size + 1;
+    size_t pos = 0;
+    for (; pos + V <= count; pos += V) {
+        uint32_t mask = match_candidates(str, pos, needle_size, first, last);
+        for (; mask; mask &= mask - 1) {
+            size_t candidate = pos + __builtin_ctz(mask);
+            if (match_inner(str + candidate, needle, needle_size)) {
+                return str + candidate;
+            }
+        }
+    }
+    return find_bytes_scalar(str, pos, count, needle, needle_size);
+}
+
+const char *rfind_bytes(const char *str, size_t size, const char *needle, size_t needle_size) {
+    if (needle_size == 0) {
+        return str + size;
+    }
+    if (needle_size > size) {
+        return NULL;
+    }
+    const size_t V = sizeof(__m256i);
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[needle_size - 1]);
+    // candidates in [0, end) are left
+    size_t end = size - needle_size + 1;
+    for (; end >= V; end -= V) {
+        size_t pos = end - V;
+        uint32_t mask = match_candidates(str, pos, needle_size, first, last);
+        while (mask) {
+            unsigned bit = 31 - __builtin_clz(mask);
+            if (match_inner(str + pos + bit, needle, needle_size)) {
+                return str + pos + bit;
+            }
+            mask &= ~(1u << bit);
+        }
+    }
+    return rfind_bytes_scalar(str, 0, end, needle, needle_size);
+}
+
+size_t find_nibble_match(const char *str, size_t from, size_t size, const uint8_t lo[][16],
+                         const uint8_t hi[][16], size_t width, uint8_t *buckets) {
+    const size_t V = sizeof(__m256i);
+    const __m256i low_nibble = _mm256_set1_epi8(0x0F);
+    if (from < width - 1) {
+        from = width - 1;
+    }
+    __m256i lo_tables[NIBBLE_MAX_WIDTH];
+    __m256i hi_tables[NIBBLE_MAX_WIDTH];
+    for (size_t k=0; k<width; k++) {
+        lo_tables[k] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)lo[k]));
+        hi_tables[k] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)hi[k]));
+    }
+    // the first lane is the fingerprint ending at end
+    size_t end = from;
+    for (; end + V <= size; end += V) {
+        __m256i result = _mm256_set1_epi8((char)0xFF);
+        for (size_t k=0; k<width; k++) {
+            __m256i chunk = _mm256_loadu_si256((const __m256i *)(str + end + 1 - width + k));
+            __m256i lo_buckets = _mm256_shuffle_epi8(lo_tables[k], _mm256_and_si256(chunk, low_nibble));
+            __m256i hi_buckets = _mm256_shuffle_epi8(hi_tables[k],
+                _mm256_and_si256(_mm256_srli_epi16(chunk, 4), low_nibble));
+            result = _mm256_and_si256(result, _mm256_and_si256(lo_buckets, hi_buckets));
+        }
+        uint32_t mask = ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(result, _mm256_setzero_si256()));
+        if (mask) {
+            size_t lane = __builtin_ctz(mask);
+            *buckets = nibble_buckets_scalar(str, end + lane, lo, hi, width);
+            return end + lane;
+        }
+    }
+    return find_nibble_match_scalar(str, end, size, lo, hi, width, buckets);
+}
+
+size_t count_le_u16(const uint16_t *values, size_t count, uint16_t bound) {
+    const size_t V = sizeof(__m256i) / sizeof(uint16_t);
+    const __m256i bounds = _mm256_set1_epi16((short)bound);
+    size_t result = 0;
+    size_t i = 0;
+    for (; i + V <= count; i += V) {
+        // there is no unsigned compare, but max(v, bound) == bound <=> v <= bound
+        __m256i chunk = _mm256_loadu_si256((const __m256i *)(values + i));
+        __m256i le = _mm256_cmpeq_epi16(_mm256_max_epu16(chunk, bounds), bounds);
+        // two mask bits per entry
+        result += __builtin_popcount(_mm256_movemask_epi8(le)) / 2;
+    }
+    return result + count_le_u16_scalar(values + i, count - i, bound);
+}
+
 #else
 
 bool is_ascii(const char *str, size_t size) {
@@ -256,4 +521,38 @@ const char *lookup_idx(const char *str, size_t size, size_t target_idx) {
     return lookup_idx_scalar(str, size, &char_count, target_idx);
 }
 
+size_t count_le_u16(const uint16_t *values, size_t count, uint16_t bound) {
+    return count_le_u16_scalar(values, count, bound);
+}
+
+const char *find_bytes(const char *str, size_t size, const char *needle, size_t needle_size) {
+    if (needle_size == 0) {
+        return str;
+    }
+    if (needle_size > size) {
+        return NULL;
+    }
+    return find_bytes_scalar(str, 0, size - needle_size + 1, needle, needle_size);
+}
+
+const char *rfind_bytes(const char *str, size_t size, const char *needle, size_t needle_size) {
+    if (needle_size == 0) {
+        return str + size;
+    }
+    if (needle_size > size) {
+        return NULL;
+    }
+    return rfind_bytes_scalar(str, 0, size - needle_size + 1, needle, needle_size);
+}
+
+size_t find_nibble_match(const char *str, size_t from, size_t size, const uint8_t lo[][16],
+                         const uint8_t hi[][16], size_t width, uint8_t *buckets) {
+    return find_nibble_match_scalar(str, from < width - 1 ? width - 1 : from, size, lo, hi, width, buckets);
+}
+
+size_t find_line_starts(const char *str, size_t from, size_t size, size_t chars_in_front,
+                        uint64_t *offsets, uint64_t *chars, size_t capacity) {
+    return find_line_starts_scalar(str, from, size, &chars_in_front, offsets, chars, 0, capacity);
+}
+
 #endif
\ No newline at end of file
@@ -7,6 +7,7 @@
 #define STR8_SIMD_H
 
 #include <stddef.h>
+#include <stdint.h>
 #include <stdbool.h>
 
 /**
@@ -42,4 +43,83 @@ size_t count_chars(const char *str, size_t size);
  */
 const char *lookup_idx(const char *str, size_t size, size_t target_idx);
 
+/**
+ * @brief Count the values <= bound.
+ *
+ * Compares 16 values per instruction. If values is sorted, this is the
+ * index of the first value > bound (a search without branches).
+ *
+ * @param values Array of count values (no alignment required).
+ * @param count Number of values.
+ * @param bound The upper bound.
+ * @returns The number of values <= bound.
+ */
+size_t count_le_u16(const uint16_t *values, size_t count, uint16_t bound);
+
+/** @brief Maximum number of fingerprint bytes of find_nibble_match(). */
+#define NIBBLE_MAX_WIDTH 4
+
+/**
+ * @brief Return the first occurrence of needle in the size bytes of str.
+ *
+ * Candidates are filtered by comparing the first and the last byte of the
+ * needle with 32 positions at once, only those are compared completely.
+ * An empty needle matches at str.
+ *
+ * @returns A pointer to the match or NULL if there is none.
+ */
+const char *find_bytes(const char *str, size_t size, const char *needle, size_t needle_size);
+
+/**
+ * @brief Return the last occurrence of needle in the size bytes of str.
+ *
+ * Like find_bytes(), but the positions are filtered from the end. An empty
+ * needle matches at str + size.
+ *
+ * @returns A pointer to the match or NULL if there is none.
+ */
+const char *rfind_bytes(const char *str, size_t size, const char *needle, size_t needle_size);
+
+/**
+ * @brief Return the first position whose preceding bytes match a bucket of nibble tables.
+ *
+ * This is the filter of the Teddy multi-pattern search: up to 8 buckets of
+ * patterns are described by the nibbles of their last width bytes.
+ * lo[k][n] (hi[k][n]) has bit b set if a pattern of bucket b has the low
+ * (high) nibble n at the k' of its last width bytes. The bytes ending at a
+ * position match a bucket if both nibbles of all of them have its bit set.
+ * 32 positions are checked with two byte shuffles per fingerprint byte.
+ *
+ * @param str The string to scan.
+ * @param from The first position to check (at least width - 1 is checked).
+ * @param size Size of str in bytes.
+ * @param lo Low nibble tables, one per fingerprint byte.
+ * @param hi High nibble tables, one per fingerprint byte.
+ * @param width Number of fingerprint bytes (1 to NIBBLE_MAX_WIDTH).
+ * @param buckets Receives the buckets matching at the returned position.
+ * @returns The position of the last byte of the first match, or size if there is none.
+ */
+size_t find_nibble_match(const char *str, size_t from, size_t size, const uint8_t lo[][16],
+                         const uint8_t hi[][16], size_t width, uint8_t *buckets);
+
+/**
+ * @brief Find the line starts (the bytes behind a '\n') in [from, size) of str.
+ *
+ * Newlines and characters are counted in the same pass. For every line start
+ * its byte offset in str and the number of characters in front of it are
+ * written to offsets and chars, until capacity line starts are found. If the
+ * result is capacity, the scan can be continued behind the last line start.
+ *
+ * @param str The string to scan.
+ * @param from The byte offset to start at.
+ * @param size Size of str in bytes.
+ * @param chars_in_front Number of characters in front of from.
+ * @param offsets Array for the byte offsets of the line starts.
+ * @param chars Array for the characters in front of the line starts.
+ * @param capacity Number of entries offsets and chars can hold.
+ * @returns The number of line starts written.
+ */
+size_t find_line_starts(const char *str, size_t from, size_t size, size_t chars_in_front,
+                        uint64_t *offsets, uint64_t *chars, size_t capacity);
+
 #endif // STR8_SIMD_H
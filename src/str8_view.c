@@ -0,0 +1,78 @@
+#include "str8_view.h"
+#include "str8_header.h"
+#include "str8_checkpoints.h"
+#include "str8_memory.h"
+
+str8view str8slice(str8 str, size_t start, size_t end) {
+    size_t length = str8len(str);
+    if (end > length) {
+        end = length;
+    }
+    if (start > end) {
+        start = end;
+    }
+    size_t byte_start, byte_end;
+    str8getrange(str, start, end, &byte_start, &byte_end);
+    str8view view = {
+        .parent = str,
+        .byte_offset = byte_start,
+        .char_offset = start,
+        .size = byte_end - byte_start,
+        .length = end - start
+    };
+    return view;
+}
+
+str8view str8viewslice(str8view view, size_t start, size_t end) {
+    if (end > view.length) {
+        end = view.length;
+    }
+    if (start > end) {
+        start = end;
+    }
+    size_t byte_start, byte_end;
+    str8getrange(view.parent, view.char_offset + start, view.char_offset + end, &byte_start, &byte_end);
+    str8view slice = {
+        .parent = view.parent,
+        .byte_offset = byte_start,
+        .char_offset = view.char_offset + start,
+        .size = byte_end - byte_start,
+        .length = end - start
+    };
+    return slice;
+}
+
+size_t str8viewlen(str8view view) {
+    return view.length;
+}
+
+size_t str8viewsize(str8view view) {
+    return view.size;
+}
+
+const char *str8viewstart(str8view view) {
+    return view.parent + view.byte_offset;
+}
+
+const char *str8viewgetchar(str8view view, size_t idx) {
+    if (idx >= view.length) {
+        return NULL;
+    }
+    return str8getchar(view.parent, view.char_offset + idx);
+}
+
+const char *str8viewnext(str8view view, const char *chr) {
+    const char *end = str8viewstart(view) + view.size;
+    if (chr >= end) {
+        return NULL;
+    }
+    chr++;
+    while (chr < end && (*chr & 0xC0) == 0x80) {
+        chr++;
+    }
+    return chr < end ? chr : NULL;
+}
+
+str8 str8viewdup(str8view view) {
+    return str8substr(view.parent, view.char_offset, view.char_offset + view.length);
+}
@@ -0,0 +1,63 @@
+/**
+ * @file str8_view.h
+ * @brief Read-only views into a str8 without copying.
+ *
+ * A view stores its position in the parent string in bytes and characters.
+ * Character lookups are forwarded to the parent, so they use the parent's
+ * checkpoints list and cost the same as str8getchar() on the parent.
+ * The parent must outlive the view and must not be modified while the view
+ * is in use.
+ */
+#ifndef STR8_VIEW_H
+#define STR8_VIEW_H
+
+#include "str8.h"
+#include <stddef.h>
+
+typedef struct {
+    str8 parent;         //< The string the view points into
+    size_t byte_offset;  //< Start of the view in parent in bytes
+    size_t char_offset;  //< Start of the view in parent in characters
+    size_t size;         //< Size of the view in bytes
+    size_t length;       //< Length of the view in characters
+} str8view;
+
+/**
+ * @brief Return a view of the characters [start, end) of str.
+ *
+ * end is clamped to the length of str and start is clamped to end.
+ */
+str8view str8slice(str8 str, size_t start, size_t end);
+
+/** @brief Return a view of the characters [start, end) of view (clamped as in str8slice()). */
+str8view str8viewslice(str8view view, size_t start, size_t end);
+
+/** @brief Return the number of characters in view. */
+size_t str8viewlen(str8view view);
+
+/** @brief Return the size of view in bytes. */
+size_t str8viewsize(str8view view);
+
+/** @brief Return a pointer to the first byte of view. */
+const char *str8viewstart(str8view view);
+
+/**
+ * @brief Return a pointer to the first byte of the idx' character of view.
+ *
+ * @returns The pointer or NULL if idx is out of bounds.
+ */
+const char *str8viewgetchar(str8view view, size_t idx);
+
+/**
+ * @brief Return a pointer to the character following chr.
+ *
+ * Start the iteration with str8viewstart().
+ *
+ * @returns The pointer or NULL if the end of the view is reached.
+ */
+const char *str8viewnext(str8view view, const char *chr);
+
+/** @brief Copy the content of view into a new str8. */
+str8 str8viewdup(str8view view);
+
+#endif
@@ -2,10 +2,13 @@
 #include "bench_helper.h"
 #include "src/str8.h"
 #include "src/str8_header.h"
+#include "src/str8_memory.h"
+#include "src/str8_index.h"
 
 #include <stdlib.h>
 #include <time.h>
 #include <stdio.h>
+#include <string.h>
 
 #ifndef CHECKPOINTS_GRANULARITY
 #define CHECKPOINTS_GRANULARITY 512
@@ -89,7 +92,108 @@ int main(void) {
     putc('\n', stdout);
 
 
-    // --- 4. Cleanup ---
+    // --- 4. Benchmark: Two-Level Index (for comparison) ---
+    str8 twolevel = str8buildtwolevelindex(str8dup(str, false), CHECKPOINTS_GRANULARITY);
+    if (!twolevel) {
+        fprintf(stderr, "Failed to build the two-level index.\n");
+        free(lookups);
+        str8free(str);
+        free(raw_string);
+        return 1;
+    }
+    printf("Performing %d random character lookups with the two-level index (%zu bytes, the list has %zu)...\n",
+           NUM_LOOKUPS,
+           checkpoints_twolevel_total_size(STR8_TYPE(twolevel), str8cap(twolevel), CHECKPOINTS_GRANULARITY),
+           checkpoints_list_total_size(str8cap(str), CHECKPOINTS_GRANULARITY));
+
+    double time_twolevel_us = MEASURE_TIME({
+        for (int i = 0; i < NUM_LOOKUPS; i++) {
+            sink = str8getchar(twolevel, lookups[i]);
+        }
+    });
+
+    printf("--- Results: Random Access (Two-Level) ---\n");
+    printf("  Total lookups: %d\n", NUM_LOOKUPS);
+    printf("  Total time:    %.4f ms\n", time_twolevel_us / 1000.0);
+    printf("  Avg latency:   %.2f ns/lookup\n", (time_twolevel_us * 1000.0) / NUM_LOOKUPS);
+    putc('\n', stdout);
+    str8free(twolevel);
+
+
+    // --- 5. Benchmark: Eytzinger Index (for comparison) ---
+    str8eytzinger eytzinger;
+    if (str8eytzingerbuild(&eytzinger, str) != 0) {
+        fprintf(stderr, "Failed to build the Eytzinger index.\n");
+        free(lookups);
+        str8free(str);
+        free(raw_string);
+        return 1;
+    }
+    printf("Performing %d random character lookups with the Eytzinger index (%zu bytes)...\n",
+           NUM_LOOKUPS, str8eytzingersize(&eytzinger));
+
+    double time_eytzinger_us = MEASURE_TIME({
+        for (int i = 0; i < NUM_LOOKUPS; i++) {
+            sink = str8eytzingergetchar(str, &eytzinger, lookups[i]);
+        }
+    });
+
+    printf("--- Results: Random Access (Eytzinger) ---\n");
+    printf("  Total lookups: %d\n", NUM_LOOKUPS);
+    printf("  Total time:    %.4f ms\n", time_eytzinger_us / 1000.0);
+    printf("  Avg latency:   %.2f ns/lookup\n", (time_eytzinger_us * 1000.0) / NUM_LOOKUPS);
+    putc('\n', stdout);
+    str8eytzingerfree(&eytzinger);
+
+
+    // --- 6. Benchmark: Skewed Corpus ---
+    // The lookup interpolates the position from size / length, so compare
+    // with a string whose bytes per character vary a lot: ASCII runs
+    // alternating with runs of multi-byte characters.
+    printf("Generating a %zu MB string of alternating ASCII and UTF-8 runs...\n", STRING_SIZE / (1024 * 1024));
+    char *skewed_raw = malloc(STRING_SIZE + 1);
+    if (!skewed_raw) {
+        fprintf(stderr, "Failed to allocate memory for the string.\n");
+        free(lookups);
+        str8free(str);
+        free(raw_string);
+        return 1;
+    }
+    size_t skewed_size = 0;
+    const size_t RUN_SIZE = 256 * 1024;
+    for (int run = 0; skewed_size + RUN_SIZE <= STRING_SIZE; run++) {
+        bool ascii = run % 2 == 0;
+        char *part = generate_random_string(ascii ? ascii_charset : utf8_charset,
+                                            ascii ? ascii_charset_size : utf8_charset_size,
+                                            RUN_SIZE);
+        size_t part_size = strlen(part);
+        memcpy(skewed_raw + skewed_size, part, part_size);
+        skewed_size += part_size;
+        free(part);
+    }
+    skewed_raw[skewed_size] = '\0';
+    str8 skewed = str8new(skewed_raw);
+    size_t skewed_len = str8len(skewed);
+    for (int i = 0; i < NUM_LOOKUPS; i++) {
+        lookups[i] = rand() % skewed_len;
+    }
+
+    double time_skewed_us = MEASURE_TIME({
+        for (int i = 0; i < NUM_LOOKUPS; i++) {
+            sink = str8getchar(skewed, lookups[i]);
+        }
+    });
+
+    printf("--- Results: Random Access (Skewed) ---\n");
+    printf("  Total lookups: %d\n", NUM_LOOKUPS);
+    printf("  Total time:    %.4f ms\n", time_skewed_us / 1000.0);
+    printf("  Avg latency:   %.2f ns/lookup\n", (time_skewed_us * 1000.0) / NUM_LOOKUPS);
+    putc('\n', stdout);
+    str8free(skewed);
+    free(skewed_raw);
+
+
+    // --- 7. Cleanup ---
     free(lookups);
     str8free(str);
     free(raw_string);
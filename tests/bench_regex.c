@@ -0,0 +1,79 @@
+#include "test_helper.h"
+#include "bench_helper.h"
+#include "src/str8.h"
+#include "src/str8_header.h"
+#include "src/str8_regex.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#define BENCH_COUNT 20
+
+// Use a volatile sink to prevent the compiler from optimizing away results.
+volatile size_t sink_size;
+
+/** @brief Return the number of matches of re in str, searched one after another. */
+static size_t count_matches(str8regex *re, str8 str) {
+    size_t count = 0;
+    size_t start = 0;
+    str8regexmatch match;
+    while (str8regexsearch(re, str, start, &match)) {
+        count++;
+        start = match.idx + (match.length ? match.length : 1);
+    }
+    return count;
+}
+
+int main(void) {
+    const size_t max_strlen = 1000000;
+    const char *patterns[] = { "[0-9]{3}", "ä[a-zäöü]+ß", "\\w+€", "[^a-zA-Z0-9]{4}", "(ab|cd|€ä)x", "Q.{40}Q" };
+    const size_t pattern_count = sizeof(patterns) / sizeof(patterns[0]);
+
+    // the same corpora for every pattern: the UTF-8 and the ASCII charset
+    str8 utf8_strings[BENCH_COUNT];
+    str8 ascii_strings[BENCH_COUNT];
+    for (int i=0; i<BENCH_COUNT; i++) {
+        char *s = generate_random_string(utf8_charset, utf8_charset_size, max_strlen / 2 + rand() % (max_strlen / 2));
+        utf8_strings[i] = str8new(s);
+        free(s);
+        s = generate_random_string(ascii_charset, ascii_charset_size, max_strlen / 2 + rand() % (max_strlen / 2));
+        ascii_strings[i] = str8new(s);
+        free(s);
+    }
+
+    for (size_t p=0; p<pattern_count; p++) {
+        str8regex *re = str8regexnew(patterns[p]);
+        printf("Pattern: \"%s\"\n", patterns[p]);
+
+        // --- Benchmark: all matches in UTF-8 strings ---
+        BENCH_DECLARE(regex_utf8);
+        for (int i=0; i<BENCH_COUNT; i++) {
+            double t = MEASURE_TIME({
+                sink_size = count_matches(re, utf8_strings[i]);
+            });
+            BENCH_UPDATE(regex_utf8, t, str8size(utf8_strings[i]));
+        }
+        BENCH_PRINT_RESULTS(regex_utf8, BENCH_COUNT);
+        printf("  Matches:      %zu (last string)\n", sink_size);
+
+        // --- Benchmark: all matches in ASCII strings ---
+        BENCH_DECLARE(regex_ascii);
+        for (int i=0; i<BENCH_COUNT; i++) {
+            double t = MEASURE_TIME({
+                sink_size = count_matches(re, ascii_strings[i]);
+            });
+            BENCH_UPDATE(regex_ascii, t, str8size(ascii_strings[i]));
+        }
+        BENCH_PRINT_RESULTS(regex_ascii, BENCH_COUNT);
+        printf("  Matches:      %zu (last string)\n\n", sink_size);
+
+        str8regexfree(re);
+    }
+
+    for (int i=0; i<BENCH_COUNT; i++) {
+        str8free(utf8_strings[i]);
+        str8free(ascii_strings[i]);
+    }
+    return 0;
+}
@@ -6,6 +6,7 @@
 #include "src/str8_checkpoints.h"
 #include "src/str8_debug.h"
 #include "src/str8_header.h"
+#include "src/str8_memory.h"
 #include "src/str8.h"
 #include "src/str8_simd.h"
 
@@ -71,6 +72,10 @@ void test_checkpoints_list(void) {
     TEST_CHECK(list_pointer == mem);
     ptrdiff_t diff = (ptrdiff_t)list_pointer - (ptrdiff_t)mem;
     TEST_MSG("Expected list pointer to be %p, but got %p (%ld bytes difference)", mem, list_pointer, diff);
+    // the tail record is in front of the entries
+    TEST_CHECK_EQUAL(checkpoints_list_total_size(256100, 512), list_byte_size + CHECKPOINTS_TAIL_SIZE,
+                     "%zu", "bytes");
+    TEST_CHECK_EQUAL(checkpoints_list_total_size(500, 512), 0UL, "%zu", "bytes");
 }
 
 void test_analyze_1(void) {
@@ -175,6 +180,106 @@ void test_analyze_4(void) {
     free(input);
 }
 
+void test_analyze_max_bytes(void) {
+    // max_bytes ends between two checkpoints, so there must not be an
+    // entry for the incomplete block
+    char input[2000];
+    memset(input, 'A', 2000);
+    memcpy(input, "€", 3);
+    input[1999] = '\0';
+
+    uint16_t list[MAX_2BYTE_INDEX + 1];
+    str8_analyze_config config = {
+        .list = list,
+        .list_capacity = MAX_2BYTE_INDEX + 1,
+        .byte_offset = 0
+    };
+    str8_analyze_results results;
+    int error = str8_analyze(input, 1000, config, &results);
+
+    TEST_CHECK_EQUAL(error, 0, "%d", "error");
+    TEST_CHECK_EQUAL(results.list_size, 1LU, "%zu", "list size");
+    TEST_CHECK_EQUAL(results.size, 1000LU, "%zu", "size");
+    TEST_CHECK_EQUAL(results.length, 998LU, "%zu", "length");
+
+    error = str8_analyze(input, 1024, config, &results);
+    TEST_CHECK_EQUAL(error, 0, "%d", "error");
+    TEST_CHECK_EQUAL(results.list_size, 2LU, "%zu", "list size");
+}
+
+/** @brief Analyze input with and without width detection and compare the entries. */
+void check_analyze_uniform(const char *input, size_t max_bytes, size_t expected_width) {
+    uint16_t list[MAX_2BYTE_INDEX + 1];
+    uint16_t uniform_list[MAX_2BYTE_INDEX + 1];
+    str8_analyze_config config = {
+        .list = list,
+        .list_capacity = MAX_2BYTE_INDEX + 1
+    };
+    str8_analyze_results results, uniform_results;
+    TEST_CHECK(str8_analyze(input, max_bytes, config, &results) == 0);
+    config.list = uniform_list;
+    config.uniform = true;
+    TEST_CHECK(str8_analyze(input, max_bytes, config, &uniform_results) == 0);
+
+    TEST_CHECK_EQUAL(uniform_results.width, expected_width, "%zu", "width");
+    TEST_CHECK_EQUAL(results.width, 0LU, "%zu", "width without detection");
+    TEST_CHECK_EQUAL(uniform_results.size, results.size, "%zu", "size");
+    TEST_CHECK_EQUAL(uniform_results.length, results.length, "%zu", "length");
+    TEST_CHECK_EQUAL(uniform_results.list_size, results.list_size, "%zu", "list size");
+    if (expected_width == 0) {
+        for (size_t idx=0; idx<results.list_size; idx++) {
+            if (read_entry(uniform_results.list, idx) != read_entry(results.list, idx)) {
+                TEST_CHECK_EQUAL(read_entry(uniform_results.list, idx), read_entry(results.list, idx),
+                                 "%zu", "entry");
+                TEST_MSG("Entry %zu", idx);
+                break;
+            }
+        }
+    }
+    if (results.list_created) {
+        free(results.list);
+    }
+    if (uniform_results.list_created) {
+        free(uniform_results.list);
+    }
+}
+
+void test_analyze_uniform(void) {
+    char *input = malloc(300001);
+    TEST_ASSERT(input);
+
+    TEST_CASE("ASCII");
+    memset(input, 'A', 300000);
+    input[300000] = '\0';
+    check_analyze_uniform(input, 0, 1);
+
+    TEST_CASE("Uniform");
+    for (size_t pos=0; pos<300000; pos+=3) {
+        memcpy(input + pos, "€", 3);
+    }
+    check_analyze_uniform(input, 0, 3);
+    check_analyze_uniform(input, 3000, 3);
+
+    TEST_CASE("Cut by max_bytes");
+    check_analyze_uniform(input, 1000, 0);
+
+    TEST_CASE("Other width at the end");
+    memcpy(input + 299997, "äA", 3);
+    check_analyze_uniform(input, 0, 0);
+
+    TEST_CASE("Other width in the middle");
+    memcpy(input + 299997, "€", 3);
+    memcpy(input + 150000, "ä", 2);
+    input[150002] = 'A';
+    check_analyze_uniform(input, 0, 0);
+
+    TEST_CASE("Continuation byte in place of a lead byte");
+    memcpy(input + 150000, "€", 3);
+    memcpy(input + 3000, "A\xA4\x82", 3);
+    check_analyze_uniform(input, 0, 0);
+    free(input);
+}
+
 void test_read_write(void) {
     // with list reallocation
     // more than MAX_2BYTE_INDEX / CHECKPOINTS_GRANULARITY entries are needed
@@ -228,6 +333,67 @@ void test_find_entry_ub(void) {
     TEST_CHECK_EQUAL(find_entry_ub(list, 100, 100000000), 99LU, "%zu", "index");
 }
 
+void test_find_entry_ub_from(void) {
+    uint16_t list[100];
+    for (size_t i=0; i<100; i++) {
+        write_entry(list, i, (i+1)*100);
+    }
+    for (size_t from=0; from<100; from++) {
+        for (size_t bound=(from+1)*100; bound<10100; bound+=37) {
+            TEST_CHECK_EQUAL(find_entry_ub_from(list, 100, from, bound), find_entry_ub(list, 100, bound), "%zu", "index");
+        }
+    }
+    TEST_CHECK_EQUAL(find_entry_ub_from(list, 100, 100, 50), 100LU, "%zu", "index");
+    TEST_CHECK_EQUAL(find_entry_ub_from(list, 100, 100, 550), 4LU, "%zu", "index");
+}
+
+void test_find_entry_ub_near(void) {
+    // reach into the u32 zone
+    void *mem = malloc(checkpoints_entry_offset(300));
+    for (size_t i=0; i<300; i++) {
+        write_entry(mem, i, (i+1)*300 + (i % 7) * 10);
+    }
+    for (size_t guess=0; guess<310; guess+=3) {
+        for (size_t bound=0; bound<92000; bound+=97) {
+            size_t expected = find_entry_ub(mem, 300, bound);
+            size_t got = find_entry_ub_near(mem, 300, guess, bound);
+            if (got != expected) {
+                TEST_CHECK_EQUAL(got, expected, "%zu", "index");
+                TEST_MSG("guess %zu, bound %zu", guess, bound);
+                free(mem);
+                return;
+            }
+        }
+    }
+    free(mem);
+}
+
+void test_getrange(void) {
+    for (int i=0; i<100; i++) {
+        char *s = generate_random_string(utf8_charset, utf8_charset_size, rand() % 200000);
+        size_t size = strlen(s);
+        str8 str = str8new(s);
+        size_t length = str8len(str);
+        size_t start = rand() % (length + 1);
+        size_t end = start + rand() % (length - start + 1);
+        if (i % 4 == 0) {
+            end = start + rand() % 20 > length ? length : start + rand() % 20;
+        }
+        size_t byte_start, byte_end;
+        str8getrange(str, start, end, &byte_start, &byte_end);
+        const char *first = start < length ? lookup_idx(s, size, start) : s + size;
+        const char *last = end < length ? lookup_idx(s, size, end) : s + size;
+        TEST_CHECK_EQUAL(byte_start, (size_t)(first - s), "%zu", "start");
+        TEST_CHECK_EQUAL(byte_end, (size_t)(last - s), "%zu", "end");
+
+        size_t pos = rand() % (size + 1);
+        TEST_CHECK_EQUAL(count_chars_to(str, checkpoints_list_ptr(str), size / CHECKPOINTS_GRANULARITY, pos),
+                         count_chars(s, pos), "%zu", "characters");
+        str8free(str);
+        free(s);
+    }
+}
+
 void test_getchar(void) {
     TEST_CASE("Short string");
     {
@@ -322,6 +488,110 @@ void test_getchar_random(void) {
     }
 }
 
+void test_getchar_mostly_ascii(void) {
+    TEST_CASE("Lead byte at the end of an ASCII block");
+    {
+        // the block has 512 character starts, but its last byte is a lead byte
+        char s[2001];
+        memset(s, 'A', 2000);
+        s[2000] = '\0';
+        memcpy(s + 511, "€", 3);
+        str8 str = str8new(s);
+        TEST_CHECK_EQUAL(read_entry(checkpoints_list_ptr(str), 0), 512LU, "%zu", "list entry");
+        TEST_CHECK(str8getchar(str, 511) == str + 511);
+        TEST_CHECK(str8getchar(str, 512) == str + 514);
+        TEST_CHECK(str8getchar(str, 1500) == str + 1502);
+        str8free(str);
+    }
+    TEST_CASE("Random");
+    for (int i=0; i<50; i++) {
+        // ASCII with a few multi-byte characters sprinkled in
+        size_t size = rand() % 100000 + 1000;
+        char *s = generate_random_string(ascii_charset, ascii_charset_size, size);
+        size = strlen(s);
+        for (int j=rand() % 20; j>=0; j--) {
+            size_t pos = rand() % (size - 4);
+            memcpy(s + pos, j % 2 ? "ä" : "😀", j % 2 ? 2 : 4);
+        }
+        str8 str = str8new(s);
+        size_t length = str8len(str);
+        for (size_t idx=0; idx<length; idx+=7) {
+            const char *expected = lookup_idx(s, size, idx);
+            if (str8getchar(str, idx) != str + (expected - s)) {
+                TEST_CHECK(str8getchar(str, idx) == str + (expected - s));
+                TEST_MSG("Character %zu", idx);
+                break;
+            }
+        }
+        size_t start = rand() % length;
+        size_t end = start + rand() % (length - start);
+        size_t byte_start, byte_end;
+        str8getrange(str, start, end, &byte_start, &byte_end);
+        TEST_CHECK_EQUAL(byte_start, (size_t)(lookup_idx(s, size, start) - s), "%zu", "start");
+        TEST_CHECK_EQUAL(byte_end, (size_t)(lookup_idx(s, size, end) - s), "%zu", "end");
+        str8free(str);
+        free(s);
+    }
+}
+
+/** @brief Check str8getidx() and str8countrange() of str (with the content s) at random positions. */
+void check_getidx(str8 str, const char *s) {
+    size_t size = strlen(s);
+    for (int j=0; j<20; j++) {
+        size_t pos = rand() % (size + 1);
+        TEST_CHECK_EQUAL(str8getidx(str, pos), count_chars(s, pos), "%zu", "index");
+        TEST_MSG("Byte %zu of %zu", pos, size);
+        size_t end = pos + (j % 2 ? (size_t)(rand() % 100) : rand() % (size - pos + 1));
+        size_t expected = count_chars(s + pos, (end > size ? size : end) - pos);
+        TEST_CHECK_EQUAL(str8countrange(str, pos, end), expected, "%zu", "characters");
+        TEST_MSG("Bytes %zu to %zu of %zu", pos, end, size);
+    }
+    TEST_CHECK_EQUAL(str8getidx(str, size + 10), str8len(str), "%zu", "index");
+    TEST_CHECK_EQUAL(str8countrange(str, size, 0), (size_t)0, "%zu", "characters");
+}
+
+void test_getidx(void) {
+    TEST_CASE("Short strings");
+    {
+        str8 str = str8new("Hällo");
+        check_getidx(str, "Hällo");
+        str8free(str);
+        const char *s = "Hällo Wörld, this is a string of type 1 with some characters like ä and 😀";
+        str = str8new(s);
+        check_getidx(str, s);
+        str8free(str);
+    }
+    TEST_CASE("Uniform width");
+    {
+        char s[3001];
+        for (size_t i=0; i<1000; i++) {
+            memcpy(s + i * 3, "語", 3);
+        }
+        s[3000] = '\0';
+        str8 str = str8new(s);
+        TEST_CHECK(STR8_WIDTH(str) == 3);
+        check_getidx(str, s);
+        str8free(str);
+    }
+    for (int i=0; i<50; i++) {
+        TEST_CASE_("Random %d", i);
+        bool ascii = i % 5 == 0;
+        char *s = generate_random_string(ascii ? ascii_charset : utf8_charset,
+                                         ascii ? ascii_charset_size : utf8_charset_size,
+                                         rand() % 300000);
+        str8 str = str8new(s);
+        check_getidx(str, s);
+        str = str8buildindex(str8dropindex(str), 64);
+        check_getidx(str, s);
+        str = str8dropindex(str);
+        check_getidx(str, s);
+        str = str8buildcharindex(str, 0);
+        check_getidx(str, s);
+        str8free(str);
+        free(s);
+    }
+}
+
 #ifdef SKIP_LARGE_MEMORY_TESTS
 void dummy(void) {
 }
@@ -338,9 +608,16 @@ TEST_LIST = {
     { "Analyze 3", test_analyze_3 },
 #endif
     { "Analyze 4", test_analyze_4 },
+    { "Analyze max_bytes", test_analyze_max_bytes },
+    { "Analyze uniform width", test_analyze_uniform },
     { "Read Write", test_read_write },
     { "Find Entry UB", test_find_entry_ub },
+    { "Find Entry UB From", test_find_entry_ub_from },
+    { "Find Entry UB Near", test_find_entry_ub_near },
+    { "Get Range", test_getrange },
     { "Get Char", test_getchar },
     { "Get Char Random", test_getchar_random },
+    { "Get Char Mostly ASCII", test_getchar_mostly_ascii },
+    { "Get Index", test_getidx },
     { NULL, NULL }
 };
\ No newline at end of file
@@ -0,0 +1,98 @@
+#include "acutest.h"
+#include "test_helper.h"
+#include "src/str8.h"
+#include "src/str8_header.h"
+#include "src/str8_memory.h"
+#include "src/str8_compare.h"
+#include "src/str8_debug.h"
+
+
+static const char *compare_charset[] = { "a", "b", "ä", "€", "😀", "\x7F", "a", "a" };
+static const size_t compare_charset_size = sizeof(compare_charset) / sizeof(compare_charset[0]);
+
+static int sign(int x) {
+    return (x > 0) - (x < 0);
+}
+
+void test_compare_simple(void) {
+    const char *cases[][2] = {
+        { "", "" }, { "", "a" }, { "a", "b" }, { "abc", "abd" }, { "ab", "abc" },
+        { "z", "ä" }, { "ä", "ö" }, { "ÿ", "Ā" }, { "€", "😀" }, { "\x7F", "\xC2\x80" },
+        { "\xEF\xBF\xBF", "\xF0\x90\x80\x80" }, { "Hällo", "Hallo" }, { "Straße", "Straße" }
+    };
+    for (size_t i=0; i<sizeof(cases) / sizeof(cases[0]); i++) {
+        TEST_CASE_("\"%s\" - \"%s\"", cases[i][0], cases[i][1]);
+        str8 a = str8new(cases[i][0]);
+        str8 b = str8new(cases[i][1]);
+        int expected = sign(strcmp(cases[i][0], cases[i][1]));
+        TEST_CHECK_EQUAL(sign(str8compare(a, b)), expected, "%d", "order");
+        TEST_CHECK_EQUAL(sign(str8compare(b, a)), -expected, "%d", "order");
+        TEST_CHECK(str8equal(a, b) == (expected == 0));
+        TEST_CHECK(str8equal(a, a));
+        str8free(a);
+        str8free(b);
+    }
+
+    TEST_CASE("Prefix and suffix");
+    str8 str = str8new("Hällo Wörld €");
+    TEST_CHECK(str8startswith(str, ""));
+    TEST_CHECK(str8startswith(str, "Häl"));
+    TEST_CHECK(str8startswith(str, "Hällo Wörld €"));
+    TEST_CHECK(!str8startswith(str, "Hal"));
+    TEST_CHECK(!str8startswith(str, "Hällo Wörld €!"));
+    TEST_CHECK(str8endswith(str, ""));
+    TEST_CHECK(str8endswith(str, "rld €"));
+    TEST_CHECK(str8endswith(str, "Hällo Wörld €"));
+    TEST_CHECK(!str8endswith(str, "rld"));
+    TEST_CHECK(!str8endswith(str, "!Hällo Wörld €"));
+    str8free(str);
+}
+
+void test_compare_random(void) {
+    for (int i=0; i<500; i++) {
+        TEST_CASE_("Round %d", i);
+        // short strings are of type 0, long ones compare several vectors
+        size_t max_length = i % 2 ? 30 : 400;
+        size_t charset_size = i % 3 == 0 ? 2 : compare_charset_size;
+        char *s = generate_random_string(compare_charset, charset_size, rand() % max_length);
+        char *t;
+        if (i % 4 == 0) {
+            t = strdup(s);
+        }
+        else if (i % 4 == 1 && strlen(s) > 0) {
+            // differ in a single byte of a character
+            t = strdup(s);
+            size_t pos = rand() % strlen(t);
+            t[pos] = (t[pos] & 0xC0) == 0x80 ? (char)(0x80 | ((t[pos] + 1) & 0x3F)) : t[pos] == 'a' ? 'b' : t[pos];
+        }
+        else {
+            t = generate_random_string(compare_charset, charset_size, rand() % max_length);
+        }
+        str8 a = str8new(s);
+        str8 b = str8new(t);
+        if (i % 5 == 1) {
+            b = str8dropindex(b);
+        }
+        int expected = sign(strcmp(s, t));
+        TEST_CHECK_EQUAL(sign(str8compare(a, b)), expected, "%d", "order");
+        TEST_CHECK(str8equal(a, b) == (expected == 0));
+        TEST_MSG("\"%s\" - \"%s\"", s, t);
+
+        size_t cut = strlen(t) ? rand() % (strlen(t) + 1) : 0;
+        TEST_CHECK(str8startswith(a, t + strlen(t) - cut) == (strncmp(s, t + strlen(t) - cut, cut) == 0 && strlen(s) >= cut));
+        TEST_CHECK(str8endswith(a, t + strlen(t) - cut) ==
+                   (strlen(s) >= cut && strcmp(s + strlen(s) - cut, t + strlen(t) - cut) == 0));
+        TEST_CHECK(str8startswith(a, s + strlen(s) / 2) == (strncmp(s, s + strlen(s) / 2, strlen(s + strlen(s) / 2)) == 0));
+        TEST_CHECK(str8endswith(a, s + strlen(s) / 2));
+        str8free(a);
+        str8free(b);
+        free(s);
+        free(t);
+    }
+}
+
+TEST_LIST = {
+    { "Compare (simple)", test_compare_simple },
+    { "Compare (random)", test_compare_random },
+    { NULL, NULL }
+};
@@ -0,0 +1,575 @@
+#include "acutest.h"
+#include "test_helper.h"
+#include "src/str8.h"
+#include "src/str8_header.h"
+#include "src/str8_checkpoints.h"
+#include "src/str8_memory.h"
+#include "src/str8_simd.h"
+#include "src/str8_edit.h"
+#include "src/str8_debug.h"
+
+
+/** @brief Compare str with a freshly created string from expected. */
+void check_equal(str8 str, const char *expected) {
+    size_t size = strlen(expected);
+    size_t length = count_chars(expected, size);
+    TEST_CHECK(str);
+    TEST_CHECK(strcmp(str, expected) == 0);
+    TEST_MSG("Content differs");
+    TEST_CHECK_EQUAL(str8size(str), size, "%zu", "size");
+    TEST_CHECK_EQUAL(str8len(str), length, "%zu", "length");
+    TEST_CHECK(str8cap(str) >= size);
+
+    void *list = checkpoints_list_ptr(str);
+    if (!list) {
+        TEST_CHECK(STR8_TYPE(str) <= STR8_TYPE1 || length == size || STR8_WIDTH(str) ||
+                   STR8_INDEX(str) == STR8_INDEX_NONE || STR8_INDEX(str) == STR8_INDEX_CHARS ||
+                   STR8_INDEX(str) == STR8_INDEX_TWOLEVEL);
+        if (checkpoints_anchors_ptr(str)) {
+            // the characters at the anchors are resolved by the anchors alone
+            size_t distance = STR8_GRANULARITY(str);
+            const char *p = expected;
+            for (size_t idx=distance; idx<length; idx+=distance) {
+                p = lookup_idx(p, size - (p - expected), distance);
+                if (str8getchar(str, idx) != str + (p - expected)) {
+                    TEST_CHECK_EQUAL(str8getchar(str, idx) - str, p - expected, "%ld", "anchor");
+                    TEST_MSG("Character %zu", idx);
+                    break;
+                }
+            }
+        }
+        if (checkpoints_twolevel_ptr(str)) {
+            // the block ends are resolved by the index alone
+            size_t granularity = STR8_GRANULARITY(str);
+            for (size_t pos=granularity; pos<size; pos+=granularity) {
+                if (str8getidx(str, pos) != count_chars(expected, pos)) {
+                    TEST_CHECK_EQUAL(str8getidx(str, pos), count_chars(expected, pos), "%zu", "block");
+                    TEST_MSG("Byte %zu", pos);
+                    break;
+                }
+            }
+        }
+        return;
+    }
+    size_t granularity = STR8_GRANULARITY(str);
+    for (size_t idx=0; idx<size/granularity; idx++) {
+        size_t value = read_entry(list, idx);
+        size_t expected_value = count_chars(expected, checkpoints_entry_pos(list, size / granularity, idx, granularity));
+        if (value != expected_value) {
+            TEST_CHECK_EQUAL(value, expected_value, "%zu", "entry");
+            TEST_MSG("Entry %zu of %zu", idx, size/granularity);
+            break;
+        }
+    }
+}
+
+/** @brief Return a malloc'ed copy of s with the characters [start, end) replaced by other. */
+char *reference_replace(const char *s, size_t start, size_t end, const char *other) {
+    size_t size = strlen(s);
+    size_t length = count_chars(s, size);
+    end = end > length ? length : end;
+    start = start > end ? end : start;
+    const char *first = start < length ? lookup_idx(s, size, start) : s + size;
+    const char *last = end < length ? lookup_idx(s, size, end) : s + size;
+    size_t other_size = strlen(other);
+    char *result = malloc(size + other_size + 1);
+    memcpy(result, s, first - s);
+    memcpy(result + (first - s), other, other_size);
+    strcpy(result + (first - s) + other_size, last);
+    return result;
+}
+
+void test_insert(void) {
+    TEST_CASE("Type 0");
+    {
+        str8 str = str8new("Hello");
+        str = str8insert(str, 5, " World");
+        check_equal(str, "Hello World");
+        str = str8insert(str, 0, "€");
+        check_equal(str, "€Hello World");
+        str = str8insert(str, 100, "!");
+        check_equal(str, "€Hello World!");
+        str8free(str);
+    }
+    TEST_CASE("ASCII to UTF-8 without growing");
+    {
+        char s[3001];
+        memset(s, 'A', 3000);
+        s[3000] = '\0';
+        str8 str = str8new(s);
+        str = str8grow(str, 4000, false);
+        TEST_CHECK(STR8_IS_ASCII(str));
+        str = str8insert(str, 1500, "€");
+        char *expected = reference_replace(s, 1500, 1500, "€");
+        check_equal(str, expected);
+        TEST_CHECK(!STR8_IS_ASCII(str));
+        free(expected);
+        str8free(str);
+    }
+}
+
+void test_erase(void) {
+    str8 str = str8new("ä€ö€ü and some more text to get beyond type 0");
+    str = str8erase(str, 1, 3);
+    check_equal(str, "äü and some more text to get beyond type 0");
+    str = str8erase(str, 10, 1000);
+    check_equal(str, "äü and som");
+    str = str8erase(str, 100, 1);
+    check_equal(str, "äü and som");
+    str8free(str);
+}
+
+void test_truncate(void) {
+    char *s = generate_random_string(utf8_charset, utf8_charset_size, 100000);
+    str8 str = str8new(s);
+    str = str8truncate(str, 20000);
+    char *expected = reference_replace(s, 20000, SIZE_MAX, "");
+    check_equal(str, expected);
+    free(expected);
+    str8free(str);
+    free(s);
+}
+
+void test_shared(void) {
+    str8 str = str8share(str8new("TESTTESTTESTTESTTESTTESTTESTTESTTEST"));
+    str8 other = str8retain(str);
+    other = str8replace(other, 4, 4, "€");
+    TEST_CHECK(other != str);
+    TEST_CHECK_STR(str, "TESTTESTTESTTESTTESTTESTTESTTESTTEST");
+    check_equal(other, "TEST€TESTTESTTESTTESTTESTTESTTEST");
+    str8free(other);
+    str8free(str);
+}
+
+void test_random(void) {
+    for (int i=0; i<300; i++) {
+        bool ascii = rand() % 4 == 0;
+        const char **charset = ascii ? ascii_charset : utf8_charset;
+        size_t charset_size = ascii ? ascii_charset_size : utf8_charset_size;
+        char *s = generate_random_string(charset, charset_size, rand() % 150000);
+        str8 str = str8new(s);
+        if (rand() % 2) {
+            str = str8grow(str, str8cap(str) + rand() % 10000, false);
+        }
+        TEST_CASE_("Round %d", i);
+
+        for (int j=0; j<5; j++) {
+            size_t length = count_chars(s, strlen(s));
+            size_t start = rand() % (length + 1);
+            size_t count = rand() % 3 ? (size_t)(rand() % 50) : rand() % (length - start + 1);
+            size_t other_size = rand() % 3 ? (size_t)(rand() % 20) : (size_t)(rand() % 3000);
+            bool other_ascii = rand() % 2;
+            char *other = generate_random_string(other_ascii ? ascii_charset : utf8_charset,
+                                                 other_ascii ? ascii_charset_size : utf8_charset_size,
+                                                 other_size);
+            char *expected = reference_replace(s, start, start + count, other);
+            str = str8replace(str, start, count, other);
+            check_equal(str, expected);
+            free(other);
+            free(s);
+            s = expected;
+        }
+        str8free(str);
+        free(s);
+    }
+}
+
+void test_shift(void) {
+    TEST_CASE("Insert and erase");
+    {
+        char *s = generate_random_string(utf8_charset, utf8_charset_size, 40000);
+        str8 str = str8new(s);
+        size_t granularity = STR8_GRANULARITY(str);
+        // the entries behind the edit are moved instead of counted, entry 0 is counted
+        // at the grid and the old entry 0 is entry 1 now
+        str = str8insert(str, 10, "x");
+        char *expected = reference_replace(s, 10, 10, "x");
+        check_equal(str, expected);
+        checkpoints_tail tail = checkpoints_read_tail(checkpoints_list_ptr(str));
+        TEST_CHECK_EQUAL(tail.first, 1UL, "%zu", "first");
+        TEST_CHECK_EQUAL(tail.offset, granularity - 1, "%zu", "offset");
+        // and back to the grid
+        str = str8erase(str, 10, 1);
+        check_equal(str, s);
+        tail = checkpoints_read_tail(checkpoints_list_ptr(str));
+        TEST_CHECK_EQUAL(tail.offset, 0UL, "%zu", "offset");
+        str8free(str);
+        free(expected);
+        free(s);
+    }
+    TEST_CASE("Many edits");
+    {
+        char *s = generate_random_string(utf8_charset, utf8_charset_size, 50000);
+        str8 str = str8new(s);
+        for (int i=0; i<300; i++) {
+            size_t length = count_chars(s, strlen(s));
+            // mostly close to the previous edit, sometimes anywhere
+            size_t start = rand() % 4 ? (length / 3 + (size_t)(i * 7) % 2000) % (length + 1)
+                                      : (size_t)rand() % (length + 1);
+            size_t count = rand() % 10;
+            char *other = generate_random_string(utf8_charset, utf8_charset_size, rand() % 10);
+            char *expected = reference_replace(s, start, start + count, other);
+            str = str8replace(str, start, count, other);
+            free(other);
+            free(s);
+            s = expected;
+        }
+        check_equal(str, s);
+        str8free(str);
+        free(s);
+    }
+    TEST_CASE("Lists without a tail record");
+    {
+        // below CHECKPOINTS_TAIL_MIN_COUNT entries the list has no record,
+        // so its entries stay on the grid while it grows and shrinks past it
+        char *s = generate_random_string(utf8_charset, utf8_charset_size, 2000);
+        str8 str = str8new(s);
+        for (int i=0; i<40; i++) {
+            size_t length = count_chars(s, strlen(s));
+            size_t start = (size_t)rand() % (length + 1);
+            size_t count = i < 20 ? rand() % 10 : rand() % 3000;
+            char *other = generate_random_string(utf8_charset, utf8_charset_size,
+                                                 i < 20 ? rand() % 3000 : rand() % 10);
+            char *expected = reference_replace(s, start, start + count, other);
+            str = str8replace(str, start, count, other);
+            check_equal(str, expected);
+            free(other);
+            free(s);
+            s = expected;
+        }
+        str8free(str);
+        free(s);
+    }
+}
+
+void test_apply_edits(void) {
+    TEST_CASE("Simple");
+    {
+        str8 str = str8new("The quick brown fox jumps over the lazy dog");
+        str8edit edits[] = {
+            { 4, 9, "slow" },
+            { 10, 15, "grün" },
+            { 16, 16, "€ " },
+            { 40, 100, "cät" }
+        };
+        str8 result = str8applyedits(str, edits, 4);
+        check_equal(result, "The slow grün € fox jumps over the lazy cät");
+        TEST_CHECK_STR(str, "The quick brown fox jumps over the lazy dog");
+        str8free(result);
+
+        result = str8applyedits(str, edits, 0);
+        check_equal(result, str);
+        str8free(result);
+        str8free(str);
+    }
+    TEST_CASE("Unsorted");
+    {
+        str8 str = str8new("The quick brown fox jumps over the lazy dog");
+        str8edit edits[] = {
+            { 10, 15, "grün" },
+            { 4, 9, "slow" }
+        };
+        TEST_CHECK(str8applyedits(str, edits, 2) == NULL);
+        str8free(str);
+    }
+    TEST_CASE("Random");
+    for (int i=0; i<100; i++) {
+        bool ascii = rand() % 4 == 0;
+        char *s = generate_random_string(ascii ? ascii_charset : utf8_charset,
+                                         ascii ? ascii_charset_size : utf8_charset_size,
+                                         rand() % 150000);
+        str8 str = str8new(s);
+        size_t length = str8len(str);
+
+        size_t count = rand() % 50;
+        str8edit edits[50];
+        char *texts[50];
+        size_t pos = 0;
+        for (size_t j=0; j<count; j++) {
+            size_t start = pos + rand() % ((length - pos) / (count - j) + 1);
+            size_t end = start + rand() % 100;
+            end = end > length ? length : end;
+            bool text_ascii = rand() % 2;
+            texts[j] = generate_random_string(text_ascii ? ascii_charset : utf8_charset,
+                                              text_ascii ? ascii_charset_size : utf8_charset_size,
+                                              rand() % (rand() % 5 ? 20 : 2000));
+            edits[j] = (str8edit){ start, end, texts[j] };
+            pos = end;
+        }
+
+        // apply the edits from the back, so the indices stay valid
+        char *expected = strdup(s);
+        for (size_t j=count; j-- > 0;) {
+            char *next = reference_replace(expected, edits[j].start, edits[j].end, edits[j].text);
+            free(expected);
+            expected = next;
+        }
+
+        str8 result = str8applyedits(str, edits, count);
+        check_equal(result, expected);
+
+        for (size_t j=0; j<count; j++) {
+            free(texts[j]);
+        }
+        free(expected);
+        str8free(result);
+        str8free(str);
+        free(s);
+    }
+}
+
+void test_uniform_width(void) {
+    char *s = malloc(3001);
+    for (size_t i=0; i<1500; i++) {
+        memcpy(s + 2 * i, "ж", 2);
+    }
+    s[3000] = '\0';
+    str8 str = str8new(s);
+    TEST_CHECK(STR8_WIDTH(str) == 2);
+    str = str8insert(str, 3, "ab");
+    char *expected = reference_replace(s, 3, 3, "ab");
+    check_equal(str, expected);
+    TEST_CHECK(STR8_WIDTH(str) == 0);
+    free(expected);
+    str8free(str);
+
+    for (size_t i=0; i<1000; i++) {
+        memcpy(s + 3 * i, "語", 3);
+    }
+    s[3000] = '\0';
+    str = str8new(s);
+    TEST_CHECK(STR8_WIDTH(str) == 3);
+    memcpy(str + 1500, "abc", 3);
+    memcpy(s + 1500, "abc", 3);
+    str = str8reindex(str, 1500, 1503);
+    check_equal(str, s);
+    str8free(str);
+
+    // str8applyedits() keeps the width if the replacements have it
+    for (size_t i=0; i<1000; i++) {
+        memcpy(s + 3 * i, "語", 3);
+    }
+    str = str8new(s);
+    str8edit edits[] = {
+        { 10, 20, "€€" },
+        { 30, 30, "" }
+    };
+    str8 applied = str8applyedits(str, edits, 2);
+    expected = reference_replace(s, 10, 20, "€€");
+    check_equal(applied, expected);
+    TEST_CHECK(STR8_WIDTH(applied) == 3);
+    str8free(applied);
+    free(expected);
+    edits[1].text = "x";
+    applied = str8applyedits(str, edits, 2);
+    TEST_CHECK(STR8_WIDTH(applied) == 0);
+    TEST_CHECK(checkpoints_list_ptr(applied) != NULL);
+    str8free(applied);
+    str8free(str);
+    free(s);
+}
+
+void test_reindex(void) {
+    TEST_CASE("Type 1");
+    {
+        str8 str = str8new("Hällo, this is a somewhat longer text");
+        memcpy(str + 1, "ae", 2);
+        str = str8reindex(str, 1, 3);
+        check_equal(str, "Haello, this is a somewhat longer text");
+        str8free(str);
+    }
+    TEST_CASE("ASCII to UTF-8");
+    {
+        char s[3001];
+        memset(s, 'A', 3000);
+        s[3000] = '\0';
+        str8 str = str8new(s);
+        memcpy(str + 1000, "€", 3);
+        memcpy(s + 1000, "€", 3);
+        str = str8reindex(str, 1000, 1003);
+        check_equal(str, s);
+        TEST_CHECK(!STR8_IS_ASCII(str));
+        str8free(str);
+    }
+    TEST_CASE("Shared");
+    {
+        char s[3001];
+        memset(s, 'A', 3000);
+        s[3000] = '\0';
+        str8 str = str8share(str8new(s));
+        str8 other = str8retain(str);
+        str = str8unshare(str);
+        memcpy(str + 1000, "€", 3);
+        str = str8reindex(str, 1000, 1003);
+        TEST_CHECK(str != other);
+        TEST_CHECK(STR8_IS_ASCII(other));
+        check_equal(other, s);
+        memcpy(s + 1000, "€", 3);
+        check_equal(str, s);
+        TEST_CHECK(!STR8_IS_ASCII(str));
+        str8free(other);
+        str8free(str);
+    }
+    TEST_CASE("Shared with a uniform width");
+    {
+        char s[3001];
+        for (size_t i=0; i<1000; i++) {
+            memcpy(s + 3 * i, "語", 3);
+        }
+        s[3000] = '\0';
+        str8 str = str8share(str8new(s));
+        str8 other = str8retain(str);
+        // the header of str grows, the one of other is left alone
+        str = str8reindex(str, 0, 3);
+        TEST_CHECK(str != other);
+        TEST_CHECK_EQUAL(*refcount_field(other), 1LU, "%zu", "references");
+        TEST_CHECK_EQUAL(STR8_WIDTH(other), 3LU, "%zu", "width");
+        check_equal(other, s);
+        check_equal(str, s);
+        str8free(other);
+        str8free(str);
+    }
+    TEST_CASE("Random");
+    for (int i=0; i<200; i++) {
+        bool ascii = rand() % 4 == 0;
+        char *s = generate_random_string(ascii ? ascii_charset : utf8_charset,
+                                         ascii ? ascii_charset_size : utf8_charset_size,
+                                         rand() % 150000);
+        str8 str = str8new(s);
+        size_t size = strlen(s);
+        for (int j=0; j<5 && size > 0; j++) {
+            // overwrite a range with random bytes of another string,
+            // splitting multi-byte characters does not matter for counting
+            size_t start = rand() % size;
+            size_t end = start + rand() % (rand() % 3 ? 20 : 5000);
+            end = end > size ? size : end;
+            bool other_ascii = rand() % 2;
+            char *other = generate_random_string(other_ascii ? ascii_charset : utf8_charset,
+                                                 other_ascii ? ascii_charset_size : utf8_charset_size,
+                                                 end - start);
+            end = start + strlen(other);
+            memcpy(str + start, other, end - start);
+            memcpy(s + start, other, end - start);
+            str = str8reindex(str, start, end);
+            check_equal(str, s);
+            free(other);
+        }
+        str8free(str);
+        free(s);
+    }
+}
+
+/** @brief Apply random edits to strings created with create and check that they keep their index kind. */
+void check_edits_keep_index(str8 (*create)(const char *)) {
+    for (int i=0; i<50; i++) {
+        char *s = generate_random_string(utf8_charset, utf8_charset_size, 1000 + rand() % 100000);
+        str8 str = create(s);
+        uint8_t desc = STR8_DESCRIPTOR(str);
+        TEST_CASE_("Round %d", i);
+        for (int j=0; j<5; j++) {
+            size_t length = count_chars(s, strlen(s));
+            size_t start = rand() % (length + 1);
+            size_t count = rand() % 3 ? (size_t)(rand() % 50) : rand() % (length - start + 1);
+            bool other_ascii = rand() % 2;
+            char *other = generate_random_string(other_ascii ? ascii_charset : utf8_charset,
+                                                 other_ascii ? ascii_charset_size : utf8_charset_size,
+                                                 rand() % 3000);
+            char *expected = reference_replace(s, start, start + count, other);
+            str = str8replace(str, start, count, other);
+            check_equal(str, expected);
+            free(other);
+            free(s);
+            s = expected;
+        }
+        // the descriptor is kept, unless the string became too short for a list
+        if (STR8_TYPE(str) > STR8_TYPE1) {
+            TEST_CHECK_EQUAL(STR8_DESCRIPTOR(str), desc, "%d", "descriptor");
+        }
+
+        // and by str8applyedits()
+        size_t length = count_chars(s, strlen(s));
+        size_t start = rand() % (length + 1);
+        size_t end = start + rand() % (length - start + 1);
+        char *other = generate_random_string(utf8_charset, utf8_charset_size, rand() % 3000);
+        str8edit edits[] = {
+            { start, end, other },
+            { end, end + 10, "äb" }
+        };
+        char *expected = reference_replace(s, end, end + 10, "äb");
+        char *next = reference_replace(expected, start, end, other);
+        free(expected);
+        expected = next;
+        str8 applied = str8applyedits(str, edits, 2);
+        check_equal(applied, expected);
+        if (STR8_TYPE(applied) > STR8_TYPE1) {
+            TEST_CHECK_EQUAL(STR8_DESCRIPTOR(applied), desc, "%d", "descriptor of the applied edits");
+        }
+        str8free(applied);
+        free(expected);
+        free(other);
+        size_t size = strlen(s);
+        if (size > 0) {
+            size_t start = rand() % size;
+            size_t end = start + rand() % 1000;
+            end = end > size ? size : end;
+            char *other = generate_random_string(utf8_charset, utf8_charset_size, end - start);
+            end = start + strlen(other);
+            memcpy(str + start, other, end - start);
+            memcpy(s + start, other, end - start);
+            str = str8reindex(str, start, end);
+            check_equal(str, s);
+            free(other);
+        }
+        str8free(str);
+        free(s);
+    }
+}
+
+str8 new_fine(const char *s) {
+    return str8newgranularity(s, 0, 128);
+}
+
+str8 new_unindexed(const char *s) {
+    return str8newunindexed(s, 0);
+}
+
+str8 new_charindex(const char *s) {
+    return str8buildcharindex(str8new(s), 64);
+}
+
+str8 new_twolevel(const char *s) {
+    return str8buildtwolevelindex(str8new(s), 0);
+}
+
+void test_granularity(void) {
+    check_edits_keep_index(new_fine);
+}
+
+void test_charindex(void) {
+    check_edits_keep_index(new_charindex);
+}
+
+void test_twolevel(void) {
+    check_edits_keep_index(new_twolevel);
+}
+
+void test_unindexed(void) {
+    check_edits_keep_index(new_unindexed);
+}
+
+TEST_LIST = {
+    { "Insert", test_insert },
+    { "Erase", test_erase },
+    { "Truncate", test_truncate },
+    { "Shared", test_shared },
+    { "Random", test_random },
+    { "Shift", test_shift },
+    { "Apply Edits", test_apply_edits },
+    { "Reindex", test_reindex },
+    { "Granularity", test_granularity },
+    { "Unindexed", test_unindexed },
+    { "Char Index", test_charindex },
+    { "Two-Level Index", test_twolevel },
+    { "Uniform Width", test_uniform_width },
+    { NULL, NULL }
+};
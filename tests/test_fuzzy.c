@@ -0,0 +1,173 @@
+#include "acutest.h"
+#include "test_helper.h"
+#include "src/str8.h"
+#include "src/str8_header.h"
+#include "src/str8_memory.h"
+#include "src/str8_fuzzy.h"
+#include "src/str8_debug.h"
+
+
+/** @brief A small alphabet, so the strings are similar. */
+static const char *fuzzy_charset[] = { "a", "b", "c", "ä", "€", "😀", "a", "b" };
+static const size_t fuzzy_charset_size = sizeof(fuzzy_charset) / sizeof(fuzzy_charset[0]);
+
+/** @brief Split s into its characters (pointers to their first bytes). */
+static size_t split_chars(const char *s, const char **chars) {
+    size_t count = 0;
+    for (; *s; s++) {
+        if ((*s & 0xC0) != 0x80) {
+            chars[count++] = s;
+        }
+    }
+    return count;
+}
+
+static bool same_char(const char *a, const char *b) {
+    do {
+        if (*a++ != *b++) {
+            return false;
+        }
+    } while ((*a & 0xC0) == 0x80);
+    return true;
+}
+
+/** @brief Return the distance of a and b with the dynamic programming matrix. */
+size_t naive_distance(const char *a, const char *b) {
+    const char **ca = malloc((strlen(a) + 1) * sizeof(char *));
+    const char **cb = malloc((strlen(b) + 1) * sizeof(char *));
+    size_t m = split_chars(a, ca);
+    size_t n = split_chars(b, cb);
+    size_t *column = malloc((m + 1) * sizeof(size_t));
+    for (size_t i=0; i<=m; i++) {
+        column[i] = i;
+    }
+    for (size_t j=1; j<=n; j++) {
+        size_t diagonal = column[0];
+        column[0] = j;
+        for (size_t i=1; i<=m; i++) {
+            size_t above = column[i];
+            size_t best = diagonal + !same_char(ca[i - 1], cb[j - 1]);
+            best = above + 1 < best ? above + 1 : best;
+            best = column[i - 1] + 1 < best ? column[i - 1] + 1 : best;
+            column[i] = best;
+            diagonal = above;
+        }
+    }
+    size_t distance = column[m];
+    free(column);
+    free(ca);
+    free(cb);
+    return distance;
+}
+
+/** @brief Return a copy of s with count random edits. */
+char *mutate(const char *s, size_t count) {
+    char *result = strdup(s);
+    for (size_t k=0; k<count; k++) {
+        const char **chars = malloc((strlen(result) + 2) * sizeof(char *));
+        size_t length = split_chars(result, chars);
+        chars[length] = result + strlen(result);
+        size_t pos = length ? rand() % length : 0;
+        size_t start = chars[pos] - result;
+        size_t end = length ? (size_t)(chars[pos + 1] - result) : start;
+        free(chars);
+        // substitute, insert or delete
+        const char *insert = fuzzy_charset[rand() % fuzzy_charset_size];
+        int kind = rand() % 3;
+        if (kind == 1) {
+            end = start;
+        }
+        else if (kind == 2) {
+            insert = "";
+        }
+        size_t size = strlen(result) - (end - start) + strlen(insert);
+        char *next = malloc(size + 1);
+        memcpy(next, result, start);
+        strcpy(next + start, insert);
+        strcat(next, result + end);
+        free(result);
+        result = next;
+    }
+    return result;
+}
+
+void test_distance_simple(void) {
+    const char *pairs[][2] = {
+        { "", "" }, { "", "abc" }, { "kitten", "sitting" }, { "flaw", "lawn" },
+        { "Straße", "Strasse" }, { "€uro", "Euro" }, { "😀😀", "😀" }, { "äöü", "aou" },
+        { "same", "same" }, { "ä", "" }
+    };
+    const size_t expected[] = { 0, 3, 3, 2, 2, 1, 1, 3, 0, 1 };
+    for (size_t i=0; i<sizeof(pairs) / sizeof(pairs[0]); i++) {
+        TEST_CASE_("\"%s\" - \"%s\"", pairs[i][0], pairs[i][1]);
+        str8 a = str8new(pairs[i][0]);
+        str8 b = str8new(pairs[i][1]);
+        TEST_CHECK_EQUAL(str8distance(a, b), expected[i], "%zu", "distance");
+        TEST_CHECK_EQUAL(str8distance(b, a), expected[i], "%zu", "distance");
+        TEST_CHECK_EQUAL(str8distancebounded(a, b, expected[i]), expected[i], "%zu", "distance");
+        if (expected[i] > 0) {
+            TEST_CHECK_EQUAL(str8distancebounded(a, b, expected[i] - 1), expected[i], "%zu", "distance");
+        }
+        str8free(a);
+        str8free(b);
+    }
+}
+
+void test_distance_random(void) {
+    for (int i=0; i<200; i++) {
+        TEST_CASE_("Round %d", i);
+        // single words, several words and one string across the boundary
+        size_t max_length = i % 3 == 0 ? 64 : i % 3 == 1 ? 300 : 140;
+        bool ascii = i % 4 == 0;
+        char *s = ascii ? generate_random_string(fuzzy_charset, 3, rand() % max_length)
+                        : generate_random_string(fuzzy_charset, fuzzy_charset_size, rand() % max_length);
+        char *t = i % 2 ? mutate(s, rand() % 20) : generate_random_string(fuzzy_charset, ascii ? 3 : fuzzy_charset_size, rand() % max_length);
+        size_t expected = naive_distance(s, t);
+        str8 a = str8new(s);
+        str8 b = str8new(t);
+        if (i % 5 == 1) {
+            b = str8dropindex(b);
+        }
+        TEST_CHECK_EQUAL(str8distance(a, b), expected, "%zu", "distance");
+        TEST_CHECK_EQUAL(str8distance(b, a), expected, "%zu", "distance");
+        size_t max = rand() % 30;
+        TEST_CHECK_EQUAL(str8distancebounded(a, b, max), expected <= max ? expected : max + 1, "%zu", "distance");
+        TEST_MSG("\"%s\" - \"%s\" (max %zu)", s, t, max);
+        str8free(a);
+        str8free(b);
+        free(s);
+        free(t);
+    }
+}
+
+void test_distance_batch(void) {
+    for (int i=0; i<10; i++) {
+        TEST_CASE_("Round %d", i);
+        char *s = generate_random_string(fuzzy_charset, fuzzy_charset_size, rand() % (i % 2 ? 50 : 200));
+        str8 pattern = str8new(s);
+        char *candidates[50];
+        str8 strs[50];
+        size_t distances[50];
+        for (int k=0; k<50; k++) {
+            candidates[k] = mutate(s, rand() % 10);
+            strs[k] = str8new(candidates[k]);
+        }
+        size_t max = i % 3 ? 5 : SIZE_MAX - 1;
+        TEST_CHECK(str8distancebatch(pattern, (const str8 *)strs, 50, max, distances) == 0);
+        for (int k=0; k<50; k++) {
+            size_t expected = naive_distance(s, candidates[k]);
+            TEST_CHECK_EQUAL(distances[k], expected <= max ? expected : max + 1, "%zu", "distance");
+            str8free(strs[k]);
+            free(candidates[k]);
+        }
+        str8free(pattern);
+        free(s);
+    }
+}
+
+TEST_LIST = {
+    { "Distance (simple)", test_distance_simple },
+    { "Distance (random)", test_distance_random },
+    { "Distance (batch)", test_distance_batch },
+    { NULL, NULL }
+};
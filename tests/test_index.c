@@ -0,0 +1,187 @@
+#include "acutest.h"
+#include "test_helper.h"
+#include "src/str8.h"
+#include "src/str8_header.h"
+#include "src/str8_checkpoints.h"
+#include "src/str8_simd.h"
+#include "src/str8_memory.h"
+#include "src/str8_index.h"
+#include "src/str8_edit.h"
+#include "src/str8_debug.h"
+
+
+/** @brief Compare lookups of str (with a two-level index) with the ones of s for every character. */
+void check_twolevel(str8 str, const char *s) {
+    size_t size = strlen(s);
+    size_t length = count_chars(s, size);
+    TEST_CHECK(strcmp(str, s) == 0);
+    TEST_CHECK_EQUAL(str8len(str), length, "%zu", "length");
+    const char *p = s;
+    for (size_t idx=0; idx<length; idx++) {
+        const char *got = str8getchar(str, idx);
+        if (got != str + (p - s)) {
+            TEST_CHECK(got == str + (p - s));
+            TEST_MSG("Character %zu: expected offset %zd, got %zd",
+                     idx, p - s, got ? got - str : -1);
+            break;
+        }
+        if (str8getidx(str, p - s) != idx) {
+            TEST_CHECK_EQUAL(str8getidx(str, p - s), idx, "%zu", "index");
+            break;
+        }
+        p = lookup_idx(p, size - (p - s), 1);
+        p = p ? p : s + size;
+    }
+    TEST_CHECK(str8getchar(str, size) == NULL);
+    if (length > 10) {
+        size_t byte_start, byte_end;
+        str8getrange(str, 3, length - 5, &byte_start, &byte_end);
+        TEST_CHECK(s + byte_start == lookup_idx(s, size, 3));
+        TEST_CHECK(s + byte_end == lookup_idx(s, size, length - 5));
+    }
+}
+
+void test_twolevel(void) {
+    TEST_CASE("No index needed");
+    {
+        str8 str = str8buildtwolevelindex(str8new("Hällo Wörld"), 0);
+        TEST_CHECK(STR8_INDEX(str) != STR8_INDEX_TWOLEVEL);
+        check_twolevel(str, "Hällo Wörld");
+        str8free(str);
+        char *s = generate_random_string(ascii_charset, ascii_charset_size, 100000);
+        str = str8buildtwolevelindex(str8new(s), 0);
+        TEST_CHECK(STR8_INDEX(str) != STR8_INDEX_TWOLEVEL);
+        check_twolevel(str, s);
+        str8free(str);
+        free(s);
+    }
+    TEST_CASE("Random");
+    for (int i=0; i<20; i++) {
+        // up to several superblocks and into the 4 byte zone of the list
+        char *s = generate_random_string(utf8_charset, utf8_charset_size, rand() % 300000);
+        str8 str = str8buildtwolevelindex(str8new(s), i % 3 ? 0 : 64);
+        if (str8size(str) >= 256) {
+            TEST_CHECK(STR8_INDEX(str) == STR8_INDEX_TWOLEVEL);
+            TEST_CHECK(checkpoints_list_ptr(str) == NULL);
+            TEST_CHECK(checkpoints_twolevel_ptr(str) != NULL);
+        }
+        check_twolevel(str, s);
+        str8free(str);
+        free(s);
+    }
+    TEST_CASE("Size");
+    {
+        size_t capacity = 3000000;
+        size_t count = capacity / CHECKPOINTS_GRANULARITY;
+        size_t twolevel_size = checkpoints_twolevel_total_size(STR8_TYPE4, capacity, CHECKPOINTS_GRANULARITY);
+        // the u32 zone of the list needs 4 bytes per block
+        TEST_CHECK(twolevel_size < count * 3);
+        TEST_CHECK(twolevel_size < checkpoints_list_total_size(capacity, CHECKPOINTS_GRANULARITY) * 3 / 4);
+    }
+    TEST_CASE("Copies and appending");
+    {
+        char *s = generate_random_string(utf8_charset, utf8_charset_size, 60000);
+        str8 str = str8buildtwolevelindex(str8new(s), 0);
+        str8 copy = str8dup(str, false);
+        TEST_CHECK(STR8_INDEX(copy) == STR8_INDEX_TWOLEVEL);
+        check_twolevel(copy, s);
+        str8free(copy);
+        copy = str8dup(str, true);
+        TEST_CHECK(STR8_INDEX(copy) == STR8_INDEX_TWOLEVEL);
+        check_twolevel(copy, s);
+        str8free(copy);
+        size_t length = count_chars(s, strlen(s));
+        str8 sub = str8substr(str, length / 3, length);
+        TEST_CHECK(STR8_INDEX(sub) == STR8_INDEX_TWOLEVEL);
+        check_twolevel(sub, lookup_idx(s, strlen(s), length / 3));
+        str8free(sub);
+
+        // appending grows the header, so the superblocks move
+        char *other = generate_random_string(utf8_charset, utf8_charset_size, 30000);
+        str = str8append(str, other);
+        char *expected = malloc(strlen(s) + strlen(other) + 1);
+        strcpy(expected, s);
+        strcat(expected, other);
+        TEST_CHECK_EQUAL(STR8_TYPE(str), STR8_TYPE4, "%d", "type");
+        TEST_CHECK(STR8_INDEX(str) == STR8_INDEX_TWOLEVEL);
+        check_twolevel(str, expected);
+
+        str = str8buildindex(str, 0);
+        TEST_CHECK(STR8_INDEX(str) == STR8_INDEX_LIST);
+        check_twolevel(str, expected);
+        str8free(str);
+        free(expected);
+        free(other);
+        free(s);
+    }
+}
+
+/** @brief Compare lookups with the Eytzinger index with str8getchar() for every character. */
+void check_eytzinger(str8 str) {
+    str8eytzinger index;
+    TEST_CHECK(str8eytzingerbuild(&index, str) == 0);
+    size_t length = str8len(str);
+    for (size_t idx=0; idx<length; idx++) {
+        const char *expected = str8getchar(str, idx);
+        const char *got = str8eytzingergetchar(str, &index, idx);
+        if (got != expected) {
+            TEST_CHECK(got == expected);
+            TEST_MSG("Character %zu: expected offset %zd, got %zd",
+                     idx, expected - str, got ? got - str : -1);
+            break;
+        }
+    }
+    TEST_CHECK(str8eytzingergetchar(str, &index, str8size(str)) == NULL);
+    str8eytzingerfree(&index);
+}
+
+void test_eytzinger(void) {
+    TEST_CASE("Short");
+    {
+        str8 str = str8new("Hällo Wörld");
+        check_eytzinger(str);
+        str8free(str);
+    }
+    TEST_CASE("ASCII");
+    {
+        char *s = generate_random_string(ascii_charset, ascii_charset_size, 100000);
+        str8 str = str8new(s);
+        check_eytzinger(str);
+        str8free(str);
+        free(s);
+    }
+    TEST_CASE("Random");
+    for (int i=0; i<20; i++) {
+        // cover complete and incomplete trees
+        char *s = generate_random_string(utf8_charset, utf8_charset_size, rand() % 300000);
+        str8 str = str8new(s);
+        check_eytzinger(str);
+        str8free(str);
+        free(s);
+    }
+    TEST_CASE("Granularity");
+    {
+        char *s = generate_random_string(utf8_charset, utf8_charset_size, 50000);
+        str8 str = str8newgranularity(s, 0, 16);
+        check_eytzinger(str);
+        str8free(str);
+        free(s);
+    }
+    TEST_CASE("Entries off the grid");
+    {
+        char *s = generate_random_string(utf8_charset, utf8_charset_size, 40000);
+        str8 str = str8new(s);
+        str = str8insert(str, 10, "x");
+        checkpoints_tail tail = checkpoints_read_tail(checkpoints_list_ptr(str));
+        TEST_CHECK(tail.offset != 0);
+        check_eytzinger(str);
+        str8free(str);
+        free(s);
+    }
+}
+
+TEST_LIST = {
+    { "Two-Level", test_twolevel },
+    { "Eytzinger", test_eytzinger },
+    { NULL, NULL }
+};
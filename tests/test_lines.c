@@ -0,0 +1,128 @@
+#include "acutest.h"
+#include "test_helper.h"
+#include "src/str8.h"
+#include "src/str8_header.h"
+#include "src/str8_memory.h"
+#include "src/str8_simd.h"
+#include "src/str8_lines.h"
+#include "src/str8_debug.h"
+
+
+/** @brief Return a random string with a newline about every line_size bytes. */
+char *generate_lines(size_t size, size_t line_size) {
+    char *s = generate_random_string(utf8_charset, utf8_charset_size, size);
+    size = strlen(s);
+    for (size_t i=0; line_size && i<size / line_size; i++) {
+        size_t pos = rand() % size;
+        // only replace ASCII bytes to keep the string valid
+        if (!(s[pos] & 0x80)) {
+            s[pos] = '\n';
+        }
+    }
+    return s;
+}
+
+/** @brief Check every conversion of lines against a scan of s. */
+void check_lines(str8 str, const char *s) {
+    str8lines lines;
+    TEST_CHECK(str8linesbuild(&lines, str) == 0);
+    size_t size = strlen(s);
+    size_t line = 0;
+    size_t column = 0;
+    size_t idx = 0;
+    for (size_t pos=0; pos<=size; pos++) {
+        if (pos < size && (s[pos] & 0xC0) == 0x80) {
+            continue;
+        }
+        if (column == 0 && str8linestart(&lines, line) != pos) {
+            TEST_CHECK_EQUAL(str8linestart(&lines, line), pos, "%zu", "line start");
+            break;
+        }
+        size_t got_column;
+        size_t got_line = str8linesfromidx(&lines, idx, &got_column);
+        if (got_line != line || got_column != column) {
+            TEST_CHECK(got_line == line && got_column == column);
+            TEST_MSG("Character %zu: expected %zu:%zu, got %zu:%zu", idx, line, column, got_line, got_column);
+            break;
+        }
+        got_line = str8linesfromoffset(str, &lines, pos, &got_column);
+        if (got_line != line || got_column != column) {
+            TEST_CHECK(got_line == line && got_column == column);
+            TEST_MSG("Byte %zu: expected %zu:%zu, got %zu:%zu", pos, line, column, got_line, got_column);
+            break;
+        }
+        if (str8linesidx(&lines, line, column) != idx || str8linesoffset(str, &lines, line, column) != pos) {
+            TEST_CHECK_EQUAL(str8linesidx(&lines, line, column), idx, "%zu", "index");
+            TEST_CHECK_EQUAL(str8linesoffset(str, &lines, line, column), pos, "%zu", "offset");
+            TEST_MSG("Line %zu, column %zu", line, column);
+            break;
+        }
+        if (pos < size && s[pos] == '\n') {
+            // columns behind the end of the line are clamped to the newline
+            TEST_CHECK_EQUAL(str8linesidx(&lines, line, column + 5), idx, "%zu", "index");
+            TEST_CHECK_EQUAL(str8linesoffset(str, &lines, line, column + 5), pos, "%zu", "offset");
+            line++;
+            column = 0;
+        }
+        else {
+            column++;
+        }
+        idx++;
+    }
+    TEST_CHECK_EQUAL(lines.count, line + 1, "%zu", "lines");
+    TEST_CHECK_EQUAL(str8linestart(&lines, lines.count), size, "%zu", "line start");
+    TEST_CHECK_EQUAL(str8linesoffset(str, &lines, lines.count + 3, 0), str8linestart(&lines, lines.count - 1),
+                     "%zu", "offset");
+    str8linesfree(&lines);
+}
+
+void test_lines_simple(void) {
+    const char *strings[] = { "", "\n", "a", "Hällo\nWörld", "\n\nä\n", "a\r\nb\r\n" };
+    for (size_t i=0; i<sizeof(strings) / sizeof(strings[0]); i++) {
+        TEST_CASE(strings[i]);
+        str8 str = str8new(strings[i]);
+        check_lines(str, strings[i]);
+        str8free(str);
+    }
+    TEST_CASE("Lines");
+    {
+        str8 str = str8new("ab\nc€d\n\nxyz");
+        str8lines lines;
+        TEST_CHECK(str8linesbuild(&lines, str) == 0);
+        TEST_CHECK_EQUAL(lines.count, (size_t)4, "%zu", "lines");
+        TEST_CHECK_EQUAL(str8linestart(&lines, 1), (size_t)3, "%zu", "line start");
+        TEST_CHECK_EQUAL(str8linesoffset(str, &lines, 1, 2), (size_t)7, "%zu", "offset");
+        size_t column;
+        TEST_CHECK_EQUAL(str8linesfromoffset(str, &lines, 7, &column), (size_t)1, "%zu", "line");
+        TEST_CHECK_EQUAL(column, (size_t)2, "%zu", "column");
+        TEST_CHECK_EQUAL(str8linesfromidx(&lines, 9, &column), (size_t)3, "%zu", "line");
+        TEST_CHECK_EQUAL(column, (size_t)1, "%zu", "column");
+        str8linesfree(&lines);
+        str8free(str);
+    }
+}
+
+void test_lines_random(void) {
+    // from short lines to lines longer than the granularity
+    size_t line_sizes[] = { 0, 4, 40, 400, 4000 };
+    for (int i=0; i<50; i++) {
+        size_t line_size = line_sizes[i % 5];
+        char *s = generate_lines(rand() % 100000, line_size);
+        TEST_CASE_("Line size %zu, round %d", line_size, i);
+        str8 str = str8new(s);
+        check_lines(str, s);
+        // the columns of long lines are resolved without a list as well
+        str = str8dropindex(str);
+        check_lines(str, s);
+        str = str8buildcharindex(str, 0);
+        check_lines(str, s);
+        str8free(str);
+        free(s);
+    }
+}
+
+TEST_LIST = {
+    { "Lines (simple)", test_lines_simple },
+    { "Lines (random)", test_lines_random },
+    { NULL, NULL }
+};
@@ -5,6 +5,7 @@
 #include "src/str8_checkpoints.h"
 #include "src/str8_memory.h"
 #include "src/str8_simd.h"
+#include "src/str8_edit.h"
 
 
 void check_simple(const char *s) {
@@ -300,6 +301,698 @@ void test_append(void) {
     }
 }
 
+void check_dup(str8 str, bool shrink) {
+    str8 copy = str8dup(str, shrink);
+    size_t size = str8size(str);
+    TEST_CHECK(copy);
+    TEST_CHECK(copy != str);
+    TEST_CHECK(strcmp(copy, str) == 0);
+    TEST_CHECK_EQUAL(str8size(copy), size, "%zu", "size");
+    TEST_CHECK_EQUAL(str8len(copy), str8len(str), "%zu", "length");
+    TEST_CHECK_EQUAL(STR8_IS_ASCII(copy), STR8_IS_ASCII(str), "%d", "ASCII");
+    if (shrink) {
+        TEST_CHECK_EQUAL(str8cap(copy), size, "%zu", "capacity");
+        TEST_CHECK_EQUAL(STR8_TYPE(copy), type_from_capacity(size), "%d", "type");
+    }
+    else {
+        TEST_CHECK_EQUAL(str8cap(copy), str8cap(str), "%zu", "capacity");
+        TEST_CHECK_EQUAL(STR8_TYPE(copy), STR8_TYPE(str), "%d", "type");
+    }
+    for (size_t idx=0; idx<str8len(str); idx+=97) {
+        TEST_CHECK_EQUAL(str8getchar(copy, idx) - copy, str8getchar(str, idx) - str, "%ld", "offset");
+    }
+    str8free(copy);
+}
+
+void test_dup(void) {
+    TEST_CASE("Type 0");
+    {
+        str8 str = str8new("F€€");
+        check_dup(str, false);
+        check_dup(str, true);
+        str8free(str);
+    }
+    TEST_CASE("Type 2 (with list)");
+    {
+        char *s = generate_random_string(utf8_charset, utf8_charset_size, 20000);
+        str8 str = str8new(s);
+        check_dup(str, false);
+        check_dup(str, true);
+        str8free(str);
+        free(s);
+    }
+    TEST_CASE("Grown Type 4 shrinked to Type 2");
+    {
+        char *s = generate_random_string(utf8_charset, utf8_charset_size, 20000);
+        str8 str = str8new(s);
+        str = str8grow(str, 100000, false);
+        TEST_CHECK_EQUAL(STR8_TYPE(str), STR8_TYPE4, "%d", "type");
+        check_dup(str, false);
+        check_dup(str, true);
+        str8free(str);
+        free(s);
+    }
+    TEST_CASE("Grown ASCII shrinked to Type 0");
+    {
+        str8 str = str8new("TEST");
+        str = str8append(str, "FOO");
+        check_dup(str, false);
+        check_dup(str, true);
+        str8free(str);
+    }
+}
+
+void check_substr(str8 str, size_t start, size_t end) {
+    str8 sub = str8substr(str, start, end);
+    size_t length = str8len(str);
+    end = end > length ? length : end;
+    start = start > end ? end : start;
+    const char *first = start < length ? str8getchar(str, start) : str + str8size(str);
+    const char *last = end < length ? str8getchar(str, end) : str + str8size(str);
+    size_t size = last - first;
+
+    TEST_CHECK(sub);
+    TEST_CHECK_EQUAL(str8size(sub), size, "%zu", "size");
+    TEST_CHECK_EQUAL(str8len(sub), end - start, "%zu", "length");
+    TEST_CHECK_EQUAL(STR8_TYPE(sub), type_from_capacity(size), "%d", "type");
+    TEST_CHECK(memcmp(sub, first, size) == 0 && sub[size] == '\0');
+
+    // compare with a freshly analyzed string, the entries of sub might be off the grid
+    str8 ref = str8newsize(first, size ? size : 1);
+    if (size == 0) {
+        ref[0] = '\0';
+        str8setsize(ref, 0);
+    }
+    TEST_CHECK_EQUAL(STR8_IS_ASCII(sub), STR8_IS_ASCII(ref), "%d", "ASCII");
+    void *list = checkpoints_list_ptr(sub);
+    void *ref_list = checkpoints_list_ptr(ref);
+    TEST_CHECK((list == NULL) == (ref_list == NULL));
+    if (list && ref_list) {
+        for (size_t idx=0; idx<size/CHECKPOINTS_GRANULARITY; idx++) {
+            size_t pos = checkpoints_entry_pos(list, size / CHECKPOINTS_GRANULARITY, idx,
+                                               CHECKPOINTS_GRANULARITY);
+            TEST_CHECK_EQUAL(read_entry(list, idx), count_chars(first, pos), "%zu", "entry");
+        }
+    }
+    str8free(ref);
+    str8free(sub);
+}
+
+void test_substr(void) {
+    TEST_CASE("Short");
+    {
+        str8 str = str8new("ä€ö€ü");
+        check_substr(str, 1, 4);
+        check_substr(str, 0, 5);
+        check_substr(str, 2, 2);
+        check_substr(str, 4, 100);
+        check_substr(str, 10, 2);
+        str8free(str);
+    }
+    TEST_CASE("ASCII");
+    {
+        char s[3000];
+        memset(s, 'A', 2999);
+        s[2999] = '\0';
+        str8 str = str8new(s);
+        check_substr(str, 100, 2000);
+        check_substr(str, 0, 31);
+        str8free(str);
+    }
+    TEST_CASE("Aligned");
+    {
+        char *s = generate_random_string(utf8_charset, utf8_charset_size, 100000);
+        str8 str = str8new(s);
+        // find a character starting at a checkpoint
+        size_t idx = 1000;
+        while ((str8getchar(str, idx) - str) % CHECKPOINTS_GRANULARITY != 0 && idx < 2000) {
+            idx++;
+        }
+        check_substr(str, idx, 50000);
+        str8free(str);
+        free(s);
+    }
+    TEST_CASE("Random");
+    for (int i=0; i<100; i++) {
+        char *s = generate_random_string(utf8_charset, utf8_charset_size, rand() % 200000);
+        str8 str = str8new(s);
+        size_t length = str8len(str);
+        size_t start = rand() % (length + 1);
+        size_t end = start + rand() % (length - start + 1);
+        check_substr(str, start, end);
+        str8free(str);
+        free(s);
+    }
+    TEST_CASE("Parent with shifted entries");
+    for (int i=0; i<50; i++) {
+        char *s = generate_random_string(utf8_charset, utf8_charset_size, 1000 + rand() % 100000);
+        str8 str = str8new(s);
+        // the entries behind the inserted characters get an offset
+        for (int k=0; k<1+i%3; k++) {
+            str = str8insert(str, rand() % (str8len(str) + 1), k % 2 ? "€x" : "ä");
+        }
+        size_t length = str8len(str);
+        size_t start = rand() % (length + 1);
+        size_t end = start + rand() % (length - start + 1);
+        check_substr(str, start, end);
+        str8free(str);
+        free(s);
+    }
+}
+
+void test_share(void) {
+    TEST_CASE("Type 0 is promoted");
+    {
+        str8 str = str8share(str8new("F€€"));
+        TEST_CHECK(str);
+        TEST_CHECK(STR8_IS_SHARED(str));
+        TEST_CHECK_EQUAL(STR8_TYPE(str), STR8_TYPE1, "%d", "type");
+        TEST_CHECK_EQUAL(str8len(str), 3LU, "%zu", "length");
+        TEST_CHECK_STR(str, "F€€");
+        TEST_CHECK_EQUAL(*refcount_field(str), 1LU, "%zu", "references");
+        str8free(str);
+    }
+    TEST_CASE("Retain and release");
+    {
+        char *s = generate_random_string(utf8_charset, utf8_charset_size, 20000);
+        str8 str = str8share(str8new(s));
+        TEST_CHECK(STR8_IS_SHARED(str));
+        TEST_CHECK_STR(str, s);
+        str8 other = str8retain(str);
+        TEST_CHECK(other == str);
+        TEST_CHECK_EQUAL(*refcount_field(str), 2LU, "%zu", "references");
+        str8free(other);
+        TEST_CHECK_EQUAL(*refcount_field(str), 1LU, "%zu", "references");
+        TEST_CHECK_EQUAL(str8getchar(str, 10000) - str, lookup_idx(s, strlen(s), 10000) - s, "%ld", "offset");
+        str8free(str);
+        free(s);
+    }
+    TEST_CASE("Copy on write");
+    {
+        str8 str = str8share(str8new("TESTTESTTESTTESTTESTTESTTESTTESTTEST"));
+        str8 other = str8retain(str);
+        other = str8append(other, "€");
+        TEST_CHECK(other != str);
+        TEST_CHECK(STR8_IS_SHARED(other));
+        TEST_CHECK_EQUAL(*refcount_field(str), 1LU, "%zu", "references");
+        TEST_CHECK_EQUAL(*refcount_field(other), 1LU, "%zu", "references");
+        TEST_CHECK_STR(str, "TESTTESTTESTTESTTESTTESTTESTTESTTEST");
+        TEST_CHECK_STR(other, "TESTTESTTESTTESTTESTTESTTESTTESTTEST€");
+        TEST_CHECK_EQUAL(str8len(other), 37LU, "%zu", "length");
+
+        // the only owner modifies in place
+        str8 grown = str8grow(other, 2000, false);
+        TEST_CHECK(STR8_IS_SHARED(grown));
+        TEST_CHECK_EQUAL(STR8_TYPE(grown), STR8_TYPE2, "%d", "type");
+        TEST_CHECK_EQUAL(*refcount_field(grown), 1LU, "%zu", "references");
+        TEST_CHECK_STR(grown, "TESTTESTTESTTESTTESTTESTTESTTESTTEST€");
+        TEST_CHECK_EQUAL(str8len(grown), 37LU, "%zu", "length");
+
+        str8 copy = str8dup(grown, false);
+        TEST_CHECK(!STR8_IS_SHARED(copy));
+        TEST_CHECK_STR(copy, grown);
+        str8free(copy);
+        str8free(grown);
+        str8free(str);
+    }
+}
+
+void test_append_utf8_within_capacity(void) {
+    // the ASCII header needs to be extended although the capacity suffices
+    char s[1001];
+    memset(s, 'A', 1000);
+    s[1000] = '\0';
+    str8 str = str8new(s);
+    str = str8append(str, "B");
+    TEST_CHECK(STR8_IS_ASCII(str));
+    size_t capacity = str8cap(str);
+    str = str8append(str, "€");
+    TEST_CHECK(!STR8_IS_ASCII(str));
+    TEST_CHECK_EQUAL(str8cap(str), capacity, "%zu", "capacity");
+    TEST_CHECK_EQUAL(str8size(str), 1004LU, "%zu", "size");
+    TEST_CHECK_EQUAL(str8len(str), 1002LU, "%zu", "length");
+    TEST_CHECK_EQUAL(read_entry(checkpoints_list_ptr(str), 0), 512LU, "%zu", "entry");
+    TEST_CHECK(str8getchar(str, 1001) == str + 1001);
+    str8free(str);
+}
+
+void test_append_ascii_to_utf8(void) {
+    TEST_CASE("Type 1");
+    {
+        str8 str = str8new("€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€€");
+        str = str8append(str, "abc");
+        TEST_CHECK_EQUAL(str8len(str), 77LU, "%zu", "length");
+        str8free(str);
+    }
+    TEST_CASE("Checkpoints");
+    {
+        char s[2001];
+        memset(s, 'A', 2000);
+        s[2000] = '\0';
+        str8 str = str8new("ä");
+        str = str8append(str, s);
+        TEST_CHECK_EQUAL(str8size(str), 2002LU, "%zu", "size");
+        TEST_CHECK_EQUAL(str8len(str), 2001LU, "%zu", "length");
+        void *list = checkpoints_list_ptr(str);
+        TEST_CHECK(list != NULL);
+        for (size_t idx=0; list && idx<3; idx++) {
+            TEST_CHECK_EQUAL(read_entry(list, idx), (idx + 1) * 512 - 1, "%zu", "entry");
+        }
+        TEST_CHECK(str8getchar(str, 1500) == str + 1501);
+        str8free(str);
+    }
+}
+
+/** @brief Check content, length and list of str (if it has one) against s. */
+void check_indexed(str8 str, const char *s) {
+    size_t size = strlen(s);
+    TEST_CHECK(strcmp(str, s) == 0);
+    TEST_CHECK_EQUAL(str8size(str), size, "%zu", "size");
+    TEST_CHECK_EQUAL(str8len(str), count_chars(s, size), "%zu", "length");
+    void *list = checkpoints_list_ptr(str);
+    size_t granularity = STR8_GRANULARITY(str);
+    for (size_t idx=0; list && idx<size/granularity; idx++) {
+        size_t expected = count_chars(s, checkpoints_entry_pos(list, size / granularity, idx, granularity));
+        if (read_entry(list, idx) != expected) {
+            TEST_CHECK_EQUAL(read_entry(list, idx), expected, "%zu", "entry");
+            break;
+        }
+    }
+    const char *p = s;
+    for (size_t idx=0; *p; idx++) {
+        if (str8getchar(str, idx) != str + (p - s)) {
+            TEST_CHECK_EQUAL(str8getchar(str, idx) - str, p - s, "%ld", "offset");
+            break;
+        }
+        p = lookup_idx(p, strlen(p), 1);
+        p = p ? p : s + size;
+    }
+}
+
+/** @brief Return a malloc'ed string of c repeated count times. */
+char *repeat(const char *c, size_t count) {
+    size_t c_size = strlen(c);
+    char *s = malloc(c_size * count + 1);
+    for (size_t i=0; i<count; i++) {
+        memcpy(s + i * c_size, c, c_size);
+    }
+    s[c_size * count] = '\0';
+    return s;
+}
+
+void test_uniform_width(void) {
+    const char *chars[] = { "ж", "語", "😀" };
+    for (size_t width=2; width<=4; width++) {
+        TEST_CASE_("Width %zu", width);
+        char *s = repeat(chars[width - 2], 3000);
+        str8 str = str8new(s);
+        TEST_CHECK_EQUAL(STR8_WIDTH(str), width, "%zu", "width");
+        TEST_CHECK(checkpoints_list_ptr(str) == NULL);
+        check_indexed(str, s);
+        TEST_CHECK(str8getchar(str, 3000) == NULL);
+
+        // copies and parts keep the width
+        str8 copy = str8dup(str, false);
+        TEST_CHECK_EQUAL(STR8_WIDTH(copy), width, "%zu", "width");
+        check_indexed(copy, s);
+        str8free(copy);
+        str8 sub = str8substr(str, 100, 2900);
+        TEST_CHECK_EQUAL(STR8_WIDTH(sub), width, "%zu", "width");
+        str8free(sub);
+
+        // modifying the string creates a list
+        str = str8append(str, "a");
+        char *expected = malloc(strlen(s) + 2);
+        strcpy(expected, s);
+        strcat(expected, "a");
+        TEST_CHECK_EQUAL(STR8_WIDTH(str), (size_t)0, "%zu", "width");
+        TEST_CHECK(checkpoints_list_ptr(str) != NULL);
+        check_indexed(str, expected);
+        free(expected);
+        str8free(str);
+        free(s);
+    }
+    TEST_CASE("Mixed widths");
+    {
+        // 1 + 3 bytes average to 2 bytes per character
+        char *s = repeat("a€", 1000);
+        str8 str = str8new(s);
+        TEST_CHECK_EQUAL(STR8_WIDTH(str), (size_t)0, "%zu", "width");
+        check_indexed(str, s);
+        str8free(str);
+        free(s);
+    }
+    TEST_CASE("Grow without changing the capacity");
+    {
+        char *s = repeat("ж", 1000);
+        str8 str = str8share(str8new(s));
+        str = str8grow(str, 10, false);
+        TEST_CHECK_EQUAL(STR8_WIDTH(str), (size_t)0, "%zu", "width");
+        TEST_CHECK(STR8_IS_SHARED(str));
+        check_indexed(str, s);
+        str8free(str);
+        free(s);
+    }
+}
+
+void test_granularity(void) {
+    TEST_CASE("Hints");
+    {
+        char *s = generate_random_string(utf8_charset, utf8_charset_size, 100000);
+        size_t hints[] = { 128, 200, 1, 100000 };
+        size_t expected[] = { 128, 128, CHECKPOINTS_MIN_GRANULARITY, CHECKPOINTS_GRANULARITY };
+        for (size_t i=0; i<4; i++) {
+            str8 str = str8newgranularity(s, 0, hints[i]);
+            TEST_CHECK_EQUAL(STR8_GRANULARITY(str), expected[i], "%zu", "granularity");
+            TEST_CHECK(STR8_HAS_DESC(str) == (expected[i] != CHECKPOINTS_GRANULARITY));
+            check_indexed(str, s);
+            str8free(str);
+        }
+        free(s);
+    }
+    TEST_CASE("Policy");
+    {
+        TEST_CHECK_EQUAL(granularity_from_size(1000), (size_t)CHECKPOINTS_GRANULARITY, "%zu", "granularity");
+        TEST_CHECK_EQUAL(granularity_from_size(STR8_DENSE_THRESHOLD), (size_t)STR8_DENSE_GRANULARITY,
+                         "%zu", "granularity");
+        char *s = generate_random_string(utf8_charset, utf8_charset_size, 10000);
+        str8 str = str8newgranularity(s, 0, 0);
+        TEST_CHECK(!STR8_HAS_DESC(str));
+        check_indexed(str, s);
+        str8free(str);
+        free(s);
+    }
+    TEST_CASE("No list");
+    {
+        // ASCII strings have no list, so the granularity is dropped
+        char *s = repeat("a", 5000);
+        str8 str = str8newgranularity(s, 0, 128);
+        TEST_CHECK(!STR8_HAS_DESC(str));
+        check_indexed(str, s);
+        str8free(str);
+        free(s);
+    }
+    TEST_CASE("Copies and appending");
+    {
+        char *s = generate_random_string(utf8_charset, utf8_charset_size, 60000);
+        str8 str = str8newgranularity(s, 0, 64);
+        str8 copy = str8dup(str, false);
+        TEST_CHECK_EQUAL(STR8_GRANULARITY(copy), (size_t)64, "%zu", "granularity");
+        check_indexed(copy, s);
+        str8free(copy);
+        copy = str8dup(str, true);
+        TEST_CHECK_EQUAL(STR8_GRANULARITY(copy), (size_t)64, "%zu", "granularity");
+        check_indexed(copy, s);
+        str8free(copy);
+        size_t length = count_chars(s, strlen(s));
+        str8 sub = str8substr(str, length / 3, length);
+        TEST_CHECK_EQUAL(STR8_GRANULARITY(sub), (size_t)64, "%zu", "granularity");
+        check_indexed(sub, lookup_idx(s, strlen(s), length / 3));
+        str8free(sub);
+
+        // appending grows to type 4, the list is moved in front of the new fields
+        str = str8share(str);
+        char *other = generate_random_string(utf8_charset, utf8_charset_size, 30000);
+        char *ascii = repeat("b", 1000);
+        str = str8append(str, other);
+        str = str8append(str, ascii);
+        char *expected = malloc(strlen(s) + strlen(other) + strlen(ascii) + 1);
+        strcpy(expected, s);
+        strcat(expected, other);
+        strcat(expected, ascii);
+        TEST_CHECK_EQUAL(STR8_TYPE(str), STR8_TYPE4, "%d", "type");
+        TEST_CHECK_EQUAL(STR8_GRANULARITY(str), (size_t)64, "%zu", "granularity");
+        TEST_CHECK(STR8_IS_SHARED(str));
+        check_indexed(str, expected);
+        str8free(str);
+        free(expected);
+        free(ascii);
+        free(other);
+        free(s);
+    }
+}
+
+void test_unindexed(void) {
+    TEST_CASE("New");
+    {
+        char *s = generate_random_string(utf8_charset, utf8_charset_size, 100000);
+        str8 str = str8newunindexed(s, 0);
+        TEST_CHECK(STR8_INDEX(str) == STR8_INDEX_NONE);
+        TEST_CHECK(checkpoints_list_ptr(str) == NULL);
+        check_indexed(str, s);
+        str8free(str);
+
+        // ASCII and short strings do not need a list anyways
+        str = str8newunindexed("Hällo Wörld", 0);
+        check_indexed(str, "Hällo Wörld");
+        str8free(str);
+        char *ascii = repeat("a", 1000);
+        str = str8newunindexed(ascii, 0);
+        TEST_CHECK(!STR8_HAS_DESC(str));
+        check_indexed(str, ascii);
+        str8free(str);
+        free(ascii);
+
+        str = str8newunindexed(s, 50000);
+        TEST_CHECK_EQUAL(str8size(str), (size_t)50000, "%zu", "size");
+        TEST_CHECK_EQUAL(str8len(str), count_chars(s, 50000), "%zu", "length");
+        str8free(str);
+        free(s);
+    }
+    TEST_CASE("Build and drop");
+    {
+        char *s = generate_random_string(utf8_charset, utf8_charset_size, 100000);
+        str8 str = str8share(str8newunindexed(s, 0));
+        str8 other = str8retain(str);
+        str = str8buildindex(str, 128);
+        TEST_CHECK(STR8_INDEX(str) == STR8_INDEX_LIST);
+        TEST_CHECK_EQUAL(STR8_GRANULARITY(str), (size_t)128, "%zu", "granularity");
+        TEST_CHECK(STR8_IS_SHARED(str));
+        check_indexed(str, s);
+        // the other owner still has the string without index
+        TEST_CHECK(STR8_INDEX(other) == STR8_INDEX_NONE);
+        check_indexed(other, s);
+        str8free(other);
+
+        str = str8dropindex(str);
+        TEST_CHECK(STR8_INDEX(str) == STR8_INDEX_NONE);
+        check_indexed(str, s);
+        str = str8buildindex(str, 0);
+        TEST_CHECK(!STR8_HAS_DESC(str));
+        check_indexed(str, s);
+        str8free(str);
+        free(s);
+    }
+    TEST_CASE("Build uniform width");
+    {
+        char *s = repeat("語", 1000);
+        str8 str = str8buildindex(str8newunindexed(s, 0), 0);
+        TEST_CHECK_EQUAL(STR8_WIDTH(str), (size_t)3, "%zu", "width");
+        check_indexed(str, s);
+        str8free(str);
+        free(s);
+    }
+    TEST_CASE("Modify");
+    {
+        char *s = generate_random_string(utf8_charset, utf8_charset_size, 60000);
+        char *other = generate_random_string(utf8_charset, utf8_charset_size, 30000);
+        str8 str = str8newunindexed(s, 0);
+        str = str8append(str, other);
+        str = str8append(str, "abc");
+        char *expected = malloc(strlen(s) + strlen(other) + 4);
+        strcpy(expected, s);
+        strcat(expected, other);
+        strcat(expected, "abc");
+        TEST_CHECK_EQUAL(STR8_TYPE(str), STR8_TYPE4, "%d", "type");
+        TEST_CHECK(STR8_INDEX(str) == STR8_INDEX_NONE);
+        check_indexed(str, expected);
+
+        size_t length = count_chars(expected, strlen(expected));
+        str8 sub = str8substr(str, length / 2, length);
+        TEST_CHECK(STR8_INDEX(sub) == STR8_INDEX_NONE);
+        check_indexed(sub, lookup_idx(expected, strlen(expected), length / 2));
+        str8free(sub);
+        str8 copy = str8dup(str, true);
+        check_indexed(copy, expected);
+        str8free(copy);
+
+        // after building the index, parts get a list as well
+        str = str8buildindex(str, 0);
+        check_indexed(str, expected);
+        sub = str8substr(str, length / 2, length);
+        TEST_CHECK(checkpoints_list_ptr(sub) != NULL);
+        check_indexed(sub, lookup_idx(expected, strlen(expected), length / 2));
+        str8free(sub);
+        str8free(str);
+        free(expected);
+        free(other);
+        free(s);
+    }
+    TEST_CASE("Modify without descriptor");
+    {
+        // ASCII strings and strings below 256 bytes have no descriptor to
+        // record that they are without an index, so they get the default
+        // list once a modification makes them need one
+        char *ascii = repeat("a", 1000);
+        char *other = generate_random_string(utf8_charset, utf8_charset_size, 2000);
+        char *expected = malloc(1000 + strlen(other) + 1);
+        strcpy(expected, ascii);
+        strcat(expected, other);
+        str8 str = str8newunindexed(ascii, 0);
+        TEST_CHECK(!STR8_HAS_DESC(str));
+        str = str8append(str, other);
+        TEST_CHECK(STR8_INDEX(str) == STR8_INDEX_LIST);
+        TEST_CHECK(checkpoints_list_ptr(str) != NULL);
+        check_indexed(str, expected);
+        str8free(str);
+
+        char *small = generate_random_string(utf8_charset, utf8_charset_size, 60);
+        str = str8newunindexed(small, 0);
+        TEST_CHECK_EQUAL(STR8_TYPE(str), STR8_TYPE1, "%d", "type");
+        TEST_CHECK(!STR8_HAS_DESC(str));
+        str = str8append(str, other);
+        expected = realloc(expected, strlen(small) + strlen(other) + 1);
+        strcpy(expected, small);
+        strcat(expected, other);
+        TEST_CHECK(STR8_TYPE(str) > STR8_TYPE1);
+        TEST_CHECK(STR8_INDEX(str) == STR8_INDEX_LIST);
+        TEST_CHECK(checkpoints_list_ptr(str) != NULL);
+        check_indexed(str, expected);
+        str8free(str);
+        free(small);
+        free(expected);
+        free(other);
+        free(ascii);
+    }
+}
+
+void test_charindex(void) {
+    TEST_CASE("Build");
+    {
+        char *s = generate_random_string(utf8_charset, utf8_charset_size, 100000);
+        size_t distances[] = { 64, 100, 1, 0, 1000000 };
+        size_t expected[] = { 64, 64, STR8_MIN_ANCHOR_DISTANCE, STR8_ANCHOR_DISTANCE, STR8_MAX_ANCHOR_DISTANCE };
+        for (size_t i=0; i<5; i++) {
+            str8 str = str8buildcharindex(str8new(s), distances[i]);
+            TEST_CHECK(STR8_INDEX(str) == STR8_INDEX_CHARS);
+            TEST_CHECK(checkpoints_list_ptr(str) == NULL);
+            TEST_CHECK(checkpoints_anchors_ptr(str) != NULL);
+            TEST_CHECK_EQUAL(STR8_GRANULARITY(str), expected[i], "%zu", "distance");
+            check_indexed(str, s);
+            str8free(str);
+        }
+
+        // from and to the other index kinds
+        str8 str = str8buildcharindex(str8newunindexed(s, 0), 16);
+        check_indexed(str, s);
+        str = str8buildcharindex(str, 16);
+        TEST_CHECK_EQUAL(STR8_GRANULARITY(str), (size_t)16, "%zu", "distance");
+        str = str8buildindex(str, 128);
+        TEST_CHECK(STR8_INDEX(str) == STR8_INDEX_LIST);
+        TEST_CHECK_EQUAL(STR8_GRANULARITY(str), (size_t)128, "%zu", "granularity");
+        check_indexed(str, s);
+        str = str8buildcharindex(str, 0);
+        TEST_CHECK(STR8_INDEX(str) == STR8_INDEX_CHARS);
+        check_indexed(str, s);
+        str = str8dropindex(str);
+        TEST_CHECK(STR8_INDEX(str) == STR8_INDEX_NONE);
+        check_indexed(str, s);
+        str8free(str);
+        free(s);
+    }
+    TEST_CASE("No index needed");
+    {
+        char *ascii = repeat("a", 1000);
+        str8 str = str8buildcharindex(str8new(ascii), 0);
+        TEST_CHECK(!STR8_HAS_DESC(str));
+        check_indexed(str, ascii);
+        str8free(str);
+        free(ascii);
+        char *s = repeat("語", 1000);
+        str = str8buildcharindex(str8newunindexed(s, 0), 0);
+        TEST_CHECK_EQUAL(STR8_WIDTH(str), (size_t)3, "%zu", "width");
+        check_indexed(str, s);
+        str8free(str);
+        free(s);
+    }
+    TEST_CASE("Appending behind the last anchor");
+    {
+        // the first new anchor is the one of the first appended character
+        // if the length is a multiple of the distance
+        size_t lengths[] = { 600, 601, 604, 607, 608 };
+        for (size_t i=0; i<5; i++) {
+            char *s = repeat("äb", lengths[i] / 2);
+            char *expected = malloc(strlen(s) + 5);
+            strcpy(expected, s);
+            strcat(expected, lengths[i] % 2 ? "öyz" : "yz");
+            free(s);
+            s = strndup(expected, strlen(expected) - 2);
+            str8 str = str8buildcharindex(str8new(s), 8);
+            str = str8append(str, "yz");
+            size_t length = lengths[i] + 2;
+            TEST_CHECK_EQUAL(str8len(str), length, "%zu", "length");
+            for (size_t idx=0; idx<length; idx++) {
+                const char *c = str8getchar(str, idx);
+                if (c != str + (lookup_idx(expected, strlen(expected), idx) - expected)) {
+                    TEST_CHECK(false);
+                    TEST_MSG("Character %zu of %zu", idx, length);
+                    break;
+                }
+            }
+            str8free(str);
+            free(expected);
+            free(s);
+        }
+    }
+    TEST_CASE("Copies and appending");
+    {
+        char *s = generate_random_string(utf8_charset, utf8_charset_size, 60000);
+        str8 str = str8share(str8buildcharindex(str8new(s), 32));
+        str8 other_owner = str8retain(str);
+        str8 copy = str8dup(str, false);
+        TEST_CHECK(STR8_INDEX(copy) == STR8_INDEX_CHARS);
+        check_indexed(copy, s);
+        str8free(copy);
+        copy = str8dup(str, true);
+        TEST_CHECK(STR8_INDEX(copy) == STR8_INDEX_CHARS);
+        check_indexed(copy, s);
+        str8free(copy);
+        size_t length = count_chars(s, strlen(s));
+        str8 sub = str8substr(str, length / 3, length);
+        TEST_CHECK(STR8_INDEX(sub) == STR8_INDEX_CHARS);
+        check_indexed(sub, lookup_idx(s, strlen(s), length / 3));
+        str8free(sub);
+
+        // appending grows to type 4, so the anchors get wider
+        char *other = generate_random_string(utf8_charset, utf8_charset_size, 30000);
+        char *ascii = repeat("b", 1000);
+        str = str8append(str, other);
+        str = str8append(str, ascii);
+        char *expected = malloc(strlen(s) + strlen(other) + strlen(ascii) + 1);
+        strcpy(expected, s);
+        strcat(expected, other);
+        strcat(expected, ascii);
+        TEST_CHECK_EQUAL(STR8_TYPE(str), STR8_TYPE4, "%d", "type");
+        TEST_CHECK(STR8_INDEX(str) == STR8_INDEX_CHARS);
+        TEST_CHECK_EQUAL(STR8_GRANULARITY(str), (size_t)32, "%zu", "distance");
+        check_indexed(str, expected);
+        // the other owner keeps the original
+        check_indexed(other_owner, s);
+        str8free(other_owner);
+
+        size_t byte_start, byte_end;
+        size_t new_length = count_chars(expected, strlen(expected));
+        str8getrange(str, 1000, new_length - 10, &byte_start, &byte_end);
+        TEST_CHECK(expected + byte_start == lookup_idx(expected, strlen(expected), 1000));
+        TEST_CHECK(expected + byte_end == lookup_idx(expected, strlen(expected), new_length - 10));
+        str8free(str);
+        free(expected);
+        free(ascii);
+        free(other);
+        free(s);
+    }
+}
+
 TEST_LIST = {
     { "New (simple)", test_new_simple },
     { "New (failed random tests)", test_failed_ranom_tests },
@@ -308,5 +1001,14 @@ TEST_LIST = {
     { "New (random long)", test_new_random_long },
     { "Grow", test_grow },
     { "Append", test_append },
+    { "Append UTF-8 within capacity", test_append_utf8_within_capacity },
+    { "Append ASCII to UTF-8", test_append_ascii_to_utf8 },
+    { "Dup", test_dup },
+    { "Substr", test_substr },
+    { "Share", test_share },
+    { "Uniform Width", test_uniform_width },
+    { "Granularity", test_granularity },
+    { "Unindexed", test_unindexed },
+    { "Char Index", test_charindex },
     { NULL, NULL }
 };
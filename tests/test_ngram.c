@@ -0,0 +1,222 @@
+#include "acutest.h"
+#include "test_helper.h"
+#include "src/str8.h"
+#include "src/str8_header.h"
+#include "src/str8_memory.h"
+#include "src/str8_simd.h"
+#include "src/str8_ngram.h"
+#include "src/str8_debug.h"
+
+
+/** @brief A small alphabet, so the trigrams repeat often. */
+static const char *ngram_charset[] = { "a", "b", "c", "ä", "€", "a", "b" };
+static const size_t ngram_charset_size = sizeof(ngram_charset) / sizeof(ngram_charset[0]);
+
+/** @brief Compare the search for needle in str with a naive search of s. */
+void check_find(str8 str, const str8ngram *index, const char *s, const char *needle) {
+    size_t size = strlen(s);
+    size_t needle_size = strlen(needle);
+    size_t capacity = size + 1;
+    size_t *expected = malloc(capacity * sizeof(size_t));
+    size_t *got = malloc(capacity * sizeof(size_t));
+    size_t expected_count = 0;
+    for (size_t pos=0; needle_size>0 && pos+needle_size<=size; pos++) {
+        if (memcmp(s + pos, needle, needle_size) == 0) {
+            expected[expected_count++] = count_chars(s, pos);
+        }
+    }
+    size_t count = str8ngramfind(str, index, needle, got, capacity);
+    TEST_CHECK_EQUAL(count, expected_count, "%zu", "matches");
+    TEST_MSG("Needle: \"%s\"", needle);
+    for (size_t i=0; i<count && i<expected_count; i++) {
+        if (got[i] != expected[i]) {
+            TEST_CHECK(false);
+            TEST_MSG("Match %zu of \"%s\": expected %zu, got %zu", i, needle, expected[i], got[i]);
+            break;
+        }
+    }
+
+    // only the first matches are written
+    if (expected_count > 2) {
+        size_t first[3] = { 0, 0, SIZE_MAX };
+        TEST_CHECK_EQUAL(str8ngramfind(str, index, needle, first, 2), expected_count, "%zu", "matches");
+        TEST_CHECK(first[0] == expected[0] && first[1] == expected[1] && first[2] == SIZE_MAX);
+    }
+    free(expected);
+    free(got);
+}
+
+void test_ngram_simple(void) {
+    const char *s = "Hello World! Hello ä€ä€ Hello";
+    str8 str = str8new(s);
+    str8ngram index;
+    TEST_CHECK(str8ngrambuild(&index, str, 1) == 0);
+    TEST_CHECK_EQUAL(index.count, strlen(s) - 2, "%zu", "postings");
+    TEST_CHECK(str8ngramsize(&index) > 0);
+
+    size_t results[8];
+    TEST_CHECK_EQUAL(str8ngramfind(str, &index, "Hello", results, 8), (size_t)3, "%zu", "matches");
+    TEST_CHECK(results[0] == 0 && results[1] == 13 && results[2] == 24);
+    TEST_CHECK_EQUAL(str8ngramfind(str, &index, "ä€", results, 8), (size_t)2, "%zu", "matches");
+    TEST_CHECK(results[0] == 19 && results[1] == 21);
+    TEST_CHECK_EQUAL(str8ngramfind(str, &index, "o", results, 8), (size_t)4, "%zu", "matches");
+    TEST_CHECK_EQUAL(str8ngramfind(str, &index, "", results, 8), (size_t)0, "%zu", "matches");
+    TEST_CHECK_EQUAL(str8ngramfind(str, &index, "Hellx", results, 8), (size_t)0, "%zu", "matches");
+    TEST_CHECK_EQUAL(str8ngramfind(str, &index, "Hello World! Hello ä€ä€ Hello!", results, 8),
+                     (size_t)0, "%zu", "matches");
+    str8ngramfree(&index);
+    str8free(str);
+
+    TEST_CASE("Short strings");
+    const char *shorts[] = { "", "a", "ab", "abc" };
+    for (size_t i=0; i<4; i++) {
+        str = str8new(shorts[i]);
+        TEST_CHECK(str8ngrambuild(&index, str, 4) == 0);
+        check_find(str, &index, shorts[i], "a");
+        check_find(str, &index, shorts[i], "abc");
+        str8ngramfree(&index);
+        str8free(str);
+    }
+}
+
+void test_ngram_random(void) {
+    for (int i=0; i<40; i++) {
+        TEST_CASE_("Round %d", i);
+        bool ascii = i % 5 == 0;
+        char *s = ascii ? generate_random_string(ascii_charset, 3, rand() % 20000)
+                        : generate_random_string(ngram_charset, ngram_charset_size, rand() % 20000);
+        size_t size = strlen(s);
+        str8 str = str8new(s);
+        if (i % 4 == 1) {
+            str = str8dropindex(str);
+        }
+        else if (i % 4 == 2) {
+            str = str8buildcharindex(str, STR8_ANCHOR_DISTANCE);
+        }
+        str8ngram index;
+        TEST_CHECK(str8ngrambuild(&index, str, i % 2 ? 4 : 1) == 0);
+        for (int n=0; n<20; n++) {
+            size_t needle_size = 1 + rand() % 10;
+            char *needle;
+            if (rand() % 2 && size > needle_size) {
+                // a part of s, starting and ending at characters
+                size_t pos = rand() % (size - needle_size);
+                while (pos > 0 && (s[pos] & 0xC0) == 0x80) {
+                    pos--;
+                }
+                while (pos + needle_size < size && (s[pos + needle_size] & 0xC0) == 0x80) {
+                    needle_size++;
+                }
+                needle = malloc(needle_size + 1);
+                memcpy(needle, s + pos, needle_size);
+                needle[needle_size] = '\0';
+            }
+            else {
+                needle = generate_random_string(ngram_charset, ngram_charset_size, needle_size);
+            }
+            check_find(str, &index, s, needle);
+            free(needle);
+        }
+        str8ngramfree(&index);
+        str8free(str);
+        free(s);
+    }
+}
+
+void test_ngram_threads(void) {
+    // large enough for 7 parts
+    char *s = generate_random_string(ngram_charset, ngram_charset_size, 400000);
+    str8 str = str8new(s);
+    str8ngram single, parallel;
+    TEST_CHECK(str8ngrambuild(&single, str, 1) == 0);
+    TEST_CHECK(str8ngrambuild(&parallel, str, 7) == 0);
+    TEST_CHECK_EQUAL(parallel.bits, single.bits, "%zu", "bits");
+    TEST_CHECK_EQUAL(parallel.count, single.count, "%zu", "postings");
+    TEST_CHECK(memcmp(single.starts, parallel.starts, ((1 << single.bits) + 1) * sizeof(uint32_t)) == 0);
+    TEST_CHECK(memcmp(single.postings, parallel.postings, single.count * sizeof(uint32_t)) == 0);
+    str8ngramfree(&single);
+    str8ngramfree(&parallel);
+    str8free(str);
+    free(s);
+}
+
+void test_ngram_serialize(void) {
+    char *s = generate_random_string(ngram_charset, ngram_charset_size, 10000);
+    str8 str = str8new(s);
+    str8ngram index;
+    TEST_CHECK(str8ngrambuild(&index, str, 2) == 0);
+
+    size_t size = str8ngramserializedsize(&index);
+    char *buffer = malloc(size);
+    TEST_CHECK_EQUAL(str8ngramserialize(&index, buffer), size, "%zu", "bytes");
+
+    str8ngram loaded;
+    TEST_CHECK(str8ngramdeserialize(&loaded, buffer, size) == 0);
+    TEST_CHECK_EQUAL(loaded.bits, index.bits, "%zu", "bits");
+    TEST_CHECK_EQUAL(loaded.count, index.count, "%zu", "postings");
+    TEST_CHECK_EQUAL(loaded.size, index.size, "%zu", "size");
+    TEST_CHECK(memcmp(loaded.postings, index.postings, index.count * sizeof(uint32_t)) == 0);
+    check_find(str, &loaded, s, "ab");
+    check_find(str, &loaded, s, "a€ä");
+    str8ngramfree(&loaded);
+
+    TEST_CASE("Invalid buffers");
+    TEST_CHECK(str8ngramdeserialize(&loaded, buffer, size - 1) == -1);
+    TEST_CHECK(str8ngramdeserialize(&loaded, buffer, 8) == -1);
+    buffer[0] = 'X';
+    TEST_CHECK(str8ngramdeserialize(&loaded, buffer, size) == -1);
+    buffer[0] = 'S';
+
+    TEST_CASE("Truncated buffers");
+    for (size_t n=0; n<size; n+=size/97+1) {
+        if (str8ngramdeserialize(&loaded, buffer, n) != -1) {
+            TEST_CHECK(false);
+            TEST_MSG("Accepted %zu of %zu bytes", n, size);
+            str8ngramfree(&loaded);
+            break;
+        }
+    }
+
+    TEST_CASE("Flipped bits");
+    {
+        // the header is magic, version (4 bytes each), bits, count and size
+        // (8 bytes each), followed by the starts
+        // the number of postings (the last start does not match then)
+        uint64_t *count = (uint64_t *)(buffer + 16);
+        for (int bit=0; bit<64; bit+=7) {
+            *count ^= (uint64_t)1 << bit;
+            TEST_CHECK(str8ngramdeserialize(&loaded, buffer, size) == -1);
+            TEST_MSG("Bit %d of the count", bit);
+            *count ^= (uint64_t)1 << bit;
+        }
+        // the high bit of a start exceeds the number of postings, so the
+        // starts decrease behind it (or the last one does not match)
+        uint32_t *starts = (uint32_t *)(buffer + 32);
+        size_t buckets = (size_t)1 << index.bits;
+        for (size_t b=0; b<=buckets; b++) {
+            starts[b] ^= 1u << 31;
+            if (str8ngramdeserialize(&loaded, buffer, size) != -1) {
+                TEST_CHECK(false);
+                TEST_MSG("Accepted a flipped start %zu", b);
+                str8ngramfree(&loaded);
+                break;
+            }
+            starts[b] ^= 1u << 31;
+        }
+        TEST_CHECK(str8ngramdeserialize(&loaded, buffer, size) == 0);
+        str8ngramfree(&loaded);
+    }
+
+    free(buffer);
+    str8ngramfree(&index);
+    str8free(str);
+    free(s);
+}
+
+TEST_LIST = {
+    { "N-gram index (simple)", test_ngram_simple },
+    { "N-gram index (random)", test_ngram_random },
+    { "N-gram index (threads)", test_ngram_threads },
+    { "N-gram index (serialize)", test_ngram_serialize },
+    { NULL, NULL }
+};
@@ -0,0 +1,178 @@
+#include "acutest.h"
+#include "test_helper.h"
+#include "src/str8.h"
+#include "src/str8_header.h"
+#include "src/str8_memory.h"
+#include "src/str8_simd.h"
+#include "src/str8_patterns.h"
+#include "src/str8_debug.h"
+
+
+/** @brief A small alphabet, so there are many (overlapping) matches. */
+static const char *patterns_charset[] = { "a", "b", "c", "ä", "€", "a", "b" };
+static const size_t patterns_charset_size = sizeof(patterns_charset) / sizeof(patterns_charset[0]);
+
+typedef struct {
+    str8match *matches;
+    size_t count;
+    size_t capacity;
+    size_t stop_after;  //< Stop the scan after this many matches (0 for never)
+} match_list;
+
+bool collect_match(const str8match *match, void *data) {
+    match_list *list = data;
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? 2 * list->capacity : 64;
+        list->matches = realloc(list->matches, list->capacity * sizeof(str8match));
+    }
+    list->matches[list->count++] = *match;
+    return list->stop_after == 0 || list->count < list->stop_after;
+}
+
+/** @brief Return the matches of patterns in s in the documented order with a naive search. */
+match_list naive_matches(const char *s, const char **patterns, size_t count) {
+    match_list list = { 0 };
+    size_t size = strlen(s);
+    for (size_t end=1; end<=size; end++) {
+        // longer patterns first, then by index
+        for (size_t pattern_size=end; pattern_size>0; pattern_size--) {
+            for (size_t p=0; p<count; p++) {
+                if (strlen(patterns[p]) == pattern_size &&
+                    memcmp(s + end - pattern_size, patterns[p], pattern_size) == 0) {
+                    str8match match = {
+                        .pattern = p,
+                        .idx = count_chars(s, end - pattern_size),
+                        .byte_pos = end - pattern_size,
+                        .size = pattern_size
+                    };
+                    collect_match(&match, &list);
+                }
+            }
+        }
+    }
+    return list;
+}
+
+/** @brief Compare the scan of str with both engines against a naive search of s. */
+void check_scan(str8 str, const char *s, const char **patterns, size_t count) {
+    match_list expected = naive_matches(s, patterns, count);
+    for (int automaton=0; automaton<=1; automaton++) {
+        str8patterns *set = patterns_new_(patterns, count, automaton);
+        TEST_CHECK(set != NULL);
+        match_list got = { 0 };
+        size_t reported = str8patternsscan(set, str, collect_match, &got);
+        TEST_CHECK_EQUAL(reported, expected.count, "%zu", "matches");
+        TEST_CHECK_EQUAL(got.count, expected.count, "%zu", "matches");
+        TEST_MSG("Engine: %s", automaton ? "automaton" : "teddy");
+        for (size_t i=0; i<got.count && i<expected.count; i++) {
+            str8match *a = &got.matches[i];
+            str8match *b = &expected.matches[i];
+            if (a->pattern != b->pattern || a->idx != b->idx || a->byte_pos != b->byte_pos || a->size != b->size) {
+                TEST_CHECK(false);
+                TEST_MSG("Match %zu (%s): expected pattern %zu at %zu (byte %zu), got pattern %zu at %zu (byte %zu)",
+                         i, automaton ? "automaton" : "teddy", b->pattern, b->idx, b->byte_pos,
+                         a->pattern, a->idx, a->byte_pos);
+                break;
+            }
+        }
+        free(got.matches);
+
+        // stop early
+        if (expected.count > 2) {
+            match_list first = { .stop_after = 2 };
+            TEST_CHECK_EQUAL(str8patternsscan(set, str, collect_match, &first), (size_t)2, "%zu", "matches");
+            free(first.matches);
+        }
+        str8patternsfree(set);
+    }
+    free(expected.matches);
+}
+
+void test_patterns_simple(void) {
+    const char *patterns[] = { "he", "she", "his", "hers", "", "ä€", "she" };
+    size_t count = sizeof(patterns) / sizeof(patterns[0]);
+    const char *strings[] = { "", "ushers", "she sells his hers", "Hä€llo ä€ shershe", "xyz" };
+    for (size_t i=0; i<sizeof(strings) / sizeof(strings[0]); i++) {
+        TEST_CASE(strings[i]);
+        str8 str = str8new(strings[i]);
+        check_scan(str, strings[i], patterns, count);
+        str8free(str);
+    }
+    TEST_CASE("Order");
+    {
+        str8patterns *set = str8patternsnew(patterns, count);
+        TEST_CHECK_EQUAL(str8patternscount(set), count, "%zu", "patterns");
+        str8 str = str8new("ushers");
+        match_list got = { 0 };
+        TEST_CHECK_EQUAL(str8patternsscan(set, str, collect_match, &got), (size_t)4, "%zu", "matches");
+        // "she" twice (pattern 1 and 6), "he", then "hers"
+        size_t expected_patterns[] = { 1, 6, 0, 3 };
+        size_t expected_idx[] = { 1, 1, 2, 2 };
+        for (size_t i=0; i<4 && i<got.count; i++) {
+            TEST_CHECK_EQUAL(got.matches[i].pattern, expected_patterns[i], "%zu", "pattern");
+            TEST_CHECK_EQUAL(got.matches[i].idx, expected_idx[i], "%zu", "index");
+        }
+        free(got.matches);
+        str8free(str);
+        str8patternsfree(set);
+    }
+    TEST_CASE("Non-ASCII patterns in an ASCII string");
+    {
+        const char *non_ascii[] = { "ä", "€a" };
+        str8patterns *set = str8patternsnew(non_ascii, 2);
+        str8 str = str8new("aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaa");
+        match_list got = { 0 };
+        TEST_CHECK_EQUAL(str8patternsscan(set, str, collect_match, &got), (size_t)0, "%zu", "matches");
+        str8free(str);
+        str8patternsfree(set);
+    }
+}
+
+void test_patterns_random(void) {
+    for (int i=0; i<60; i++) {
+        TEST_CASE_("Round %d", i);
+        bool ascii = i % 6 == 0;
+        char *s = ascii ? generate_random_string(ascii_charset, 3, rand() % 3000)
+                        : generate_random_string(patterns_charset, patterns_charset_size, rand() % 3000);
+        size_t size = strlen(s);
+        size_t count = 1 + rand() % (i % 2 ? 8 : 100);
+        const char **patterns = malloc(count * sizeof(char *));
+        for (size_t p=0; p<count; p++) {
+            size_t pattern_size = 1 + rand() % 12;
+            if (rand() % 2 && size > pattern_size) {
+                // a part of s, starting and ending at characters
+                size_t pos = rand() % (size - pattern_size);
+                while (pos > 0 && (s[pos] & 0xC0) == 0x80) {
+                    pos--;
+                }
+                while (pos + pattern_size < size && (s[pos + pattern_size] & 0xC0) == 0x80) {
+                    pattern_size++;
+                }
+                char *pattern = malloc(pattern_size + 1);
+                memcpy(pattern, s + pos, pattern_size);
+                pattern[pattern_size] = '\0';
+                patterns[p] = pattern;
+            }
+            else {
+                patterns[p] = generate_random_string(patterns_charset, patterns_charset_size, pattern_size);
+            }
+        }
+        str8 str = str8new(s);
+        if (i % 3 == 1) {
+            str = str8dropindex(str);
+        }
+        check_scan(str, s, patterns, count);
+        str8free(str);
+        for (size_t p=0; p<count; p++) {
+            free((char *)patterns[p]);
+        }
+        free(patterns);
+        free(s);
+    }
+}
+
+TEST_LIST = {
+    { "Patterns (simple)", test_patterns_simple },
+    { "Patterns (random)", test_patterns_random },
+    { NULL, NULL }
+};
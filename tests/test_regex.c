@@ -0,0 +1,259 @@
+#include "acutest.h"
+#include "test_helper.h"
+#include "src/str8.h"
+#include "src/str8_header.h"
+#include "src/str8_memory.h"
+#include "src/str8_regex.h"
+#include "src/str8_debug.h"
+
+
+typedef struct {
+    const char *pattern;
+    const char *s;
+    bool found;
+    size_t idx;
+    size_t length;
+} regex_case;
+
+/** @brief Return the size of the first count characters of s. */
+static size_t prefix_size(const char *s, size_t count) {
+    size_t size = 0;
+    for (; count > 0 && s[size]; count--) {
+        size++;
+        while ((s[size] & 0xC0) == 0x80) {
+            size++;
+        }
+    }
+    return size;
+}
+
+void test_regex_simple(void) {
+    const regex_case cases[] = {
+        { "a|ab", "ab", true, 0, 1 },
+        { "ab|a", "ab", true, 0, 2 },
+        { "(a|ab)(c|bcd)", "abcd", true, 0, 4 },
+        { "x*", "aaa", true, 0, 0 },
+        { "a+", "baaab", true, 1, 3 },
+        { "a+?", "aaa", true, 0, 1 },
+        { "a*?b", "aab", true, 0, 3 },
+        { "a{2,3}", "aaaa", true, 0, 3 },
+        { "a{2,3}?", "aaaa", true, 0, 2 },
+        { "a{2}", "a", false, 0, 0 },
+        { "a{2,}", "baaaa", true, 1, 4 },
+        { "a{", "ba{", true, 1, 2 },
+        { "a{x}", "a{x}", true, 0, 4 },
+        { "^b", "ab", false, 0, 0 },
+        { "^a", "ab", true, 0, 1 },
+        { "b$", "abb", true, 2, 1 },
+        { "^$", "", true, 0, 0 },
+        { "^$", "a", false, 0, 0 },
+        { "a$|ab", "ab", true, 0, 2 },
+        { "(a|ab)$", "ab", true, 0, 2 },
+        { "ä+", "xääy", true, 1, 2 },
+        { "[α-ω]+", "abc αβγ", true, 4, 3 },
+        { "\\d+", "ab12c", true, 2, 2 },
+        { "\\w+", "  foo_1 ", true, 2, 5 },
+        { "\\S+", "  ä€ ", true, 2, 2 },
+        { "\\s", "a\tb", true, 1, 1 },
+        { "[\\d\\s]+", "ab1 2c", true, 2, 3 },
+        { ".", "€", true, 0, 1 },
+        { "[^a]", "a€", true, 1, 1 },
+        { "[^a€]", "a€ü", true, 2, 1 },
+        { "\\x{20AC}", "a€", true, 1, 1 },
+        { "\\x41", "zA", true, 1, 1 },
+        { "(?:ab)+", "xababa", true, 1, 4 },
+        { "a.c", "a\nc", false, 0, 0 },
+        { "a[^x]c", "a\nc", true, 0, 3 },
+        { "€", "abc", false, 0, 0 },
+        { "[^€]+", "abc", true, 0, 3 },
+        { "[]a]+", "x]a]", true, 1, 3 },
+        { "[a-]+", "x-a", true, 1, 2 },
+        { "\\.\\*", "a.*", true, 1, 2 },
+        { "[a-c]{2}", "xxbcx", true, 2, 2 },
+        { "(a*)*b", "aaab", true, 0, 4 },
+        { "", "abc", true, 0, 0 },
+        { "|b", "b", true, 0, 0 },
+        { "😀+", "a😀😀", true, 1, 2 },
+        { "[\\x{10000}-\\x{10FFFF}]", "aü€😀", true, 3, 1 },
+    };
+    for (size_t i=0; i<sizeof(cases) / sizeof(cases[0]); i++) {
+        const regex_case *c = &cases[i];
+        TEST_CASE_("\"%s\" in \"%s\"", c->pattern, c->s);
+        str8regex *re = str8regexnew(c->pattern);
+        TEST_ASSERT(re != NULL);
+        str8 str = str8new(c->s);
+        str8regexmatch match;
+        bool found = str8regexsearch(re, str, 0, &match);
+        TEST_CHECK(found == c->found);
+        if (found && c->found) {
+            TEST_CHECK_EQUAL(match.idx, c->idx, "%zu", "index");
+            TEST_CHECK_EQUAL(match.length, c->length, "%zu", "length");
+            TEST_CHECK_EQUAL(match.byte_pos, prefix_size(c->s, c->idx), "%zu", "byte offset");
+            TEST_CHECK_EQUAL(match.size, prefix_size(c->s + match.byte_pos, c->length), "%zu", "size");
+        }
+        str8free(str);
+        str8regexfree(re);
+    }
+
+    TEST_CASE("Start");
+    {
+        str8regex *re = str8regexnew("a");
+        str8 str = str8new("aäa");
+        str8regexmatch match;
+        TEST_CHECK(str8regexsearch(re, str, 1, &match) && match.idx == 2 && match.byte_pos == 3);
+        TEST_CHECK(!str8regexsearch(re, str, 3, &match));
+        TEST_CHECK(!str8regexsearch(re, str, 4, &match));
+        str8free(str);
+        str8regexfree(re);
+    }
+
+    TEST_CASE("Invalid patterns");
+    const char *invalid[] = { "(", "a)", "*a", "[a", "a{2,1}", "\\q", "[b-a]", "a{1001}",
+                              "\\x{D800}", "\\x4", "[a-\\d]", "\xC3", "(?:a" };
+    for (size_t i=0; i<sizeof(invalid) / sizeof(invalid[0]); i++) {
+        str8regex *re = str8regexnew(invalid[i]);
+        TEST_CHECK(re == NULL);
+        TEST_MSG("Pattern: \"%s\"", invalid[i]);
+        str8regexfree(re);
+    }
+}
+
+
+/* --- Reference: backtracking over codepoints for atoms with quantifiers --- */
+
+static const char *regex_atoms[] = { "a", "b", "ä", "€", ".", "[aä]", "[^b€]" };
+static const char *regex_quantifiers[] = { "", "", "*", "+", "?", "*?", "+?", "??", "{1,2}" };
+static const char *regex_charset[] = { "a", "b", "ä", "€", "\n", "a", "ä" };
+
+typedef struct {
+    size_t atom;
+    size_t quantifier;
+} ref_atom;
+
+static bool ref_matches(size_t atom, uint32_t c) {
+    switch (atom) {
+        case 0: return c == 'a';
+        case 1: return c == 'b';
+        case 2: return c == 0xE4;
+        case 3: return c == 0x20AC;
+        case 4: return c != '\n';
+        case 5: return c == 'a' || c == 0xE4;
+        default: return c != 'b' && c != 0x20AC;
+    }
+}
+
+/** @brief Return the end of the first match of atoms[k..] at pos (in the order of Perl) or -1. */
+static long ref_match(const ref_atom *atoms, size_t n, size_t k, const uint32_t *s, size_t length, size_t pos) {
+    if (k == n) {
+        return pos;
+    }
+    size_t min = 1, max = 1;
+    bool greedy = true;
+    switch (atoms[k].quantifier) {
+        case 2: min = 0; max = SIZE_MAX; break;
+        case 3: min = 1; max = SIZE_MAX; break;
+        case 4: min = 0; max = 1; break;
+        case 5: min = 0; max = SIZE_MAX; greedy = false; break;
+        case 6: min = 1; max = SIZE_MAX; greedy = false; break;
+        case 7: min = 0; max = 1; greedy = false; break;
+        case 8: min = 1; max = 2; break;
+    }
+    size_t run = 0;
+    while (run < max && pos + run < length && ref_matches(atoms[k].atom, s[pos + run])) {
+        run++;
+    }
+    if (run < min) {
+        return -1;
+    }
+    for (size_t i=0; i<=run-min; i++) {
+        size_t j = greedy ? run - i : min + i;
+        long end = ref_match(atoms, n, k + 1, s, length, pos + j);
+        if (end >= 0) {
+            return end;
+        }
+    }
+    return -1;
+}
+
+static size_t ref_decode(const char *s, uint32_t *codepoints) {
+    size_t length = 0;
+    const unsigned char *u = (const unsigned char *)s;
+    while (*u) {
+        if (*u < 0x80) {
+            codepoints[length++] = *u++;
+        }
+        else if (*u < 0xE0) {
+            codepoints[length++] = (u[0] & 0x1F) << 6 | (u[1] & 0x3F);
+            u += 2;
+        }
+        else {
+            codepoints[length++] = (u[0] & 0x0F) << 12 | (u[1] & 0x3F) << 6 | (u[2] & 0x3F);
+            u += 3;
+        }
+    }
+    return length;
+}
+
+void test_regex_random(void) {
+    for (int i=0; i<300; i++) {
+        TEST_CASE_("Round %d", i);
+        ref_atom atoms[6];
+        size_t n = 1 + rand() % 5;
+        char pattern[128] = "";
+        for (size_t k=0; k<n; k++) {
+            atoms[k].atom = rand() % (sizeof(regex_atoms) / sizeof(regex_atoms[0]));
+            atoms[k].quantifier = rand() % (sizeof(regex_quantifiers) / sizeof(regex_quantifiers[0]));
+            strcat(pattern, regex_atoms[atoms[k].atom]);
+            strcat(pattern, regex_quantifiers[atoms[k].quantifier]);
+        }
+        bool ascii = i % 4 == 0;
+        char *s = ascii ? generate_random_string(regex_charset, 2, rand() % 200)
+                        : generate_random_string(regex_charset, 7, rand() % 200);
+        uint32_t *codepoints = malloc((strlen(s) + 1) * sizeof(uint32_t));
+        size_t length = ref_decode(s, codepoints);
+
+        str8 str = str8new(s);
+        if (i % 3 == 1) {
+            str = str8dropindex(str);
+        }
+        // the second one flushes its cache all the time
+        str8regex *res[2] = { str8regexnew(pattern), regex_new_(pattern, 0) };
+        TEST_ASSERT(res[0] != NULL && res[1] != NULL);
+        for (int r=0; r<2; r++) {
+            size_t start = 0;
+            str8regexmatch match;
+            for (size_t ref_start=0; ref_start<=length; ref_start++) {
+                long end = ref_match(atoms, n, 0, codepoints, length, ref_start);
+                if (end < 0) {
+                    continue;
+                }
+                bool found = str8regexsearch(res[r], str, start, &match);
+                TEST_CHECK(found);
+                TEST_MSG("Pattern \"%s\" in \"%s\": expected match at %zu", pattern, s, ref_start);
+                if (!found) {
+                    break;
+                }
+                TEST_CHECK(match.idx == ref_start && match.length == (size_t)(end - (long)ref_start));
+                TEST_MSG("Pattern \"%s\" in \"%s\": expected (%zu, %ld), got (%zu, %zu)",
+                         pattern, s, ref_start, end - (long)ref_start, match.idx, match.length);
+                if (match.idx != ref_start) {
+                    break;
+                }
+                start = (size_t)end > ref_start ? (size_t)end : ref_start + 1;
+                ref_start = start - 1;
+            }
+            TEST_CHECK(start > length || !str8regexsearch(res[r], str, start, &match));
+        }
+        str8regexfree(res[0]);
+        str8regexfree(res[1]);
+        str8free(str);
+        free(codepoints);
+        free(s);
+    }
+}
+
+TEST_LIST = {
+    { "Regex (simple)", test_regex_simple },
+    { "Regex (random)", test_regex_random },
+    { NULL, NULL }
+};
@@ -0,0 +1,263 @@
+#include "acutest.h"
+#include "test_helper.h"
+#include "src/str8.h"
+#include "src/str8_header.h"
+#include "src/str8_checkpoints.h"
+#include "src/str8_simd.h"
+#include "src/str8_rope.h"
+#include "src/str8_debug.h"
+
+
+/** @brief Check the cached values and the AVL property of every node and return the height. */
+int check_tree(const str8rope *rope) {
+    if (!rope) {
+        return 0;
+    }
+    if (rope->leaf) {
+        TEST_CHECK(!rope->left && !rope->right);
+        TEST_CHECK(rope->size > 0 && rope->size <= STR8_ROPE_LEAF_SIZE);
+        TEST_CHECK(rope->size == str8size(rope->leaf));
+        TEST_CHECK(rope->length == str8len(rope->leaf));
+        TEST_CHECK(rope->height == 0);
+        return 0;
+    }
+    TEST_CHECK(rope->left && rope->right);
+    int hl = check_tree(rope->left);
+    int hr = check_tree(rope->right);
+    TEST_CHECK(hl - hr <= 1 && hr - hl <= 1);
+    TEST_MSG("Unbalanced node: %d vs %d", hl, hr);
+    TEST_CHECK(rope->size == rope->left->size + rope->right->size);
+    TEST_CHECK(rope->length == rope->left->length + rope->right->length);
+    int height = (hl > hr ? hl : hr) + 1;
+    TEST_CHECK(rope->height == height);
+    return height;
+}
+
+/** @brief Compare rope with expected by flattening it and by sampling characters. */
+void check_rope(const str8rope *rope, const char *expected) {
+    size_t size = strlen(expected);
+    size_t length = count_chars(expected, size);
+    check_tree(rope);
+    TEST_CHECK_EQUAL(str8ropesize(rope), size, "%zu", "size");
+    TEST_CHECK_EQUAL(str8ropelen(rope), length, "%zu", "length");
+
+    for (int i=0; i<20 && length > 0; i++) {
+        size_t idx = rand() % length;
+        const char *c = str8ropegetchar(rope, idx);
+        TEST_CHECK(c && memcmp(c, lookup_idx(expected, size, idx), 1) == 0);
+        TEST_MSG("Character %zu differs", idx);
+    }
+    TEST_CHECK(str8ropegetchar(rope, length) == NULL);
+
+    str8 flat = str8ropeflatten(rope);
+    TEST_CHECK(strcmp(flat, expected) == 0);
+    TEST_MSG("Content differs");
+    TEST_CHECK_EQUAL(str8size(flat), size, "%zu", "flattened size");
+    TEST_CHECK_EQUAL(str8len(flat), length, "%zu", "flattened length");
+    void *list = checkpoints_list_ptr(flat);
+    if (list) {
+        for (size_t idx=0; idx<size/CHECKPOINTS_GRANULARITY; idx++) {
+            size_t value = read_entry(list, idx);
+            size_t expected_value = count_chars(expected, (idx + 1) * CHECKPOINTS_GRANULARITY);
+            if (value != expected_value) {
+                TEST_CHECK_EQUAL(value, expected_value, "%zu", "entry");
+                TEST_MSG("Entry %zu of %zu", idx, size/CHECKPOINTS_GRANULARITY);
+                break;
+            }
+        }
+    }
+    str8free(flat);
+}
+
+/** @brief Return a malloc'ed copy of s with the characters [start, end) replaced by other. */
+char *reference_replace(const char *s, size_t start, size_t end, const char *other) {
+    size_t size = strlen(s);
+    size_t length = count_chars(s, size);
+    end = end > length ? length : end;
+    start = start > end ? end : start;
+    const char *first = start < length ? lookup_idx(s, size, start) : s + size;
+    const char *last = end < length ? lookup_idx(s, size, end) : s + size;
+    size_t other_size = strlen(other);
+    char *result = malloc(size + other_size + 1);
+    memcpy(result, s, first - s);
+    memcpy(result + (first - s), other, other_size);
+    strcpy(result + (first - s) + other_size, last);
+    return result;
+}
+
+void test_new(void) {
+    TEST_CASE("Empty");
+    {
+        str8rope *rope = str8ropenew("");
+        TEST_CHECK(rope == NULL);
+        check_rope(rope, "");
+    }
+    TEST_CASE("Small");
+    {
+        str8rope *rope = str8ropenew("Hällo Wörld");
+        check_rope(rope, "Hällo Wörld");
+        str8ropefree(rope);
+    }
+    TEST_CASE("Large");
+    {
+        char *s = generate_random_string(utf8_charset, utf8_charset_size, 500000);
+        str8rope *rope = str8ropenew(s);
+        TEST_CHECK(rope->height > 0);
+        check_rope(rope, s);
+        str8ropefree(rope);
+        free(s);
+    }
+}
+
+void test_split_concat(void) {
+    char *s = generate_random_string(utf8_charset, utf8_charset_size, 300000);
+    size_t length = count_chars(s, strlen(s));
+    for (int i=0; i<20; i++) {
+        size_t idx = rand() % (length + 1);
+        str8rope *left, *right;
+        str8ropesplit(str8ropenew(s), idx, &left, &right);
+        TEST_CHECK_EQUAL(str8ropelen(left), idx, "%zu", "left length");
+        char *expected_left = reference_replace(s, idx, SIZE_MAX, "");
+        char *expected_right = reference_replace(s, 0, idx, "");
+        check_rope(left, expected_left);
+        check_rope(right, expected_right);
+        // join in reverse order to get something different from the original tree
+        str8rope *rope = str8ropeconcat(right, left);
+        char *expected = malloc(strlen(s) + 1);
+        strcpy(expected, expected_right);
+        strcat(expected, expected_left);
+        check_rope(rope, expected);
+        str8ropefree(rope);
+        free(expected);
+        free(expected_left);
+        free(expected_right);
+    }
+    free(s);
+}
+
+void test_random(void) {
+    char *s = generate_random_string(utf8_charset, utf8_charset_size, 200000);
+    str8rope *rope = str8ropenew(s);
+    for (int i=0; i<500; i++) {
+        size_t length = count_chars(s, strlen(s));
+        size_t start = rand() % (length + 1);
+        char *expected;
+        if (rand() % 2) {
+            bool ascii = rand() % 2;
+            char *other = generate_random_string(ascii ? ascii_charset : utf8_charset,
+                                                 ascii ? ascii_charset_size : utf8_charset_size,
+                                                 rand() % (rand() % 10 ? 50 : 50000));
+            rope = str8ropeinsert(rope, start, other);
+            expected = reference_replace(s, start, start, other);
+            free(other);
+        }
+        else {
+            size_t end = start + (rand() % 10 ? rand() % 50 : rand() % 50000);
+            rope = str8ropedelete(rope, start, end);
+            expected = reference_replace(s, start, end, "");
+        }
+        free(s);
+        s = expected;
+        if (i % 50 == 0) {
+            TEST_CASE_("Round %d", i);
+            check_rope(rope, s);
+        }
+    }
+    check_rope(rope, s);
+    str8ropefree(rope);
+    free(s);
+}
+
+/** @brief Number of allocations failing_alloc() still serves before it fails. */
+static size_t allocations_left;
+
+static void *failing_alloc(size_t size) {
+    if (allocations_left == 0) {
+        return NULL;
+    }
+    allocations_left--;
+    return malloc(size);
+}
+
+void test_allocation_failure(void) {
+    char *s = generate_random_string(utf8_charset, utf8_charset_size, 150000);
+    size_t length = count_chars(s, strlen(s));
+    // larger than a leaf, so it is never inserted into an existing one
+    char *other = generate_random_string(utf8_charset, utf8_charset_size, 40000);
+
+    TEST_CASE("New");
+    str8rope *rope = NULL;
+    for (size_t limit=0; !rope; limit++) {
+        allocations_left = limit;
+        rope = rope_new_(s, failing_alloc);
+    }
+    check_rope(rope, s);
+
+    TEST_CASE("Concat");
+    {
+        str8rope *right = str8ropenew(other);
+        str8rope *leaf = str8ropenew("x");
+        // without merging the leaves, joining them needs a new node
+        allocations_left = 0;
+        TEST_CHECK(rope_concat_(right, leaf, NULL, false, failing_alloc) == NULL);
+        check_rope(right, other);
+        check_rope(leaf, "x");
+        str8ropefree(right);
+        str8ropefree(leaf);
+    }
+
+    TEST_CASE("Insert");
+    {
+        size_t idx = rand() % (length + 1);
+        char *expected = reference_replace(s, idx, idx, other);
+        str8rope *result = NULL;
+        for (size_t limit=0; !result; limit++) {
+            allocations_left = limit;
+            result = rope_insert_(rope, idx, other, failing_alloc);
+            if (!result) {
+                check_rope(rope, s);
+            }
+        }
+        rope = result;
+        check_rope(rope, expected);
+        free(s);
+        s = expected;
+    }
+
+    TEST_CASE("Delete");
+    {
+        // spans several leaves and cuts through two of them
+        size_t start = rand() % (length / 2) + 1;
+        size_t end = start + length / 3;
+        char *expected = reference_replace(s, start, end, "");
+        str8rope *result = NULL;
+        for (size_t limit=0; !result; limit++) {
+            allocations_left = limit;
+            result = rope_delete_(rope, start, end, failing_alloc);
+            if (!result) {
+                check_rope(rope, s);
+            }
+        }
+        rope = result;
+        check_rope(rope, expected);
+        free(s);
+        s = expected;
+    }
+
+    TEST_CASE("Delete all");
+    {
+        allocations_left = 0;
+        rope = rope_delete_(rope, 0, SIZE_MAX, failing_alloc);
+        TEST_CHECK(rope == NULL);
+    }
+    free(other);
+    free(s);
+}
+
+TEST_LIST = {
+    { "New", test_new },
+    { "Split and Concat", test_split_concat },
+    { "Random", test_random },
+    { "Allocation failure", test_allocation_failure },
+    { NULL, NULL }
+};
@@ -0,0 +1,152 @@
+#include "acutest.h"
+#include "test_helper.h"
+#include "src/str8.h"
+#include "src/str8_header.h"
+#include "src/str8_memory.h"
+#include "src/str8_simd.h"
+#include "src/str8_search.h"
+#include "src/str8_debug.h"
+
+
+/** @brief A small alphabet, so there are many partial matches. */
+static const char *search_charset[] = { "a", "b", "ä", "€", "a", "b" };
+static const size_t search_charset_size = sizeof(search_charset) / sizeof(search_charset[0]);
+
+/** @brief Return a malloc'ed needle, either a part of s (starting at a character) or random. */
+char *generate_needle(const char *s) {
+    size_t size = strlen(s);
+    size_t needle_size = rand() % 20;
+    if (rand() % 2 && size > 0) {
+        size_t pos = rand() % size;
+        while (pos > 0 && (s[pos] & 0xC0) == 0x80) {
+            pos--;
+        }
+        needle_size = needle_size > size - pos ? size - pos : needle_size;
+        // cut at a character boundary
+        while (pos + needle_size < size && (s[pos + needle_size] & 0xC0) == 0x80) {
+            needle_size++;
+        }
+        char *needle = malloc(needle_size + 1);
+        memcpy(needle, s + pos, needle_size);
+        needle[needle_size] = '\0';
+        return needle;
+    }
+    return generate_random_string(search_charset, search_charset_size, needle_size);
+}
+
+/** @brief Return the first match of needle in s at or behind byte_start with a naive search. */
+size_t naive_find(const char *s, const char *needle, size_t byte_start) {
+    size_t size = strlen(s);
+    size_t needle_size = strlen(needle);
+    for (size_t pos=byte_start; pos + needle_size <= size; pos++) {
+        if (memcmp(s + pos, needle, needle_size) == 0) {
+            return pos;
+        }
+    }
+    return STR8_NOT_FOUND;
+}
+
+/** @brief Return the last match of needle ending at or in front of byte_end with a naive search. */
+size_t naive_rfind(const char *s, const char *needle, size_t byte_end) {
+    size_t needle_size = strlen(needle);
+    for (size_t pos=byte_end + 1; pos-- > 0;) {
+        if (pos + needle_size <= byte_end && memcmp(s + pos, needle, needle_size) == 0) {
+            return pos;
+        }
+    }
+    return STR8_NOT_FOUND;
+}
+
+void test_find_bytes(void) {
+    TEST_CASE("Simple");
+    {
+        const char *s = "Hällo Wörld, Hällo";
+        TEST_CHECK(find_bytes(s, strlen(s), "llo", 3) == s + 3);
+        TEST_CHECK(rfind_bytes(s, strlen(s), "llo", 3) == s + 18);
+        TEST_CHECK(find_bytes(s, strlen(s), "ö", 2) == s + 8);
+        TEST_CHECK(find_bytes(s, strlen(s), "xyz", 3) == NULL);
+        TEST_CHECK(find_bytes(s, strlen(s), "", 0) == s);
+        TEST_CHECK(rfind_bytes(s, strlen(s), "", 0) == s + strlen(s));
+        TEST_CHECK(find_bytes(s, 2, "Hällo", 6) == NULL);
+    }
+    TEST_CASE("Random");
+    for (int i=0; i<500; i++) {
+        char *s = generate_random_string(search_charset, search_charset_size, rand() % 2000);
+        char *needle = generate_needle(s);
+        size_t size = strlen(s);
+        size_t needle_size = strlen(needle);
+        const char *expected = naive_find(s, needle, 0) == STR8_NOT_FOUND ? NULL : s + naive_find(s, needle, 0);
+        TEST_CHECK(find_bytes(s, size, needle, needle_size) == expected);
+        TEST_MSG("Needle \"%s\" in \"%s\"", needle, s);
+        size_t last = naive_rfind(s, needle, size);
+        expected = last == STR8_NOT_FOUND ? NULL : s + last;
+        TEST_CHECK(rfind_bytes(s, size, needle, needle_size) == expected);
+        TEST_MSG("Needle \"%s\" in \"%s\"", needle, s);
+        free(needle);
+        free(s);
+    }
+}
+
+void test_find(void) {
+    TEST_CASE("Simple");
+    {
+        str8 str = str8new("Hällo Wörld, Hällo");
+        size_t byte_pos;
+        TEST_CHECK_EQUAL(str8find(str, "llo", 0, &byte_pos), (size_t)2, "%zu", "index");
+        TEST_CHECK_EQUAL(byte_pos, (size_t)3, "%zu", "byte offset");
+        TEST_CHECK_EQUAL(str8find(str, "llo", 3, &byte_pos), (size_t)15, "%zu", "index");
+        TEST_CHECK_EQUAL(byte_pos, (size_t)18, "%zu", "byte offset");
+        TEST_CHECK_EQUAL(str8rfind(str, "llo", SIZE_MAX, NULL), (size_t)15, "%zu", "index");
+        TEST_CHECK_EQUAL(str8rfind(str, "llo", 17, NULL), (size_t)2, "%zu", "index");
+        TEST_CHECK_EQUAL(str8rfind(str, "llo", 18, NULL), (size_t)15, "%zu", "index");
+        TEST_CHECK_EQUAL(str8find(str, "x", 0, NULL), STR8_NOT_FOUND, "%zu", "index");
+        TEST_CHECK_EQUAL(str8find(str, "", 18, NULL), (size_t)18, "%zu", "index");
+        TEST_CHECK_EQUAL(str8find(str, "", 19, NULL), STR8_NOT_FOUND, "%zu", "index");
+        TEST_CHECK_EQUAL(str8rfind(str, "", 5, NULL), (size_t)5, "%zu", "index");
+        TEST_CHECK_EQUAL(str8findbyte(str, "W", 0), (size_t)7, "%zu", "byte offset");
+        TEST_CHECK_EQUAL(str8rfindbyte(str, "H", 100), (size_t)15, "%zu", "byte offset");
+        str8free(str);
+    }
+    for (int i=0; i<200; i++) {
+        TEST_CASE_("Random %d", i);
+        char *s = generate_random_string(search_charset, search_charset_size, rand() % 100000);
+        size_t size = strlen(s);
+        size_t length = count_chars(s, size);
+        str8 str = str8new(s);
+        if (i % 3 == 1) {
+            str = str8dropindex(str);
+        }
+        else if (i % 3 == 2) {
+            str = str8buildcharindex(str, 0);
+        }
+        for (int j=0; j<10; j++) {
+            char *needle = generate_needle(s);
+            size_t start = rand() % (length + 1);
+            size_t byte_start = start < length ? (size_t)(lookup_idx(s, size, start) - s) : size;
+            size_t expected = naive_find(s, needle, byte_start);
+            size_t byte_pos = STR8_NOT_FOUND;
+            size_t idx = str8find(str, needle, start, &byte_pos);
+            TEST_CHECK_EQUAL(byte_pos, expected, "%zu", "byte offset");
+            TEST_CHECK_EQUAL(idx, expected == STR8_NOT_FOUND ? expected : count_chars(s, expected), "%zu", "index");
+            TEST_MSG("Needle \"%s\" from %zu", needle, start);
+
+            size_t end = rand() % 4 ? rand() % (length + 1) : SIZE_MAX;
+            size_t byte_end = end < length ? (size_t)(lookup_idx(s, size, end) - s) : size;
+            expected = naive_rfind(s, needle, byte_end);
+            byte_pos = STR8_NOT_FOUND;
+            idx = str8rfind(str, needle, end, &byte_pos);
+            TEST_CHECK_EQUAL(byte_pos, expected, "%zu", "byte offset");
+            TEST_CHECK_EQUAL(idx, expected == STR8_NOT_FOUND ? expected : count_chars(s, expected), "%zu", "index");
+            TEST_MSG("Needle \"%s\" up to %zu", needle, end);
+            free(needle);
+        }
+        str8free(str);
+        free(s);
+    }
+}
+
+TEST_LIST = {
+    { "Find Bytes", test_find_bytes },
+    { "Find", test_find },
+    { NULL, NULL }
+};
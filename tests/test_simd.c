@@ -120,6 +120,64 @@ void test_lookup_random(void) {
     }
 }
 
+void test_count_le_u16(void) {
+    uint16_t values[200];
+    for (int i=0; i<100; i++) {
+        size_t count = rand() % 200;
+        for (size_t j=0; j<count; j++) {
+            // use the full range to cover the unsigned comparison
+            values[j] = (uint16_t)rand();
+        }
+        uint16_t bound = rand() % 3 ? (uint16_t)rand() : (rand() % 2 ? 0 : UINT16_MAX);
+        size_t expected = 0;
+        for (size_t j=0; j<count; j++) {
+            expected += values[j] <= bound;
+        }
+        TEST_CHECK_EQUAL(count_le_u16(values, count, bound), expected, "%zu", "count");
+    }
+}
+
+void test_find_line_starts(void) {
+    uint64_t offsets[8];
+    uint64_t chars[8];
+    for (int i=0; i<100; i++) {
+        char *s = generate_random_string(utf8_charset, utf8_charset_size, rand() % 10000);
+        size_t size = strlen(s);
+        for (size_t j=0; j<size; j++) {
+            if (!(s[j] & 0x80) && rand() % 50 == 0) {
+                s[j] = '\n';
+            }
+        }
+        // a small capacity, so the scan is continued many times
+        size_t from = 0;
+        size_t chars_in_front = 0;
+        size_t expected_chars = 0;
+        size_t n = 0;
+        size_t k = 0;
+        bool ok = true;
+        for (size_t j=0; j<size && ok; j++) {
+            expected_chars += (s[j] & 0xC0) != 0x80;
+            if (s[j] != '\n') {
+                continue;
+            }
+            if (k == n) {
+                n = find_line_starts(s, from, size, chars_in_front, offsets, chars, 8);
+                k = 0;
+                ok = n > 0;
+            }
+            if (ok && (offsets[k] != j + 1 || chars[k] != expected_chars)) {
+                ok = false;
+            }
+            from = j + 1;
+            chars_in_front = expected_chars;
+            k++;
+        }
+        TEST_CHECK(ok);
+        TEST_CHECK(k == n && find_line_starts(s, from, size, chars_in_front, offsets, chars, 8) == 0);
+        free(s);
+    }
+}
+
 TEST_LIST = {
     { "SIMD: is_ascii", test_is_ascii },
     { "SIMD: is_ascii (Random)", test_is_ascii_random },
@@ -127,5 +185,7 @@ TEST_LIST = {
     { "SIMD: Character Count (Random)", test_count_random },
     { "SIMD: Lookup", test_lookup },
     { "SIMD: Lookup (Random)", test_lookup_random },
+    { "SIMD: Count u16 <= bound", test_count_le_u16 },
+    { "SIMD: Find Line Starts", test_find_line_starts },
     { NULL, NULL }
 };
@@ -0,0 +1,120 @@
+#include "acutest.h"
+#include "test_helper.h"
+#include "src/str8.h"
+#include "src/str8_header.h"
+#include "src/str8_memory.h"
+#include "src/str8_simd.h"
+#include "src/str8_view.h"
+
+
+void test_slice(void) {
+    TEST_CASE("ASCII");
+    {
+        str8 str = str8new("Hello World");
+        str8view view = str8slice(str, 6, 11);
+        TEST_CHECK_EQUAL(str8viewlen(view), 5LU, "%zu", "length");
+        TEST_CHECK_EQUAL(str8viewsize(view), 5LU, "%zu", "size");
+        TEST_CHECK(str8viewstart(view) == str + 6);
+        TEST_CHECK(str8viewgetchar(view, 0) == str + 6);
+        TEST_CHECK(str8viewgetchar(view, 4) == str + 10);
+        TEST_CHECK(str8viewgetchar(view, 5) == NULL);
+        str8free(str);
+    }
+    TEST_CASE("UTF-8");
+    {
+        str8 str = str8new("ä€ö€ü");
+        str8view view = str8slice(str, 1, 4);
+        TEST_CHECK_EQUAL(str8viewlen(view), 3LU, "%zu", "length");
+        TEST_CHECK_EQUAL(str8viewsize(view), 8LU, "%zu", "size");
+        TEST_CHECK(str8viewgetchar(view, 1) == str + 5);
+        str8view inner = str8viewslice(view, 1, 2);
+        TEST_CHECK_EQUAL(str8viewlen(inner), 1LU, "%zu", "length");
+        TEST_CHECK_EQUAL(str8viewsize(inner), 2LU, "%zu", "size");
+        TEST_CHECK(str8viewstart(inner) == str + 5);
+        str8free(str);
+    }
+    TEST_CASE("Clamping");
+    {
+        str8 str = str8new("ä€ö€ü");
+        str8view view = str8slice(str, 3, 100);
+        TEST_CHECK_EQUAL(str8viewlen(view), 2LU, "%zu", "length");
+        TEST_CHECK_EQUAL(str8viewsize(view), 5LU, "%zu", "size");
+        view = str8slice(str, 4, 2);
+        TEST_CHECK_EQUAL(str8viewlen(view), 0LU, "%zu", "length");
+        TEST_CHECK_EQUAL(str8viewsize(view), 0LU, "%zu", "size");
+        TEST_CHECK(str8viewstart(view) == str + 5);
+        str8free(str);
+    }
+}
+
+void test_iterate(void) {
+    str8 str = str8new("aä€b");
+    str8view view = str8slice(str, 1, 3);
+    const char *expected[] = { str + 1, str + 3 };
+    size_t count = 0;
+    for (const char *p = str8viewstart(view); p; p = str8viewnext(view, p)) {
+        TEST_CHECK(count < 2);
+        TEST_CHECK(p == expected[count]);
+        count++;
+    }
+    TEST_CHECK_EQUAL(count, 2LU, "%zu", "characters");
+    str8free(str);
+}
+
+void test_dup(void) {
+    str8 str = str8new("ä€ö€ü");
+    str8view view = str8slice(str, 1, 4);
+    str8 copy = str8viewdup(view);
+    TEST_CHECK_STR(copy, "€ö€");
+    TEST_CHECK_EQUAL(str8len(copy), 3LU, "%zu", "length");
+    str8free(copy);
+
+    view = str8slice(str, 2, 2);
+    copy = str8viewdup(view);
+    TEST_CHECK_STR(copy, "");
+    str8free(copy);
+    str8free(str);
+}
+
+void test_random(void) {
+    for (int i=0; i<50; i++) {
+        char *s = generate_random_string(utf8_charset, utf8_charset_size, rand() % 100000);
+        size_t size = strlen(s);
+        size_t length = count_chars(s, size);
+        str8 str = str8new(s);
+        TEST_CASE(s);
+
+        size_t start = length ? rand() % length : 0;
+        size_t end = start + (length - start ? rand() % (length - start) : 0);
+        str8view view = str8slice(str, start, end);
+        const char *first = lookup_idx(s, size, start);
+        const char *last = end < length ? lookup_idx(s, size, end) : s + size;
+
+        TEST_CHECK_EQUAL(str8viewlen(view), end - start, "%zu", "length");
+        TEST_CHECK_EQUAL(str8viewsize(view), (size_t)(last - first), "%zu", "size");
+        for (int j=0; j<10 && end > start; j++) {
+            size_t idx = rand() % (end - start);
+            TEST_CHECK_EQUAL(str8viewgetchar(view, idx) - str, lookup_idx(s, size, start + idx) - s, "%ld", "offset");
+        }
+
+        str8 copy = str8viewdup(view);
+        TEST_CHECK_EQUAL(str8size(copy), str8viewsize(view), "%zu", "size");
+        TEST_CHECK_EQUAL(str8len(copy), str8viewlen(view), "%zu", "length");
+        TEST_CHECK(memcmp(copy, first, str8size(copy)) == 0);
+        for (int j=0; j<10 && end > start; j++) {
+            size_t idx = rand() % (end - start);
+            TEST_CHECK_EQUAL(str8getchar(copy, idx) - copy, str8viewgetchar(view, idx) - str8viewstart(view), "%ld", "offset");
+        }
+        str8free(copy);
+        str8free(str);
+        free(s);
+    }
+}
+
+TEST_LIST = {
+    { "Slice", test_slice },
+    { "Iterate", test_iterate },
+    { "Dup", test_dup },
+    { "Random", test_random },
+    { NULL, NULL }
+};